@@ -0,0 +1,113 @@
+#!/usr/bin/python3
+
+# Copyright Imperas Software Ltd
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http:#www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import argparse
+import mmap
+import struct
+import sys
+import time
+
+# layout must match riscvMetricsHeader and riscvMetricsRecord in
+# source/riscvMetrics.h
+MAGIC   = b'RVMETRC1'
+VERSION = 1
+HEADER  = struct.Struct('<8sIIII')
+RECORD  = struct.Struct('<QQQQQQdddII64s')
+
+MODES = {0: 'U', 1: 'S', 3: 'M'}
+
+def readRecord(data, offset):
+
+    '''
+        Read one record, retrying while it is being updated
+    '''
+
+    while True:
+        before = struct.unpack_from('<Q', data, offset)[0]
+        fields = RECORD.unpack_from(data, offset)
+        after  = struct.unpack_from('<Q', data, offset)[0]
+        if (before == after) and not (before & 1):
+            return fields
+
+def show(data, staleSeconds):
+
+    '''
+        Display one snapshot of all published harts
+    '''
+
+    magic, version, maxHarts, numHarts, recordBytes = HEADER.unpack_from(data, 0)
+
+    if (magic != MAGIC) or (version != VERSION):
+        sys.exit('not a riscvOVPsim metrics file (version %u)' % VERSION)
+
+    now = time.time()
+
+    print('%-32s %5s %4s %18s %16s %10s %12s %12s %s' % (
+        'hart', 'id', 'mode', 'pc', 'retired', 'MIPS', 'traps/s',
+        'tlbmiss/s', 'status'
+    ))
+
+    for i in range(numHarts):
+
+        (sequence, updateTime, retired, pc, traps, tlbMisses, mips,
+         trapRate, tlbMissRate, mode, hartId, name) = readRecord(
+            data, HEADER.size + i*recordBytes
+        )
+
+        age    = now - updateTime/1e6
+        status = 'STALE %.0fs' % age if age > staleSeconds else 'ok'
+        name   = name.split(b'\0', 1)[0].decode()
+
+        print('%-32s %5u %4s 0x%016x %16u %10.2f %12.1f %12.1f %s' % (
+            name, hartId, MODES.get(mode, '?'), pc, retired, mips, trapRate,
+            tlbMissRate, status
+        ))
+
+def main():
+
+    '''
+        Display live metrics published by riscvOVPsim (parameter metrics_file)
+    '''
+
+    parser = argparse.ArgumentParser(description=main.__doc__.strip())
+    parser.add_argument('file',
+                        help='metrics file written by the simulator')
+    parser.add_argument('--interval',
+                        type=float,
+                        default=1.0,
+                        help='seconds between display updates (default 1)')
+    parser.add_argument('--stale',
+                        type=float,
+                        default=10.0,
+                        help='seconds after which a hart is reported stale (default 10)')
+    parser.add_argument('--once',
+                        action='store_true',
+                        help='display one snapshot and exit')
+    args = parser.parse_args()
+
+    with open(args.file, 'rb') as f:
+
+        data = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+
+        while True:
+            show(data, args.stale)
+            if args.once:
+                break
+            time.sleep(args.interval)
+            print()
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,239 @@
+#!/usr/bin/python3
+
+# Copyright Imperas Software Ltd
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http:#www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import argparse
+import math
+import random
+import sys
+
+def readVectors(name):
+
+    '''
+        Read basic block vectors in SimPoint .bb format, returning one
+        dictionary of block identifier to instruction count per interval
+    '''
+
+    vectors = []
+
+    with open(name) as f:
+        for line in f:
+            if not line.startswith('T'):
+                continue
+            vector = {}
+            for field in line[1:].split():
+                _, block, count = field.split(':')
+                vector[int(block)] = int(count)
+            vectors.append(vector)
+
+    return vectors
+
+def project(vectors, dim, seed):
+
+    '''
+        Normalize each vector by interval length and reduce it to dim
+        dimensions by random linear projection
+    '''
+
+    rng    = random.Random(seed)
+    matrix = {}
+    result = []
+
+    for vector in vectors:
+        total = float(sum(vector.values())) or 1.0
+        point = [0.0] * dim
+        for block, count in vector.items():
+            if block not in matrix:
+                matrix[block] = [rng.uniform(-1, 1) for _ in range(dim)]
+            row    = matrix[block]
+            weight = count / total
+            for i in range(dim):
+                point[i] += weight * row[i]
+        result.append(point)
+
+    return result
+
+def distance2(a, b):
+    return sum((x - y) * (x - y) for x, y in zip(a, b))
+
+def kmeans(points, k, rng, iterations):
+
+    '''
+        Cluster points into k clusters (k-means++ initialization), returning
+        centroids and the cluster index of each point
+    '''
+
+    centroids = [rng.choice(points)]
+
+    while len(centroids) < k:
+        d2    = [min(distance2(p, c) for c in centroids) for p in points]
+        total = sum(d2)
+        if not total:
+            break
+        pick  = rng.uniform(0, total)
+        for p, d in zip(points, d2):
+            pick -= d
+            if pick <= 0:
+                break
+        centroids.append(p)
+
+    labels = [0] * len(points)
+
+    for _ in range(iterations):
+
+        changed = False
+
+        for i, p in enumerate(points):
+            best = min(range(len(centroids)),
+                       key=lambda c: distance2(p, centroids[c]))
+            if best != labels[i]:
+                labels[i] = best
+                changed   = True
+
+        for c in range(len(centroids)):
+            members = [p for p, l in zip(points, labels) if l == c]
+            if members:
+                centroids[c] = [sum(x) / len(members) for x in zip(*members)]
+
+        if not changed:
+            break
+
+    return centroids, labels
+
+def bic(points, centroids, labels):
+
+    '''
+        Return the Bayesian Information Criterion score of a clustering
+        (Pelleg and Moore, as used by SimPoint)
+    '''
+
+    R = len(points)
+    M = len(points[0])
+    K = len(centroids)
+
+    if R <= K:
+        return float('-inf')
+
+    sse      = sum(distance2(p, centroids[l]) for p, l in zip(points, labels))
+    variance = max(sse / (R - K), 1e-12)
+    logLike  = 0.0
+
+    for c in range(K):
+        Rn = labels.count(c)
+        if Rn:
+            logLike += (-Rn / 2.0 * math.log(2 * math.pi) -
+                        Rn * M / 2.0 * math.log(variance) -
+                        (Rn - K) / 2.0 +
+                        Rn * math.log(Rn) - Rn * math.log(R))
+
+    params = (K - 1) + M * K + 1
+
+    return logLike - params / 2.0 * math.log(R)
+
+def cluster(points, maxK, threshold, seeds, iterations):
+
+    '''
+        Cluster for each k up to maxK, returning the smallest clustering whose
+        BIC score is within threshold of the best score seen
+    '''
+
+    results = []
+
+    for k in range(1, min(maxK, len(points)) + 1):
+        best = None
+        for seed in range(seeds):
+            centroids, labels = kmeans(points, k, random.Random(seed), iterations)
+            sse = sum(distance2(p, centroids[l]) for p, l in zip(points, labels))
+            if best is None or sse < best[0]:
+                best = (sse, centroids, labels)
+        results.append((bic(points, best[1], best[2]), best[1], best[2]))
+
+    scores = [r[0] for r in results]
+    low    = min(scores)
+    high   = max(scores)
+
+    for score, centroids, labels in results:
+        if score >= low + threshold * (high - low):
+            return centroids, labels
+
+    return results[-1][1], results[-1][2]
+
+def main():
+
+    '''
+        Choose simulation points from basic block vectors written by
+        riscvOVPsim (parameter bbv_file)
+    '''
+
+    parser = argparse.ArgumentParser(description=main.__doc__.strip())
+    parser.add_argument('file',
+                        help='.bb file written by the simulator')
+    parser.add_argument('--maxk',
+                        type=int,
+                        default=30,
+                        help='maximum number of clusters (default 30)')
+    parser.add_argument('--dim',
+                        type=int,
+                        default=15,
+                        help='dimensions after random projection (default 15)')
+    parser.add_argument('--threshold',
+                        type=float,
+                        default=0.9,
+                        help='fraction of BIC score range required (default 0.9)')
+    parser.add_argument('--seeds',
+                        type=int,
+                        default=5,
+                        help='k-means initializations per k (default 5)')
+    parser.add_argument('--iterations',
+                        type=int,
+                        default=100,
+                        help='maximum k-means iterations (default 100)')
+    parser.add_argument('--output',
+                        help='output prefix (default is the .bb file name)')
+    args = parser.parse_args()
+
+    vectors = readVectors(args.file)
+
+    if not vectors:
+        sys.exit('%s: no intervals found' % args.file)
+
+    points            = project(vectors, args.dim, 0)
+    centroids, labels = cluster(points, args.maxk, args.threshold, args.seeds,
+                                args.iterations)
+    prefix            = args.output or args.file
+    chosen            = []
+
+    # choose the interval closest to each cluster centroid
+    for c, centroid in enumerate(centroids):
+        members = [i for i, l in enumerate(labels) if l == c]
+        if members:
+            best = min(members, key=lambda i: distance2(points[i], centroid))
+            chosen.append((best, c, len(members) / float(len(points))))
+
+    chosen.sort()
+
+    with open(prefix + '.simpoints', 'w') as f:
+        for interval, c, _ in chosen:
+            f.write('%d %d\n' % (interval, c))
+
+    with open(prefix + '.weights', 'w') as f:
+        for _, c, weight in chosen:
+            f.write('%f %d\n' % (weight, c))
+
+    print('%d intervals, %d simulation points' % (len(points), len(chosen)))
+    print('bbv_checkpoints=%s' % ','.join(str(i) for i, _, _ in chosen))
+
+if __name__ == '__main__':
+    main()
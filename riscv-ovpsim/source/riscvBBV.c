@@ -0,0 +1,462 @@
+/*
+ * Copyright (c) 2005-2020 Imperas Software Ltd., www.imperas.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied.
+ *
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// standard header files
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Imperas header files
+#include "hostapi/impAlloc.h"
+
+// VMI header files
+#include "vmi/vmiMessage.h"
+#include "vmi/vmiRt.h"
+
+// model header files
+#include "riscvBBV.h"
+#include "riscvMessage.h"
+#include "riscvStateExport.h"
+#include "riscvStructure.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// TYPES
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Entry in the block identifier table (addresses are stored plus one so that
+// zero indicates an empty entry)
+//
+typedef struct riscvBBVEntryS {
+    Uns64 PC;                       // block address plus one
+    Uns32 id;                       // block identifier
+} riscvBBVEntry, *riscvBBVEntryP;
+
+//
+// Per-hart basic block vector profiling state
+//
+typedef struct riscvBBVS {
+
+    // output
+    FILE          *file;            // SimPoint .bb file
+    char          *name;            // .bb file name (per hart)
+
+    // block identifier table
+    riscvBBVEntryP entries;         // block address to identifier table
+    Uns32          entriesSize;     // table size (power of 2)
+    Uns32          entriesUsed;     // table entries used
+
+    // counts for the current interval, indexed by block identifier
+    Uns64         *counts;          // instructions executed per block
+    Uns32         *touched;         // blocks with non-zero counts
+    Uns32          countsSize;      // size of counts and touched arrays
+    Uns32          touchedNum;      // number of touched blocks
+    Uns32          nextId;          // next block identifier to allocate
+
+    // interval state
+    Uns64          interval;        // instructions per interval
+    Uns64          intervalEnd;     // instruction count ending interval
+    Uns64          intervalIndex;   // index of current interval
+    Uns64          lastICount;      // instruction count at last block entry
+    Uns32          lastId;          // identifier of last block entered
+    Bool           started;         // has the first block been entered?
+
+    // checkpoints
+    Uns64         *checkpoints;     // intervals at which to checkpoint
+    Uns32          checkpointsNum;  // number of checkpoint intervals
+
+} riscvBBV;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// UTILITIES
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Return copy of the given string
+//
+static char *copyString(const char *string) {
+
+    char *result = STYPE_CALLOC_N(char, strlen(string)+1);
+
+    strcpy(result, string);
+
+    return result;
+}
+
+//
+// Hash a block address into a table of the given size (a power of 2)
+//
+inline static Uns32 hashBlockPC(Uns64 PC, Uns32 size) {
+    return (Uns32)((PC>>1) * 0x9e3779b97f4a7c15ULL >> 32) & (size-1);
+}
+
+//
+// Return the identifier table entry for the given block address, which is
+// empty if the block has not been seen before
+//
+static riscvBBVEntryP findEntry(riscvBBVP bbv, Uns64 PC) {
+
+    Uns64 key  = PC+1;
+    Uns32 size = bbv->entriesSize;
+    Uns32 i    = hashBlockPC(PC, size);
+
+    while(bbv->entries[i].PC && (bbv->entries[i].PC!=key)) {
+        i = (i+1) & (size-1);
+    }
+
+    return &bbv->entries[i];
+}
+
+//
+// Double the size of the block identifier table
+//
+static void growEntries(riscvBBVP bbv) {
+
+    riscvBBVEntryP old     = bbv->entries;
+    Uns32          oldSize = bbv->entriesSize;
+    Uns32          i;
+
+    bbv->entriesSize = oldSize ? oldSize*2 : 1024;
+    bbv->entries     = STYPE_CALLOC_N(riscvBBVEntry, bbv->entriesSize);
+
+    for(i=0; i<oldSize; i++) {
+        if(old[i].PC) {
+            *findEntry(bbv, old[i].PC-1) = old[i];
+        }
+    }
+
+    if(old) {
+        STYPE_FREE(old);
+    }
+}
+
+//
+// Double the size of the per-block count arrays
+//
+static void growCounts(riscvBBVP bbv) {
+
+    Uns64 *oldCounts  = bbv->counts;
+    Uns32 *oldTouched = bbv->touched;
+    Uns32  oldSize    = bbv->countsSize;
+
+    bbv->countsSize = oldSize ? oldSize*2 : 1024;
+    bbv->counts     = STYPE_CALLOC_N(Uns64, bbv->countsSize);
+    bbv->touched    = STYPE_CALLOC_N(Uns32, bbv->countsSize);
+
+    if(oldSize) {
+        memcpy(bbv->counts,  oldCounts,  oldSize*sizeof(*oldCounts));
+        memcpy(bbv->touched, oldTouched, oldSize*sizeof(*oldTouched));
+        STYPE_FREE(oldCounts);
+        STYPE_FREE(oldTouched);
+    }
+}
+
+//
+// Parse the list of intervals at which checkpoints are written (numbers
+// separated by commas or spaces)
+//
+static void parseCheckpoints(riscvP riscv, riscvBBVP bbv, const char *list) {
+
+    Uns32 max = 0;
+
+    while(list && *list) {
+
+        char *end;
+        Uns64 value = strtoull(list, &end, 0);
+
+        if(end==list) {
+
+            if((*list!=',') && (*list!=' ')) {
+                vmiMessage("W", CPU_PREFIX "_BBC",
+                    NO_SRCREF_FMT "ignoring invalid BBV checkpoint list '%s'",
+                    NO_SRCREF_ARGS(riscv), list
+                );
+                return;
+            }
+
+            list++;
+
+        } else {
+
+            if(bbv->checkpointsNum==max) {
+
+                Uns64 *old = bbv->checkpoints;
+
+                max = max ? max*2 : 16;
+                bbv->checkpoints = STYPE_CALLOC_N(Uns64, max);
+
+                if(old) {
+                    memcpy(
+                        bbv->checkpoints, old,
+                        bbv->checkpointsNum*sizeof(*old)
+                    );
+                    STYPE_FREE(old);
+                }
+            }
+
+            bbv->checkpoints[bbv->checkpointsNum++] = value;
+
+            list = end;
+        }
+    }
+}
+
+//
+// Is a checkpoint required at the start of the given interval?
+//
+static Bool isCheckpoint(riscvBBVP bbv, Uns64 interval) {
+
+    Uns32 i;
+
+    for(i=0; i<bbv->checkpointsNum; i++) {
+        if(bbv->checkpoints[i]==interval) {
+            return True;
+        }
+    }
+
+    return False;
+}
+
+//
+// Write a checkpoint of the hart state at the start of the current interval to
+// file <bbv_file>.ckpt.<interval>, in the architectural state file format
+// (including CSRs and memory pages written so far), so that simulation can be
+// resumed from it using the warm-start loader stub generator
+//
+static void writeCheckpoint(riscvP riscv, riscvBBVP bbv) {
+
+    char name[1024];
+
+    snprintf(
+        name, sizeof(name), "%s.ckpt."FMT_64u, bbv->name, bbv->intervalIndex
+    );
+
+    riscvStateExportWrite(riscv, name);
+}
+
+//
+// Write the basic block vector for the current interval in SimPoint format
+// and reset counts for the next interval
+//
+static void writeInterval(riscvBBVP bbv) {
+
+    Uns32 i;
+
+    fputc('T', bbv->file);
+
+    for(i=0; i<bbv->touchedNum; i++) {
+
+        Uns32 id = bbv->touched[i];
+
+        fprintf(bbv->file, ":%u:"FMT_64u" ", id, bbv->counts[id]);
+
+        bbv->counts[id] = 0;
+    }
+
+    fputc('\n', bbv->file);
+
+    bbv->touchedNum = 0;
+}
+
+//
+// Attribute instructions executed since the last block entry to the last
+// block entered
+//
+static void updateLastBlock(riscvBBVP bbv, Uns64 iCount) {
+
+    Uns32 id    = bbv->lastId;
+    Uns64 delta = iCount - bbv->lastICount;
+
+    if(id && delta) {
+
+        if(!bbv->counts[id]) {
+            bbv->touched[bbv->touchedNum++] = id;
+        }
+
+        bbv->counts[id] += delta;
+    }
+
+    bbv->lastICount = iCount;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// PUBLIC INTERFACE
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Allocate basic block vector profiling structures if a BBV file is
+// configured
+//
+void riscvBBVNew(riscvP riscv) {
+
+    riscvConfigCP cfg  = &riscv->configInfo;
+    const char   *name = cfg->bbv_file;
+
+    if(name && name[0]) {
+
+        // harts of a multicore processor write separate files
+        char  buffer[1024];
+        FILE *file;
+
+        if(riscv->parent) {
+            snprintf(
+                buffer, sizeof(buffer), "%s.hart"FMT_64u, name,
+                (Uns64)RD_CSR(riscv, mhartid)
+            );
+            name = buffer;
+        }
+
+        if(!(file=fopen(name, "w"))) {
+
+            vmiMessage("E", CPU_PREFIX "_BBF",
+                NO_SRCREF_FMT "cannot create BBV file '%s'",
+                NO_SRCREF_ARGS(riscv), name
+            );
+
+        } else {
+
+            riscvBBVP bbv = STYPE_CALLOC(riscvBBV);
+
+            bbv->file        = file;
+            bbv->name        = copyString(name);
+            bbv->interval    = cfg->bbv_interval;
+            bbv->intervalEnd = cfg->bbv_interval;
+            bbv->nextId      = 1;
+
+            growEntries(bbv);
+            growCounts(bbv);
+            parseCheckpoints(riscv, bbv, cfg->bbv_checkpoints);
+
+            riscv->bbv = bbv;
+        }
+    }
+}
+
+//
+// Return the block identifier (from 1) of the block starting at the given
+// address, allocating it if this is the first translation of that block
+//
+Uns32 riscvBBVBlockId(riscvP riscv, Uns64 PC) {
+
+    riscvBBVP      bbv = riscv->bbv;
+    riscvBBVEntryP entry;
+
+    // keep table at most half full
+    if((bbv->entriesUsed*2)>=bbv->entriesSize) {
+        growEntries(bbv);
+    }
+
+    entry = findEntry(bbv, PC);
+
+    if(!entry->PC) {
+
+        // keep identifiers addressable in the count arrays
+        if(bbv->nextId>=bbv->countsSize) {
+            growCounts(bbv);
+        }
+
+        entry->PC = PC+1;
+        entry->id = bbv->nextId++;
+        bbv->entriesUsed++;
+    }
+
+    return entry->id;
+}
+
+//
+// Are any BBV checkpoints configured?
+//
+Bool riscvBBVHasCheckpoints(riscvP riscv) {
+    return riscv->bbv->checkpointsNum ? True : False;
+}
+
+//
+// Called on entry to the block with the given identifier
+//
+void riscvBBVBlock(riscvP riscv, Uns32 id) {
+
+    riscvBBVP bbv    = riscv->bbv;
+    Uns64     iCount = vmirtGetExecutedICount((vmiProcessorP)riscv);
+
+    // attribute instructions executed since the last block entry
+    updateLastBlock(bbv, iCount);
+
+    if(!bbv->started) {
+
+        // checkpoint at start of the first interval if required
+        bbv->started = True;
+
+        if(isCheckpoint(bbv, 0)) {
+            writeCheckpoint(riscv, bbv);
+        }
+
+    } else if(iCount>=bbv->intervalEnd) {
+
+        // interval boundaries are at block entry, so intervals may be
+        // slightly longer than the specified interval
+        writeInterval(bbv);
+
+        bbv->intervalEnd = iCount + bbv->interval;
+        bbv->intervalIndex++;
+
+        if(isCheckpoint(bbv, bbv->intervalIndex)) {
+            writeCheckpoint(riscv, bbv);
+        }
+    }
+
+    bbv->lastId = id;
+}
+
+//
+// Write the final interval and free basic block vector profiling structures
+//
+void riscvBBVFree(riscvP riscv) {
+
+    riscvBBVP bbv = riscv->bbv;
+
+    if(bbv) {
+
+        // attribute instructions executed by the last block entered
+        updateLastBlock(bbv, vmirtGetExecutedICount((vmiProcessorP)riscv));
+
+        // write any partial final interval
+        if(bbv->touchedNum) {
+            writeInterval(bbv);
+        }
+
+        fclose(bbv->file);
+
+        STYPE_FREE(bbv->entries);
+        STYPE_FREE(bbv->counts);
+        STYPE_FREE(bbv->touched);
+        STYPE_FREE(bbv->name);
+
+        if(bbv->checkpoints) {
+            STYPE_FREE(bbv->checkpoints);
+        }
+
+        STYPE_FREE(bbv);
+
+        riscv->bbv = 0;
+    }
+}
+
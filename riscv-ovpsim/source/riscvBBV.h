@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2005-2020 Imperas Software Ltd., www.imperas.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied.
+ *
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#pragma once
+
+// Imperas header files
+#include "hostapi/impTypes.h"
+
+// model header files
+#include "riscvTypeRefs.h"
+
+//
+// Allocate basic block vector profiling structures if a BBV file is
+// configured
+//
+void riscvBBVNew(riscvP riscv);
+
+//
+// Return the block identifier (from 1) of the block starting at the given
+// address, allocating it if this is the first translation of that block
+//
+Uns32 riscvBBVBlockId(riscvP riscv, Uns64 PC);
+
+//
+// Are any BBV checkpoints configured?
+//
+Bool riscvBBVHasCheckpoints(riscvP riscv);
+
+//
+// Called on entry to the block with the given identifier
+//
+void riscvBBVBlock(riscvP riscv, Uns32 id);
+
+//
+// Write the final interval and free basic block vector profiling structures
+//
+void riscvBBVFree(riscvP riscv);
+
@@ -94,6 +94,19 @@ typedef struct riscvBlockStateS {
     riscvVLClassMt   VLClassMt;     // known active vector VL zero/non-zero/max
     Uns32            VZeroTopMt[2]; // known vector registers with zero top
     Bool             VStartZeroMt;  // vstart known to be zero?
+    Uns64            timingLine;    // fetch line modelled (plus one, timing)
+    Uns32            timingCycles;  // cycles not yet committed (timing)
+    Uns32            timingBatch;   // events not yet processed (timing)
+    Uns64            spinStartPC;   // first instruction address (spin loop)
+    Uns32            spinInstructions;// instructions translated (spin loop)
+    Bool             spinLoop;      // is block a candidate spin loop?
+    Bool             statsBlockStart;// block start not yet recorded (stats)
+    Bool             bbvBlockStart; // block entry not yet instrumented (BBV)
+    Uns64            pmKeyPC;       // block address plus one (pmKey tracking)
+    Bool             pmKeyUsed;     // is block polymorphic? (pmKey tracking)
+    Bool             pmKeyRecorded; // polymorphic block recorded?
+    Bool             pmKeyLimited;  // key specialization limited?
+    Uns64            pmKeyLimitPC;  // key-dependent address plus one (limited)
 
 } riscvBlockState;
 
@@ -17,6 +17,12 @@
  *
  */
 
+// Standard header files
+#include <string.h>     // for memset
+
+// Imperas header files
+#include "hostapi/impAlloc.h"
+
 // VMI header files
 #include "vmi/vmiMessage.h"
 #include "vmi/vmiMt.h"
@@ -24,13 +30,16 @@
 
 // model header files
 #include "riscvBus.h"
+#include "riscvCluster.h"
 #include "riscvCSR.h"
 #include "riscvCSRTypes.h"
 #include "riscvExceptions.h"
 #include "riscvMessage.h"
 #include "riscvMorph.h"
 #include "riscvRegisters.h"
+#include "riscvStats.h"
 #include "riscvStructure.h"
+#include "riscvTiming.h"
 #include "riscvVariant.h"
 #include "riscvUtils.h"
 #include "riscvVM.h"
@@ -997,6 +1006,48 @@ static RISCV_CSR_WRITEFN(uieW) {
     return ieW(riscv, newValue, getUIRMask(riscv), useCLICU(riscv));
 }
 
+//
+// Write exception delegation register
+//
+#define EDELEG_W(_P, _R, _VALUE) { \
+                                                            \
+    Uns64 oldValue = RD_CSR(_P, _R);                        \
+    Uns64 mask     = RD_CSR_MASK(_P, _R);                   \
+                                                            \
+    /* get new value using writable bit mask */             \
+    _VALUE = ((_VALUE & mask) | (oldValue & ~mask));        \
+                                                            \
+    /* update the CSR */                                    \
+    WR_CSR(_P, _R, _VALUE);                                 \
+                                                            \
+    /* trap target state depends on exception delegation */ \
+    if(oldValue!=_VALUE) {                                  \
+        riscvInvalidateTrapCache(_P);                       \
+    }                                                       \
+}
+
+//
+// Write medeleg
+//
+static RISCV_CSR_WRITEFN(medelegW) {
+
+    EDELEG_W(riscv, medeleg, newValue);
+
+    // return written value
+    return newValue;
+}
+
+//
+// Write sedeleg
+//
+static RISCV_CSR_WRITEFN(sedelegW) {
+
+    EDELEG_W(riscv, sedeleg, newValue);
+
+    // return written value
+    return newValue;
+}
+
 //
 // Write mideleg
 //
@@ -1013,6 +1064,7 @@ static RISCV_CSR_WRITEFN(midelegW) {
 
     // handle any interrupts that are now pending and enabled
     if(oldValue!=newValue) {
+        riscvInvalidateTrapCache(riscv);
         riscvTestInterrupt(riscv);
     }
 
@@ -1036,6 +1088,7 @@ static RISCV_CSR_WRITEFN(sidelegW) {
 
     // handle any interrupts that are now pending and enabled
     if(oldValue!=newValue) {
+        riscvInvalidateTrapCache(riscv);
         riscvTestInterrupt(riscv);
     }
 
@@ -1576,6 +1629,9 @@ static Uns64 tvecW(riscvP riscv, Uns64 newValue, Uns64 oldValue, Uns64 mask) {
         /* handle interrupts that are now pending */        \
         riscvUpdatePending(_P);                             \
     }                                                       \
+                                                            \
+    /* trap target state depends on xtvec */                \
+    riscvInvalidateTrapCache(_P);                           \
 }
 
 //
@@ -1626,6 +1682,59 @@ static RISCV_CSR_WRITEFN(utvecW) {
     return newValue;
 }
 
+//
+// Update xtvt, invalidating cached trap target state if it changes
+//
+#define UPDATE_TVT(_P, _x, _NEW) {                                  \
+                                                                    \
+    Uns64 oldValue = RD_CSR(_P, _x##tvt);                           \
+    Uns64 mask     = RD_CSR_MASK(_P, _x##tvt);                      \
+                                                                    \
+    /* get new value using writable bit mask */                     \
+    _NEW = ((_NEW & mask) | (oldValue & ~mask));                    \
+                                                                    \
+    /* update the CSR */                                            \
+    WR_CSR(_P, _x##tvt, _NEW);                                      \
+                                                                    \
+    /* trap target state (SHV table base) depends on xtvt */        \
+    if(oldValue!=_NEW) {                                            \
+        riscvInvalidateTrapCache(_P);                               \
+    }                                                               \
+}
+
+//
+// Write mtvt
+//
+static RISCV_CSR_WRITEFN(mtvtW) {
+
+    UPDATE_TVT(riscv, m, newValue);
+
+    // return written value
+    return newValue;
+}
+
+//
+// Write stvt
+//
+static RISCV_CSR_WRITEFN(stvtW) {
+
+    UPDATE_TVT(riscv, s, newValue);
+
+    // return written value
+    return newValue;
+}
+
+//
+// Write utvt
+//
+static RISCV_CSR_WRITEFN(utvtW) {
+
+    UPDATE_TVT(riscv, u, newValue);
+
+    // return written value
+    return newValue;
+}
+
 
 ////////////////////////////////////////////////////////////////////////////////
 // PERFORMANCE MONITOR REGISTERS
@@ -1732,10 +1841,14 @@ inline static Uns64 getXLENValue(riscvP riscv, Uns64 result) {
 }
 
 //
-// Return current cycle count
+// Return current cycle count (modelled cycles if the timing model is enabled)
 //
 inline static Uns64 getCycles(riscvP riscv) {
-    return vmirtGetICount((vmiProcessorP)riscv);
+    if(riscv->timing) {
+        return riscv->timingCycles;
+    } else {
+        return vmirtGetICount((vmiProcessorP)riscv);
+    }
 }
 
 //
@@ -1786,7 +1899,9 @@ static Uns64 cycleR(riscvP riscv) {
 
 //
 // Common routine to write cycle counter (NOTE: count is notionally incremented
-// *before* the write if this is the result of a CSR write)
+// *before* the write if this is the result of a CSR write; with the timing
+// model, the latency of the writing instruction has already been committed
+// before it executes, so no adjustment is required)
 //
 static void cycleW(riscvP riscv, Uns64 newValue, Bool preIncrement) {
 
@@ -1794,7 +1909,7 @@ static void cycleW(riscvP riscv, Uns64 newValue, Bool preIncrement) {
 
         newValue = getCycles(riscv) - newValue;
 
-        if(preIncrement && !riscv->artifactAccess) {
+        if(preIncrement && !riscv->artifactAccess && !riscv->timing) {
             newValue++;
         }
     }
@@ -1859,10 +1974,15 @@ static RISCV_CSR_WRITEFN(mcyclehW) {
 }
 
 //
-// Common routine to read time
+// Common routine to read time (derived from modelled cycles if the timing
+// model is enabled)
 //
 static Uns64 timeR(riscvP riscv) {
-    return (Uns64)(1000000*vmirtGetMonotonicTime((vmiProcessorP)riscv));
+    if(riscv->timing) {
+        return riscvTimingTime(riscv);
+    } else {
+        return (Uns64)(1000000*vmirtGetMonotonicTime((vmiProcessorP)riscv));
+    }
 }
 
 //
@@ -2021,27 +2141,72 @@ static RISCV_CSR_WRITEFN(mcountinhibitW) {
 }
 
 //
-// Read unimplemented performance monitor register
+// Is this an mhpmevent register?
+//
+inline static Bool isHPMEvent(riscvCSRAttrsCP attrs) {
+    return (getCSRNum(attrs) & ~0x1f) == 0x320;
+}
+
+//
+// Is this the upper half of a performance monitor counter?
+//
+inline static Bool isHPMUpper(riscvCSRAttrsCP attrs) {
+    return getCSRNum(attrs) & 0x80;
+}
+
+//
+// Read performance monitor register (implemented only if the timing model is
+// enabled, otherwise reads as zero)
 //
 static RISCV_CSR_READFN(mhpmR) {
 
-    if(hpmAccessValid(attrs, riscv)) {
+    Uns64 result = 0;
+    Uns32 index  = getCSRNum(attrs) & 0x1f;
+
+    if(!hpmAccessValid(attrs, riscv) || !riscv->timing) {
         // no action
+    } else if(isHPMEvent(attrs)) {
+        result = riscvTimingReadHPMEvent(riscv, index);
+    } else if(isHPMUpper(attrs)) {
+        result = riscvTimingReadHPM(riscv, index) >> 32;
+    } else {
+        result = getXLENValue(riscv, riscvTimingReadHPM(riscv, index));
     }
 
-    return 0;
+    return result;
 }
 
 //
-// Write unimplemented performance monitor register
+// Write performance monitor register (implemented only if the timing model is
+// enabled, otherwise ignored)
 //
 static RISCV_CSR_WRITEFN(mhpmW) {
 
-    if(hpmAccessValid(attrs, riscv)) {
-        // no action
+    Uns32 index = getCSRNum(attrs) & 0x1f;
+
+    if(!hpmAccessValid(attrs, riscv) || !riscv->timing) {
+
+        newValue = 0;
+
+    } else if(isHPMEvent(attrs)) {
+
+        riscvTimingWriteHPMEvent(riscv, index, newValue);
+        newValue = riscvTimingReadHPMEvent(riscv, index);
+
+    } else {
+
+        Uns64 oldValue = riscvTimingReadHPM(riscv, index);
+
+        if(isHPMUpper(attrs)) {
+            riscvTimingWriteHPM(riscv, index, setUpper(newValue, oldValue));
+        } else if(RISCV_XLEN_IS_32(riscv)) {
+            riscvTimingWriteHPM(riscv, index, setLower(newValue, oldValue));
+        } else {
+            riscvTimingWriteHPM(riscv, index, newValue);
+        }
     }
 
-    return 0;
+    return newValue;
 }
 
 
@@ -2094,6 +2259,11 @@ static RISCV_CSR_WRITEFN(satpW) {
 
         // change in SATP.ASID affects effective ASID
         riscvVMSetASID(riscv);
+
+        // change of address space invalidates timing model TLB and caches
+        if(riscv->timing && (RD_CSR(riscv, satp)!=old)) {
+            riscvTimingInvalidateAddressSpace(riscv);
+        }
     }
 
     // return written value
@@ -2590,7 +2760,7 @@ static const riscvCSRAttrs csrs[CSR_ID(LAST)] = {
     CSR_ATTR_P__     (fcsr,         0x003, ISA_DFV,     ISA_FS,     1_10,   1,0,0,0,0, "Floating-Point Control and Status",             0,      riscvWFS,    fcsrR,        0,        fcsrW         ),
     CSR_ATTR_P__     (uie,          0x004, ISA_N,       0,          1_10,   1,0,0,0,0, "User Interrupt Enable",                         0,      0,           uieR,         0,        uieW          ),
     CSR_ATTR_T__     (utvec,        0x005, ISA_N,       0,          1_10,   0,0,0,0,0, "User Trap-Vector Base-Address",                 0,      0,           0,            0,        utvecW        ),
-    CSR_ATTR_TV_     (utvt,         0x007, ISA_N,       0,          1_10,   0,0,0,0,0, "User CLIC Trap-Vector Base-Address",            clicP,  0,           0,            0,        0             ),
+    CSR_ATTR_TV_     (utvt,         0x007, ISA_N,       0,          1_10,   0,0,0,0,0, "User CLIC Trap-Vector Base-Address",            clicP,  0,           0,            0,        utvtW         ),
     CSR_ATTR_TV_     (vstart,       0x008, ISA_V,       0,          1_10,   0,0,0,0,0, "Vector Start Index",                            0,      riscvWVStart,0,            0,        0             ),
     CSR_ATTR_TC_     (vxsat,        0x009, ISA_V,       ISA_FSandV, 1_10,   0,0,0,0,0, "Fixed-Point Saturate Flag",                     0,      riscvWFSVS,  vxsatR,       0,        vxsatW        ),
     CSR_ATTR_TC_     (vxrm,         0x00A, ISA_V,       ISA_FSandV, 1_10,   0,0,0,0,0, "Fixed-Point Rounding Mode",                     0,      riscvWFSVS,  0,            0,        vxrmW         ),
@@ -2618,12 +2788,12 @@ static const riscvCSRAttrs csrs[CSR_ID(LAST)] = {
 
     //                name          num    arch         access      version   attrs    description                                      present wState       rCB           rwCB      wCB
     CSR_ATTR_P__     (sstatus,      0x100, ISA_S,       0,          1_10,   0,0,0,0,0, "Supervisor Status",                             0,      riscvRstFS,  sstatusR,     0,        sstatusW      ),
-    CSR_ATTR_TV_     (sedeleg,      0x102, ISA_SandN,   0,          1_10,   0,0,0,0,0, "Supervisor Exception Delegation",               0,      0,           0,            0,        0             ),
+    CSR_ATTR_TV_     (sedeleg,      0x102, ISA_SandN,   0,          1_10,   0,0,0,0,0, "Supervisor Exception Delegation",               0,      0,           0,            0,        sedelegW      ),
     CSR_ATTR_T__     (sideleg,      0x103, ISA_SandN,   0,          1_10,   1,0,0,0,0, "Supervisor Interrupt Delegation",               0,      0,           0,            0,        sidelegW      ),
     CSR_ATTR_P__     (sie,          0x104, ISA_S,       0,          1_10,   1,0,0,0,0, "Supervisor Interrupt Enable",                   0,      0,           sieR,         0,        sieW          ),
     CSR_ATTR_T__     (stvec,        0x105, ISA_S,       0,          1_10,   0,0,0,0,0, "Supervisor Trap-Vector Base-Address",           0,      0,           0,            0,        stvecW        ),
     CSR_ATTR_TV_     (scounteren,   0x106, ISA_S,       0,          1_10,   0,0,0,0,0, "Supervisor Counter Enable",                     0,      0,           0,            0,        0             ),
-    CSR_ATTR_TV_     (stvt,         0x107, ISA_S,       0,          1_10,   0,0,0,0,0, "Supervisor CLIC Trap-Vector Base-Address",      clicP,  0,           0,            0,        0             ),
+    CSR_ATTR_TV_     (stvt,         0x107, ISA_S,       0,          1_10,   0,0,0,0,0, "Supervisor CLIC Trap-Vector Base-Address",      clicP,  0,           0,            0,        stvtW         ),
     CSR_ATTR_T__     (sscratch,     0x140, ISA_S,       0,          1_10,   0,0,0,0,0, "Supervisor Scratch",                            0,      0,           0,            0,        0             ),
     CSR_ATTR_TV_     (sepc,         0x141, ISA_S,       0,          1_10,   0,0,0,0,0, "Supervisor Exception Program Counter",          0,      0,           sepcR,        0,        0             ),
     CSR_ATTR_T__     (scause,       0x142, ISA_S,       0,          1_10,   0,0,0,0,0, "Supervisor Cause",                              0,      0,           scauseR,      0,        scauseW       ),
@@ -2643,12 +2813,12 @@ static const riscvCSRAttrs csrs[CSR_ID(LAST)] = {
     CSR_ATTR_T__     (mhartid,      0xF14, 0,           0,          1_10,   0,0,0,0,0, "Hardware Thread ID",                            0,      0,           0,            0,        0             ),
     CSR_ATTR_TV_     (mstatus,      0x300, 0,           0,          1_10,   0,0,0,0,0, "Machine Status",                                0,      riscvRstFS,  mstatusR,     0,        mstatusW      ),
     CSR_ATTR_T__     (misa,         0x301, 0,           0,          1_10,   1,0,0,0,0, "ISA and Extensions",                            0,      0,           0,            0,        misaW         ),
-    CSR_ATTR_TV_     (medeleg,      0x302, ISA_SorN,    0,          1_10,   0,0,0,0,0, "Machine Exception Delegation",                  0,      0,           0,            0,        0             ),
+    CSR_ATTR_TV_     (medeleg,      0x302, ISA_SorN,    0,          1_10,   0,0,0,0,0, "Machine Exception Delegation",                  0,      0,           0,            0,        medelegW      ),
     CSR_ATTR_T__     (mideleg,      0x303, ISA_SorN,    0,          1_10,   1,0,0,0,0, "Machine Interrupt Delegation",                  0,      0,           0,            0,        midelegW      ),
     CSR_ATTR_T__     (mie,          0x304, 0,           0,          1_10,   1,0,0,0,0, "Machine Interrupt Enable",                      0,      0,           mieR,         0,        mieW          ),
     CSR_ATTR_T__     (mtvec,        0x305, 0,           0,          1_10,   0,0,0,0,0, "Machine Trap-Vector Base-Address",              0,      0,           0,            0,        mtvecW        ),
     CSR_ATTR_TV_     (mcounteren,   0x306, ISA_U,       0,          1_10,   0,0,0,0,0, "Machine Counter Enable",                        0,      0,           0,            0,        0             ),
-    CSR_ATTR_TV_     (mtvt,         0x307, 0,           0,          1_10,   0,0,0,0,0, "Machine CLIC Trap-Vector Base-Address",         clicP,  0,           0,            0,        0             ),
+    CSR_ATTR_TV_     (mtvt,         0x307, 0,           0,          1_10,   0,0,0,0,0, "Machine CLIC Trap-Vector Base-Address",         clicP,  0,           0,            0,        mtvtW         ),
     CSR_ATTR_TV_     (mstatush,     0x310, ISA_XLEN_32, 0,          1_12,   0,0,0,0,0, "Machine Status High",                           0,      0,           0,            0,        mstatushW     ),
     CSR_ATTR_TV_     (mcountinhibit,0x320, 0,           0,          1_11,   0,0,0,0,0, "Machine Counter Inhibit",                       0,      0,           0,            0,        mcountinhibitW),
     CSR_ATTR_T__     (mscratch,     0x340, 0,           0,          1_10,   0,0,0,0,0, "Machine Scratch",                               0,      0,           0,            0,        0             ),
@@ -2921,17 +3091,143 @@ static Uns64 getCSRWriteMask(riscvCSRAttrsCP attrs, riscvP riscv) {
 }
 
 //
-// Return riscvCSRAttrsCP got table entry
+// Number of entries in the CSR address space (CSR index is 12 bits)
 //
-inline static riscvCSRAttrsCP getEntryCSRAttrs(vmiRangeEntryP entry) {
+#define CSR_NUM 4096
 
-    riscvCSRAttrsCP result = 0;
+//
+// CSR lookup table, indexed directly by CSR number, with a compact list of
+// registered CSRs in index order for iteration; the table may be shared
+// read-only between harts with the same configuration
+//
+typedef struct riscvCSRTableS {
+    Uns32           refCount;       // number of references to this table
+    Uns32           num;            // number of registered CSRs
+    riscvCSRAttrsCP map [CSR_NUM];  // CSR attributes indexed by CSR number
+    riscvCSRAttrsCP list[CSR_NUM];  // registered CSRs in index order
+    Uns16           pos [CSR_NUM];  // position of each CSR in list
+} riscvCSRTable;
 
-    if(entry) {
-        result = (riscvCSRAttrsCP)(UnsPS)vmirtGetRangeEntryUserData(entry);
+//
+// Allocate a new CSR table, optionally copying an existing one
+//
+static riscvCSRTableP newCSRTable(riscvCSRTableP old) {
+
+    riscvCSRTableP table = STYPE_CALLOC(riscvCSRTable);
+
+    if(old) {
+        *table = *old;
     }
 
-    return result;
+    table->refCount = 1;
+
+    return table;
+}
+
+//
+// Add a reference to a CSR table
+//
+inline static riscvCSRTableP refCSRTable(riscvCSRTableP table) {
+
+    table->refCount++;
+
+    return table;
+}
+
+//
+// Remove a reference to a CSR table, freeing it when no longer used
+//
+static void unrefCSRTable(riscvCSRTableP table) {
+
+    if(table && !--table->refCount) {
+        STYPE_FREE(table);
+    }
+}
+
+//
+// Return any SMP container whose members share a CSR table with the given hart
+//
+inline static riscvP getSMPParent(riscvP riscv) {
+
+    riscvP parent = riscv->parent;
+
+    return (parent && !riscvIsCluster(parent)) ? parent : 0;
+}
+
+//
+// Return the CSR table shared by harts with the same configuration as the
+// given hart (SMP siblings) if it has been published, or a new table
+//
+static riscvCSRTableP getSharedCSRTable(riscvP riscv) {
+
+    riscvP parent = getSMPParent(riscv);
+
+    if(parent && parent->csrTable) {
+
+        // later SMP members share the table built by the first one
+        return refCSRTable(parent->csrTable);
+
+    } else {
+
+        // first SMP member (or hart without siblings) builds a new table
+        return newCSRTable(0);
+    }
+}
+
+//
+// Publish the CSR table of the first SMP member to its container once all
+// standard CSRs are registered, so that siblings share it; check that later
+// members have indeed shared the published table
+//
+static void publishCSRTable(riscvP riscv) {
+
+    riscvP parent = getSMPParent(riscv);
+
+    if(!parent) {
+
+        // no action
+
+    } else if(!parent->csrTable) {
+
+        parent->csrTable = refCSRTable(riscv->csrTable);
+
+    } else {
+
+        VMI_ASSERT(
+            riscv->csrTable==parent->csrTable,
+            "SMP member has not shared CSR table"
+        );
+    }
+}
+
+//
+// Release the CSR table published to the SMP container of the given hart if
+// no member still references it
+//
+static void unpublishCSRTable(riscvP riscv) {
+
+    riscvP parent = getSMPParent(riscv);
+
+    if(parent && parent->csrTable && (parent->csrTable->refCount==1)) {
+        unrefCSRTable(parent->csrTable);
+        parent->csrTable = 0;
+    }
+}
+
+//
+// Return a CSR table for the hart that may be modified, copying any shared
+// table first
+//
+static riscvCSRTableP getPrivateCSRTable(riscvP riscv) {
+
+    riscvCSRTableP table = riscv->csrTable;
+
+    if(table->refCount>1) {
+        riscv->csrTable = newCSRTable(table);
+        unrefCSRTable(table);
+    }
+
+    return riscv->csrTable;
 }
 
 //
@@ -2939,28 +3235,46 @@ inline static riscvCSRAttrsCP getEntryCSRAttrs(vmiRangeEntryP entry) {
 //
 void riscvNewCSR(riscvCSRAttrsCP attrs, riscvP riscv) {
 
-    Uns32           csrNum = attrs->csrNum;
-    vmiRangeTablePP tableP = &riscv->csrTable;
-    vmiRangeEntryP  entry  = vmirtGetFirstRangeEntry(tableP, csrNum, csrNum);
+    Uns32 csrNum = attrs->csrNum;
 
-    // create new entry for this CSR if required
-    if(!entry) {
-        entry = vmirtInsertRangeEntry(tableP, csrNum, csrNum, 0);
-    }
+    VMI_ASSERT(csrNum<CSR_NUM, "illegal CSR number 0x%x", csrNum);
+
+    // no action if this CSR is already registered (typical when a table is
+    // shared with other harts)
+    if(riscv->csrTable->map[csrNum]!=attrs) {
+
+        riscvCSRTableP table = getPrivateCSRTable(riscv);
+
+        if(table->map[csrNum]) {
+
+            // replace existing entry in list
+            table->list[table->pos[csrNum]] = attrs;
+
+        } else {
 
-    // register attributes and entry
-    vmirtSetRangeEntryUserData(entry, (UnsPS)attrs);
+            Uns32 i = table->num++;
+
+            // insert new entry in list, maintaining index order
+            for(; i && (table->list[i-1]->csrNum>csrNum); i--) {
+                table->list[i] = table->list[i-1];
+                table->pos[table->list[i]->csrNum] = i;
+            }
+
+            table->list[i]     = attrs;
+            table->pos[csrNum] = i;
+        }
+
+        // register attributes in lookup map
+        table->map[csrNum] = attrs;
+    }
 }
 
 //
 // Return CSR attributes for the given CSR index
 //
-static riscvCSRAttrsCP getCSRAttrs(riscvP riscv, Uns32 csrNum) {
-
-    vmiRangeTablePP tableP = &riscv->csrTable;
-    vmiRangeEntryP  entry  = vmirtGetFirstRangeEntry(tableP, csrNum, csrNum);
+inline static riscvCSRAttrsCP getCSRAttrs(riscvP riscv, Uns32 csrNum) {
 
-    return getEntryCSRAttrs(entry);
+    return riscv->csrTable->map[csrNum & (CSR_NUM-1)];
 }
 
 //
@@ -2968,11 +3282,10 @@ static riscvCSRAttrsCP getCSRAttrs(riscvP riscv, Uns32 csrNum) {
 //
 static riscvCSRAttrsCP getNextCSR(riscvCSRAttrsCP prev, riscvP riscv) {
 
-    Uns32           csrNum = prev ? prev->csrNum+1 : 0;
-    vmiRangeTablePP tableP = &riscv->csrTable;
-    vmiRangeEntryP  entry  = vmirtGetFirstRangeEntry(tableP, csrNum, -1);
+    riscvCSRTableP table = riscv->csrTable;
+    Uns32          i     = prev ? table->pos[prev->csrNum]+1 : 0;
 
-    return getEntryCSRAttrs(entry);
+    return (i<table->num) ? table->list[i] : 0;
 }
 
 
@@ -2994,6 +3307,105 @@ inline static Uns32 getCSRBusAddress(riscvCSRAttrsCP attrs) {
     return attrs->csrNum << 4;
 }
 
+//
+// Offset in CSR slot of caching policy declared by external implementer
+//
+#define CSR_BUS_POLICY_OFFSET 8
+
+//
+// Number of CSR cache entries (one per CSR number)
+//
+#define CSR_CACHE_NUM 4096
+
+//
+// Cached state of externally-implemented CSR
+//
+typedef struct riscvCSRCacheS {
+    Uns64               value;          // cached value
+    riscvCSRCachePolicy policy  : 8;    // declared caching policy
+    Uns8                bits    : 8;    // size of cached value (0 if invalid)
+    Bool                policyV : 1;    // whether policy is valid
+} riscvCSRCache;
+
+//
+// Invalidate all cached external CSR state (values and policies)
+//
+static void invalidateCSRCache(riscvP riscv) {
+    if(riscv->csrCache) {
+        memset(riscv->csrCache, 0, sizeof(riscvCSRCache)*CSR_CACHE_NUM);
+    }
+}
+
+//
+// Return cache entry for externally-implemented CSR, reading any caching
+// policy declared by the external implementer on first use
+//
+static riscvCSRCacheP getCSRCache(
+    riscvCSRAttrsCP attrs,
+    riscvP          riscv,
+    memDomainP      domain
+) {
+    // allocate cache on first use
+    if(!riscv->csrCache) {
+        riscv->csrCache = STYPE_CALLOC_N(riscvCSRCache, CSR_CACHE_NUM);
+    }
+
+    riscvCSRCacheP cache = &riscv->csrCache[attrs->csrNum%CSR_CACHE_NUM];
+
+    if(!cache->policyV) {
+
+        Uns32               address = getCSRBusAddress(attrs);
+        Uns32               policyA = address + CSR_BUS_POLICY_OFFSET;
+        riscvCSRCachePolicy policy  = RVCP_VOLATILE;
+
+        // get policy declared by external implementer (if any)
+        if(
+            vmirtGetDomainMapped(domain, policyA, policyA+3) &&
+            (vmirtGetDomainPrivileges(domain, policyA) & MEM_PRIV_R)
+        ) {
+            policy = vmirtRead4ByteDomain(
+                domain, policyA, MEM_ENDIAN_LITTLE, MEM_AA_FALSE
+            );
+        }
+
+        // ignore unrecognized policies
+        cache->policy  = (policy<RVCP_LAST) ? policy : RVCP_VOLATILE;
+        cache->policyV = True;
+    }
+
+    return cache;
+}
+
+//
+// Return any valid cached value of the given size
+//
+inline static Bool getCSRCacheValue(
+    riscvCSRCacheP cache,
+    Uns32          bits,
+    Uns64         *valueP
+) {
+    if(cache->bits!=bits) {
+        return False;
+    } else {
+        *valueP = cache->value;
+        return True;
+    }
+}
+
+//
+// Update cached value if the caching policy allows it
+//
+inline static void setCSRCacheValue(
+    riscvCSRCacheP cache,
+    Uns32          bits,
+    Uns64          value
+) {
+    if(cache->policy!=RVCP_VOLATILE) {
+        cache->value = value;
+        cache->bits  = bits;
+    }
+}
+
 //
 // Do externally-implemented 32-bit CSR read
 //
@@ -3003,11 +3415,17 @@ static RISCV_CSR_READFN(csrExternalRead32) {
     memEndian      endian   = MEM_ENDIAN_LITTLE;
     memAccessAttrs memAttrs = getCSRMemAttrs(riscv);
     Uns32          address  = getCSRBusAddress(attrs);
+    Uns64          result;
 
     riscv->externalActive = True;
 
-    // do read from external system domain
-    Uns32 result = vmirtRead4ByteDomain(domain, address, endian, memAttrs);
+    riscvCSRCacheP cache = getCSRCache(attrs, riscv, domain);
+
+    // do read from external system domain unless cached
+    if(!getCSRCacheValue(cache, 32, &result)) {
+        result = vmirtRead4ByteDomain(domain, address, endian, memAttrs);
+        setCSRCacheValue(cache, 32, result);
+    }
 
     riscv->externalActive = False;
 
@@ -3024,14 +3442,27 @@ static RISCV_CSR_WRITEFN(csrExternalWrite32) {
     memEndian      endian   = MEM_ENDIAN_LITTLE;
     memAccessAttrs memAttrs = getCSRMemAttrs(riscv);
     Uns32          address  = getCSRBusAddress(attrs);
+    Uns64          result;
 
     riscv->externalActive = True;
 
+    riscvCSRCacheP cache = getCSRCache(attrs, riscv, domain);
+
     // do write to external system domain
     vmirtWrite4ByteDomain(domain, address, endian, newValue, memAttrs);
 
-    // get new value
-    Uns32 result = vmirtRead4ByteDomain(domain, address, endian, MEM_AA_FALSE);
+    if(cache->policy==RVCP_WT_NO_RB) {
+
+        // written value is the new value
+        result = newValue;
+        setCSRCacheValue(cache, 32, result);
+
+    } else if(!getCSRCacheValue(cache, 32, &result)) {
+
+        // get new value
+        result = vmirtRead4ByteDomain(domain, address, endian, MEM_AA_FALSE);
+        setCSRCacheValue(cache, 32, result);
+    }
 
     riscv->externalActive = False;
 
@@ -3048,11 +3479,17 @@ static RISCV_CSR_READFN(csrExternalRead64) {
     memEndian      endian   = MEM_ENDIAN_LITTLE;
     memAccessAttrs memAttrs = getCSRMemAttrs(riscv);
     Uns32          address  = getCSRBusAddress(attrs);
+    Uns64          result;
 
     riscv->externalActive = True;
 
-    // do read from external system domain
-    Uns64 result = vmirtRead8ByteDomain(domain, address, endian, memAttrs);
+    riscvCSRCacheP cache = getCSRCache(attrs, riscv, domain);
+
+    // do read from external system domain unless cached
+    if(!getCSRCacheValue(cache, 64, &result)) {
+        result = vmirtRead8ByteDomain(domain, address, endian, memAttrs);
+        setCSRCacheValue(cache, 64, result);
+    }
 
     riscv->externalActive = False;
 
@@ -3069,14 +3506,27 @@ static RISCV_CSR_WRITEFN(csrExternalWrite64) {
     memEndian      endian   = MEM_ENDIAN_LITTLE;
     memAccessAttrs memAttrs = getCSRMemAttrs(riscv);
     Uns32          address  = getCSRBusAddress(attrs);
+    Uns64          result;
 
     riscv->externalActive = True;
 
+    riscvCSRCacheP cache = getCSRCache(attrs, riscv, domain);
+
     // do write to external system domain
     vmirtWrite8ByteDomain(domain, address, endian, newValue, memAttrs);
 
-    // get new value
-    Uns64 result = vmirtRead8ByteDomain(domain, address, endian, MEM_AA_FALSE);
+    if(cache->policy==RVCP_WT_NO_RB) {
+
+        // written value is the new value
+        result = newValue;
+        setCSRCacheValue(cache, 64, result);
+
+    } else if(!getCSRCacheValue(cache, 64, &result)) {
+
+        // get new value
+        result = vmirtRead8ByteDomain(domain, address, endian, MEM_AA_FALSE);
+        setCSRCacheValue(cache, 64, result);
+    }
 
     riscv->externalActive = False;
 
@@ -3302,6 +3752,12 @@ void riscvCSRReset(riscvP riscv) {
 
     // clear exclusive tag
     riscv->exclusiveTag = RISCV_NO_TAG;
+
+    // trap target state must be recomputed after reset
+    riscvInvalidateTrapCache(riscv);
+
+    // externally-implemented CSR values may change on reset
+    invalidateCSRCache(riscv);
 }
 
 //
@@ -3373,8 +3829,8 @@ void riscvCSRInit(riscvP riscv, Uns32 index) {
     // CSR table support
     //--------------------------------------------------------------------------
 
-    // allocate CSR lookup table
-    vmirtNewRangeTable(&riscv->csrTable);
+    // get CSR lookup table (shared with harts of the same configuration)
+    riscv->csrTable = getSharedCSRTable(riscv);
 
     // allocate CSR message range table
     vmirtNewRangeTable(&riscv->csrUIMessage);
@@ -3386,6 +3842,9 @@ void riscvCSRInit(riscvP riscv, Uns32 index) {
         }
     }
 
+    // share CSR lookup table with later SMP members
+    publishCSRTable(riscv);
+
     //--------------------------------------------------------------------------
     // do initial CSR reset
     //--------------------------------------------------------------------------
@@ -3815,6 +4274,9 @@ void riscvCSRInit(riscvP riscv, Uns32 index) {
 
     // initialize dcsr read-only fields
     WR_CSR_FIELD(riscv, dcsr, xdebugver, 4);
+
+    // trap target state must be recomputed after initialization
+    riscvInvalidateTrapCache(riscv);
 }
 
 //
@@ -3822,11 +4284,21 @@ void riscvCSRInit(riscvP riscv, Uns32 index) {
 //
 void riscvCSRFree(riscvP riscv) {
 
-    // free CSR lookup table
-    vmirtFreeRangeTable(&riscv->csrTable);
+    // release CSR lookup table
+    unrefCSRTable(riscv->csrTable);
+    riscv->csrTable = 0;
+
+    // release table published to SMP container when last member is freed
+    unpublishCSRTable(riscv);
 
     // free CSR message range table
     vmirtFreeRangeTable(&riscv->csrUIMessage);
+
+    // free externally-implemented CSR cache
+    if(riscv->csrCache) {
+        STYPE_FREE(riscv->csrCache);
+        riscv->csrCache = 0;
+    }
 }
 
 
@@ -4154,6 +4626,7 @@ void riscvEmitCSRRead(
         vmimtArgNatAddress(attrs);
         vmimtArgProcessor();
         vmimtCallResult((vmiCallFn)readCB, bits, rd);
+        riscvStatsEmitInc(riscv, RISCV_STATS(csrReadCalls));
         vmimtMoveRR(bits, raw, rd);
 
     } else if(VMI_ISNOREG(raw)) {
@@ -4169,6 +4642,54 @@ void riscvEmitCSRRead(
     }
 }
 
+//
+// Is this CSR from the standard table? (CSRs added or modified by derived
+// models may have block termination requirements not visible here)
+//
+inline static Bool isStandardCSR(riscvCSRAttrsCP attrs) {
+    return (attrs>=csrs) && (attrs<&csrs[CSR_ID(LAST)]);
+}
+
+//
+// Return current translation-relevant state
+//
+static riscvCSRTState getTState(riscvP riscv) {
+
+    riscvCSRTState result = {
+        arch  : riscv->currentArch,
+        mode  : riscv->mode,
+        pmKey : riscv->pmKey
+    };
+
+    return result;
+}
+
+//
+// Save translation-relevant state before a CSR write
+//
+static void saveTState(riscvP riscv) {
+    riscv->csrTState = getTState(riscv);
+}
+
+//
+// Leave the current block after a CSR write if translation-relevant state has
+// changed (the block mask and polymorphic key are validated when the next
+// block is entered)
+//
+static void checkTState(riscvP riscv) {
+
+    riscvCSRTState old = riscv->csrTState;
+    riscvCSRTState new = getTState(riscv);
+
+    if(
+        (old.arch  != new.arch)  ||
+        (old.mode  != new.mode)  ||
+        (old.pmKey != new.pmKey)
+    ) {
+        vmirtDoSynchronousInterrupt((vmiProcessorP)riscv);
+    }
+}
+
 //
 // Emit code to write a CSR
 //
@@ -4198,13 +4719,27 @@ void riscvEmitCSRWrite(
 
         // emit code to call the write function (NOTE: argument is always 64
         // bits, irrespective of the architecture size)
+        Bool endBlock   = attrs->wEndBlock;
+        Bool endDynamic = endBlock && isStandardCSR(attrs);
+
+        // sample translation-relevant state if block termination is dynamic
+        if(endDynamic) {
+            vmimtArgProcessor();
+            vmimtCall((vmiCallFn)saveTState);
+        }
+
         vmimtArgNatAddress(attrs);
         vmimtArgProcessor();
         vmimtArgRegSimAddress(bits, rs);
         vmimtCallResult((vmiCallFn)writeCB, bits, raw);
-
-        // terminate the current block if required
-        if(attrs->wEndBlock) {
+        riscvStatsEmitInc(riscv, RISCV_STATS(csrWriteCalls));
+
+        // terminate the current block if required (for standard CSRs, only if
+        // translation-relevant state has changed)
+        if(endDynamic) {
+            vmimtArgProcessor();
+            vmimtCall((vmiCallFn)checkTState);
+        } else if(endBlock) {
             vmimtEndBlock();
         }
 
@@ -4230,6 +4765,88 @@ void riscvEmitCSRWrite(
     }
 }
 
+//
+// Update mstatus.MPRV from the passed mstatus value, leaving all other fields
+// unchanged
+//
+static void mstatusMPRVW(riscvP riscv, Uns32 newValue) {
+
+    Uns32 MPRV = (newValue & WM_mstatus_MPRV) ? 1 : 0;
+
+    // no action unless mstatus.MPRV changes
+    if(RD_CSR_FIELD(riscv, mstatus, MPRV) != MPRV) {
+
+        WR_CSR_FIELD(riscv, mstatus, MPRV, MPRV);
+
+        // changes in MSTATUS.MPRV affect current data domain
+        riscvVMRefreshMPRVDomain(riscv);
+
+        // data endianness may depend on data access mode
+        if(riscv->checkEndian) {
+            riscvSetCurrentArch(riscv);
+        }
+    }
+}
+
+//
+// Is a csrs or csrc of this CSR eligible for the mstatus.MPRV fast path? (this
+// applies only to an internally-implemented mstatus write that has not been
+// overridden by a derived model)
+//
+static Bool isMPRVIdiomCSR(riscvCSRAttrsCP attrs, riscvP riscv, Uns32 bits) {
+
+    return (
+        (getCSRWriteCB(attrs, riscv, bits)==mstatusW) &&
+        !attrs->writeRd                               &&
+        (RD_CSR_MASK(riscv, mstatus) & WM_mstatus_MPRV)
+    );
+}
+
+//
+// Emit code to write a CSR using the result of a csrs or csrc instruction with
+// register operand mask
+//
+void riscvEmitCSRWriteSetClear(
+    riscvCSRAttrsCP attrs,
+    riscvP          riscv,
+    vmiReg          rd,
+    vmiReg          rs,
+    vmiReg          tmp,
+    vmiReg          mask
+) {
+    Uns32 bits = riscvGetXlenMode(riscv);
+
+    if(!isMPRVIdiomCSR(attrs, riscv, bits)) {
+
+        // general write
+        riscvEmitCSRWrite(attrs, riscv, rd, rs, tmp);
+
+    } else {
+
+        // M-mode code typically sets and clears mstatus.MPRV around accesses
+        // made using the previous mode; when only that field is selected,
+        // update it directly instead of using the general mstatus write
+        vmiLabelP general = vmimtNewLabel();
+        vmiLabelP done    = vmimtNewLabel();
+
+        // use general write if any field other than mstatus.MPRV is selected
+        vmimtTestRCJumpLabel(bits, vmi_COND_NZ, mask, ~WM_mstatus_MPRV, general);
+
+        // fast path (mstatus.MPRV is in the least-significant word)
+        vmimtRegWriteImpl(attrs->name);
+        vmimtArgProcessor();
+        vmimtArgReg(32, rs);
+        vmimtCall((vmiCallFn)mstatusMPRVW);
+        vmimtUncondJumpLabel(done);
+
+        // general write
+        vmimtInsertLabel(general);
+        riscvEmitCSRWrite(attrs, riscv, rd, rs, tmp);
+
+        vmimtInsertLabel(done);
+    }
+}
+
 
 ////////////////////////////////////////////////////////////////////////////////
 // CSR ITERATOR
@@ -4368,6 +4985,12 @@ void riscvCSRRestore(
                 VMIRT_RESTORE_FIELD(cxt, riscv, csr.mintstatus);
             }
 
+            // trap target state must be recomputed after restore
+            riscvInvalidateTrapCache(riscv);
+
+            // externally-implemented CSR values may change on restore
+            invalidateCSRCache(riscv);
+
             break;
 
         case SRT_END:
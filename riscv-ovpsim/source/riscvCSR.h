@@ -282,6 +282,27 @@ riscvCSRAttrsCP riscvValidateCSRAccess(
     Bool   write
 );
 
+//
+// Translation-relevant state sampled before a CSR write that may require the
+// current block to be terminated
+//
+typedef struct riscvCSRTStateS {
+    riscvArchitecture arch;     // current enabled features (block mask)
+    riscvDMode        mode;     // current processor mode
+    Uns16             pmKey;    // polymorphic key
+} riscvCSRTState;
+
+//
+// Caching policies for externally-implemented CSRs, declared by the external
+// implementer in the word at offset 8 of the CSR slot on the artifact CSR bus
+//
+typedef enum riscvCSRCachePolicyE {
+    RVCP_VOLATILE,      // every access is a bus transaction (default)
+    RVCP_RO_RESET,      // value is constant after reset (read once)
+    RVCP_WT_NO_RB,      // writes are not read back (written value is cached)
+    RVCP_LAST           // KEEP LAST
+} riscvCSRCachePolicy;
+
 //
 // Emit code to read a CSR
 //
@@ -303,6 +324,19 @@ void riscvEmitCSRWrite(
     vmiReg          tmp
 );
 
+//
+// Emit code to write a CSR using the result of a csrs or csrc instruction with
+// register operand mask
+//
+void riscvEmitCSRWriteSetClear(
+    riscvCSRAttrsCP attrs,
+    riscvP          riscv,
+    vmiReg          rd,
+    vmiReg          rs,
+    vmiReg          tmp,
+    vmiReg          mask
+);
+
 
 ////////////////////////////////////////////////////////////////////////////////
 // CSR ITERATOR AND REGISTRATION
@@ -590,6 +624,7 @@ typedef CSR_REG_TYPE(status) CSR_REG_TYPE(mstatus);
 
 // define bit masks
 #define WM_mstatus_FS   (3<<13)
+#define WM_mstatus_MPRV (1<<17)
 #define WM_mstatus_TVM  (1<<20)
 #define WM_mstatus_TW   (1<<21)
 #define WM_mstatus_TSR  (1<<22)
@@ -102,10 +102,13 @@ typedef struct riscvConfigS {
     Bool              Zvamo;            // Zvamo implemented?
     Bool              Zvediv;           // Zvediv implemented?
     Bool              Zvqmac;           // Zvqmac implemented?
+    Bool              lazy_tail_zero;   // defer zeroing of vector tails?
+    Uns32             pm_key_variants;  // block key variants before fallback
     Bool              unitStrideOnly;   // only unit-stride operations supported
     Bool              noFaultOnlyFirst; // fault-only-first instructions absent?
     Bool              updatePTEA;       // hardware update of PTE A bit?
     Bool              updatePTED;       // hardware update of PTE D bit?
+    Uns32             tlb_prefetch;     // neighbouring TLB entries per walk
     Bool              unaligned;        // whether unaligned accesses supported
     Bool              unalignedAMO;     // whether AMO supports unaligned
     Bool              wfi_is_nop;       // whether WFI is treated as NOP
@@ -133,6 +136,63 @@ typedef struct riscvConfigS {
     Bool              CLICMNXTI;		// mnxti CSR implemented?
     Bool              CLICMCSW;			// mscratchcs* CSRs implemented?
 
+    // timing model configuration
+    Bool              timing_model;     // whether timing model enabled
+    Uns32             timing_lat_alu;   // integer ALU instruction latency
+    Uns32             timing_lat_mul;   // integer multiply latency
+    Uns32             timing_lat_div;   // integer divide latency
+    Uns32             timing_lat_load;  // load latency (cache hit)
+    Uns32             timing_lat_store; // store latency (cache hit)
+    Uns32             timing_lat_branch;// conditional branch latency
+    Uns32             timing_lat_jump;  // unconditional jump latency
+    Uns32             timing_lat_fp;    // floating point operation latency
+    Uns32             timing_lat_fdiv;  // floating point divide/sqrt latency
+    Uns32             timing_lat_system;// system/CSR instruction latency
+    Uns32             timing_lat_vector;// vector instruction latency
+    Uns32             timing_icache_size;// L1 instruction cache size (bytes)
+    Uns32             timing_dcache_size;// L1 data cache size (bytes)
+    Uns32             timing_cache_line;// cache line size (bytes)
+    Uns32             timing_cache_ways;// cache associativity
+    Uns32             timing_cache_miss;// cache miss penalty
+    Uns32             timing_tlb_entries;// TLB entries
+    Uns32             timing_tlb_miss;  // TLB miss penalty
+    Uns32             timing_bp_entries;// branch predictor entries
+    Uns32             timing_mispredict;// branch misprediction penalty
+    Uns32             timing_time_divisor;// cycles per time CSR tick
+
+    // spin loop detection configuration
+    Uns32             spin_loop_limit;  // iterations before termination
+    Uns32             spin_loop_exit_code;// exit code on termination
+
+    // fork server configuration
+    Bool              fork_server;      // whether fork server mode enabled
+    const char       *fork_marker;      // symbol at which to fork
+    const char       *fork_payloads;    // file listing payload files
+    Uns64             fork_payload_address;// payload load address
+
+    // HTIF device configuration
+    Bool              htif;             // whether HTIF device enabled
+    Uns64             htif_mmap_base;   // HTIF mmap window base address
+    Uns64             htif_mmap_size;   // HTIF mmap window size (0 if none)
+
+    // statistics configuration
+    Bool              statistics;       // whether statistics enabled
+    const char       *statistics_file;  // JSON statistics file (or log)
+
+    // live metrics configuration
+    const char       *metrics_file;     // live metrics file (if any)
+    Uns32             metrics_interval; // instructions between updates
+
+    // basic block vector profiling configuration
+    const char       *bbv_file;         // SimPoint .bb file (if any)
+    Uns64             bbv_interval;     // instructions per interval
+    const char       *bbv_checkpoints;  // intervals at which to checkpoint
+
+    // architectural state export configuration
+    const char       *export_file;      // state file (if any)
+    Uns64             export_icount;    // instruction count at which to export
+    const char       *export_symbol;    // symbol at which to export
+
     // CSR register values
     struct {
         CSR_REG_DECL (mvendorid);       // mvendorid value
@@ -17,6 +17,9 @@
  *
  */
 
+// standard header files
+#include <string.h>
+
 // Imperas header files
 #include "hostapi/impAlloc.h"
 
@@ -277,6 +280,42 @@ static VMI_REG_WRITE_FN(writeCSR) {
     return ok;
 }
 
+//
+// Return vector register index from register description
+//
+inline static Uns32 getVRIndex(vmiRegInfoCP reg) {
+    return reg->gdbIndex-RISCV_V0_INDEX;
+}
+
+//
+// Read vector register, zeroing all deferred tails first (so that any
+// subsequent direct view of vector state is also consistent)
+//
+static VMI_REG_READ_FN(readVR) {
+
+    riscvP riscv = (riscvP)processor;
+    Uns32  bytes = riscv->configInfo.VLEN/8;
+
+    riscvVMaterializeTails(riscv);
+    memcpy(buffer, riscv->v+getVRIndex(reg)*bytes/4, bytes);
+
+    return True;
+}
+
+//
+// Write vector register, zeroing any deferred tail first
+//
+static VMI_REG_WRITE_FN(writeVR) {
+
+    riscvP riscv = (riscvP)processor;
+    Uns32  bytes = riscv->configInfo.VLEN/8;
+
+    riscvVObserveTail(riscv, getVRIndex(reg), 1, 0);
+    memcpy(riscv->v+getVRIndex(reg)*bytes/4, buffer, bytes);
+
+    return True;
+}
+
 //
 // Return special purpose of the indexed GPR, if any
 //
@@ -397,6 +436,8 @@ static vmiRegInfoCP getRegisters(riscvP riscv, Bool normal) {
             dst->gdbIndex = i+RISCV_V0_INDEX;
             dst->access   = vmi_RA_RW;
             dst->raw      = riscvGetVReg(riscv, i);
+            dst->readCB   = riscv->configInfo.lazy_tail_zero ? readVR  : 0;
+            dst->writeCB  = riscv->configInfo.lazy_tail_zero ? writeVR : 0;
             dst++;
         }
 
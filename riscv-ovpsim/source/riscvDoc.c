@@ -497,6 +497,20 @@ void riscvDoc(riscvP rootProcessor) {
                 svModes
             );
             vmidocAddText(Features, string);
+
+            vmidocAddText(
+                Features,
+                "Parameter \"tlb_prefetch\" can be used to specify a number of "
+                "neighbouring pages for which TLB entries are created "
+                "speculatively on a TLB miss. The leaf page table entries of "
+                "the following pages are read directly from the page table "
+                "page containing the leaf entry of the missed page, without "
+                "further table walks. Prefetch stops at the end of that page "
+                "table page and at any entry that is invalid, does not allow "
+                "the access or would require an A or D bit update. Prefetched "
+                "entries are not counted as table walks in TLB statistics. By "
+                "default, tlb_prefetch is 0, meaning that no prefetch is done."
+            );
         }
 
         // document unaligned access behavior
@@ -575,6 +589,25 @@ void riscvDoc(riscvP rootProcessor) {
             vmidocAddText(Features, string);
         }
 
+        // document pm_key_variants
+        vmidocAddText(
+            Features,
+            "Parameter \"pm_key_variants\" can be used to limit the number of "
+            "variants with which any block is translated, where a variant is "
+            "a distinct combination of vector configuration (vtype and vl "
+            "class) and transaction mode state (for derived models that "
+            "implement transaction mode). When a block has been translated "
+            "with more than this number of variants, translation of the "
+            "block ends after the first instruction that depends on that "
+            "state. Subsequent translations of the block also end before "
+            "that instruction, so that preceding code is translated only "
+            "once, and test transaction mode at run time instead of "
+            "translating separate variants for it. Only instructions that "
+            "depend on the vector configuration are still translated per "
+            "variant. By default, \"pm_key_variants\" is 0, meaning that "
+            "there is no limit. Per-block variant counts are included in the "
+            "statistics report if parameter \"statistics\" is True."
+        );
     }
 
     ////////////////////////////////////////////////////////////////////////////
@@ -782,6 +815,17 @@ void riscvDoc(riscvP rootProcessor) {
         );
         vmidocAddText(Parameters, string);
 
+        // document lazy_tail_zero
+        vmidocAddText(
+            Parameters,
+            "Parameter lazy_tail_zero is used to specify whether zeroing of "
+            "vector register tail elements is deferred until those elements "
+            "are observed by a later instruction, debugger or save/restore "
+            "operation. This is an implementation optimization that has no "
+            "architecturally-visible effect. By default, lazy_tail_zero is "
+            "set to 1."
+        );
+
         vmiDocNodeP Features = vmidocAddSection(
             Vector, "Vector Extension Features"
         );
@@ -1678,6 +1722,22 @@ void riscvDoc(riscvP rootProcessor) {
             "bus."
         );
 
+        vmidocAddText(
+            leafSection,
+            "By default, every read of an externally-implemented CSR is a bus "
+            "read and every write is a bus write followed by a read-back of "
+            "the new value. The external implementer may declare a caching "
+            "policy by mapping a readable 32-bit word at offset 8 in the CSR "
+            "slot (for example, address 0xC018 for CSR \"time\"). Value 0 "
+            "(the default) means volatile: no accesses are cached. Value 1 "
+            "means read-only after reset: the value is read from the bus "
+            "once and subsequent reads and write read-backs use the cached "
+            "value. Value 2 means write-through without read-back: writes "
+            "are passed to the bus and the written value is cached and "
+            "returned by subsequent reads. Cached values are discarded on "
+            "reset and on restore."
+        );
+
         if(cfg->arch&ISA_A) {
 
             vmiDocNodeP leafSection = vmidocAddSection(
@@ -36,7 +36,9 @@
 #include "riscvExceptionDefinitions.h"
 #include "riscvFunctions.h"
 #include "riscvMessage.h"
+#include "riscvStats.h"
 #include "riscvStructure.h"
+#include "riscvTiming.h"
 #include "riscvUtils.h"
 #include "riscvVM.h"
 #include "riscvVMConstants.h"
@@ -237,9 +239,10 @@ static void restartProcessor(riscvP riscv, riscvDisableReason reason) {
 ////////////////////////////////////////////////////////////////////////////////
 
 //
-// Forward reference
+// Forward references
 //
 static void enterDM(riscvP riscv, dmCause cause);
+inline static Bool getPending(riscvP riscv);
 
 //
 // Return PC to which to return after taking an exception. For processors with
@@ -256,14 +259,14 @@ static Uns64 getEPC(riscvP riscv) {
 
 //
 // Return the mode to which to take the given exception or interrupt (mode X)
+// from mode Y
 //
-static riscvMode getModeX(
-    riscvP         riscv,
+static riscvMode getModeXY(
     Uns32          mMask,
     Uns32          sMask,
-    riscvException ecode
+    riscvException ecode,
+    riscvMode      modeY
 ) {
-    riscvMode modeY = getCurrentMode(riscv);
     riscvMode modeX;
 
     // get mode X implied by delegation registers
@@ -280,17 +283,15 @@ static riscvMode getModeX(
 }
 
 //
-// Return the mode to which to take the given interrupt (mode X)
-//
-static riscvMode getInterruptModeX(riscvP riscv, riscvException ecode) {
-    return getModeX(riscv, RD_CSR(riscv, mideleg), RD_CSR(riscv, sideleg), ecode);
-}
-
-//
-// Return the mode to which to take the given exception (mode X)
+// Return the mode to which to take the given exception or interrupt (mode X)
 //
-static riscvMode getExceptionModeX(riscvP riscv, riscvException ecode) {
-    return getModeX(riscv, RD_CSR(riscv, medeleg), RD_CSR(riscv, sedeleg), ecode);
+static riscvMode getModeX(
+    riscvP         riscv,
+    Uns32          mMask,
+    Uns32          sMask,
+    riscvException ecode
+) {
+    return getModeXY(mMask, sMask, ecode, getCurrentMode(riscv));
 }
 
 //
@@ -303,11 +304,140 @@ inline static riscvICMode getIMode(riscvICMode customMode, riscvICMode tvecMode)
     return tvecMode ? tvecMode : customMode;
 }
 
+//
+// Return custom interrupt mode for the given target mode
+//
+static riscvICMode getCustomIMode(riscvP riscv, riscvMode modeX) {
+
+    switch(modeX) {
+        case RISCV_MODE_USER:       return riscv->UIMode;
+        case RISCV_MODE_SUPERVISOR: return riscv->SIMode;
+        case RISCV_MODE_HYPERVISOR: return riscv->HIMode;
+        default:                    return riscv->MIMode;
+    }
+}
+
+//
+// Fill trap-vector state for the given target mode
+//
+#define FILL_TRAP_TARGET(_P, _CACHE, _X, _x) {                                  \
+                                                                                \
+    riscvTrapTargetP _T = &(_CACHE)->target[RISCV_MODE_##_X];                   \
+                                                                                \
+    /* precompute exception base address and effective interrupt mode */       \
+    _T->base  = (Addr)RD_CSR_FIELD(_P, _x##tvec, BASE) << 2;                    \
+    _T->mode  = RD_CSR_FIELD(_P, _x##tvec, MODE);                               \
+    _T->iMode = getIMode(getCustomIMode(_P, RISCV_MODE_##_X), _T->mode);        \
+                                                                                \
+    /* precompute CLIC selective hardware vectoring table base */               \
+    _T->tvt   = RD_CSR(_P, _x##tvt);                                            \
+}
+
+//
+// Refresh trap target state derived from delegation, trap-vector and CLIC
+// configuration CSRs
+//
+static void refreshTrapCache(riscvP riscv) {
+
+    riscvTrapCacheP cache   = &riscv->trapCache;
+    Uns32           nlbits  = riscv->smpRoot->clic.cliccfg.fields.nlbits;
+    Uns32           medeleg = RD_CSR(riscv, medeleg);
+    Uns32           sedeleg = RD_CSR(riscv, sedeleg);
+    Uns32           mideleg = RD_CSR(riscv, mideleg);
+    Uns32           sideleg = RD_CSR(riscv, sideleg);
+    riscvExtCBP     extCB;
+    riscvMode       modeY;
+    Uns32           code;
+
+    // fill target modes for each source mode and code
+    for(modeY=0; modeY<RISCV_MODE_LAST; modeY++) {
+        for(code=0; code<RISCV_TRAP_CACHE_CODES; code++) {
+            cache->exceptModeX[modeY][code] = getModeXY(
+                medeleg, sedeleg, code, modeY
+            );
+            cache->interruptModeX[modeY][code] = getModeXY(
+                mideleg, sideleg, code, modeY
+            );
+        }
+    }
+
+    // fill trap-vector state for each target mode
+    FILL_TRAP_TARGET(riscv, cache, USER,       u);
+    FILL_TRAP_TARGET(riscv, cache, SUPERVISOR, s);
+    FILL_TRAP_TARGET(riscv, cache, MACHINE,    m);
+
+    // fill mask of clicintctl bits representing interrupt level
+    cache->clicLevelMask = ~((1<<(8-nlbits)) - 1);
+
+    // determine whether trap and ERET notifiers are present
+    cache->trapNotify = False;
+    cache->ERETNotify = False;
+
+    for(extCB=riscv->extCBs; extCB; extCB=extCB->next) {
+        cache->trapNotify |= (extCB->trapNotifier && True);
+        cache->ERETNotify |= (extCB->ERETNotifier && True);
+    }
+
+    cache->valid = True;
+}
+
+//
+// Return valid trap target state, refreshing it if required
+//
+inline static riscvTrapCacheP getTrapCache(riscvP riscv) {
+
+    riscvTrapCacheP cache = &riscv->trapCache;
+
+    if(!cache->valid) {
+        refreshTrapCache(riscv);
+    }
+
+    return cache;
+}
+
+//
+// Invalidate trap target state (required when delegation, trap-vector or CLIC
+// configuration CSRs or the registered extension notifiers change)
+//
+void riscvInvalidateTrapCache(riscvP riscv) {
+    riscv->trapCache.valid = False;
+}
+
+//
+// Return the mode to which to take the given interrupt (mode X)
+//
+static riscvMode getInterruptModeX(riscvP riscv, riscvException ecode) {
+
+    if(ecode<RISCV_TRAP_CACHE_CODES) {
+        riscvTrapCacheP cache = getTrapCache(riscv);
+        return cache->interruptModeX[getCurrentMode(riscv)][ecode];
+    } else {
+        return getModeX(
+            riscv, RD_CSR(riscv, mideleg), RD_CSR(riscv, sideleg), ecode
+        );
+    }
+}
+
+//
+// Return the mode to which to take the given exception (mode X)
+//
+static riscvMode getExceptionModeX(riscvP riscv, riscvException ecode) {
+
+    if(ecode<RISCV_TRAP_CACHE_CODES) {
+        riscvTrapCacheP cache = getTrapCache(riscv);
+        return cache->exceptModeX[getCurrentMode(riscv)][ecode];
+    } else {
+        return getModeX(
+            riscv, RD_CSR(riscv, medeleg), RD_CSR(riscv, sedeleg), ecode
+        );
+    }
+}
+
 //
 // Update exception state when taking exception to mode X from mode Y
 //
 #define TARGET_MODE_X( \
-    _P, _X, _x, _IS_INT, _ECODE, _EPC, _BASE, _MODE, _TVAL, _LEVEL              \
+    _P, _X, _x, _IS_INT, _ECODE, _EPC, _TVAL, _LEVEL                            \
 ) {                                                                             \
     /* get interrupt enable and level bits for mode X */                        \
     Uns8 _IE = RD_CSR_FIELD(_P, mstatus,    _X##IE);                            \
@@ -334,10 +464,6 @@ inline static riscvICMode getIMode(riscvICMode customMode, riscvICMode tvecMode)
     /* update tval register */                                                  \
     WR_CSR_FIELD(_P, _x##tval, value, _TVAL);                                   \
                                                                                 \
-    /* get exception base address and mode */                                   \
-    _BASE = (Addr)RD_CSR_FIELD(_P, _x##tvec, BASE) << 2;                        \
-    _MODE = getIMode(_P->_X##IMode, RD_CSR_FIELD(_P, _x##tvec, MODE));          \
-                                                                                \
     /* update exception level */                                                \
     if(_LEVEL>=0) {                                                             \
         WR_CSR_FIELD(_P, mintstatus, _x##il, _LEVEL);                           \
@@ -349,7 +475,7 @@ inline static riscvICMode getIMode(riscvICMode customMode, riscvICMode tvecMode)
 //
 #define GET_CLIC_VECTORED_HANDLER_PC(_P, _HANDLER_PC, _X, _x, _INTNUM, _MODE) { \
                                                                                 \
-    Uns64 TBASE = RD_CSR(_P, _x##tvt);                                          \
+    Uns64 TBASE = getTrapCache(_P)->target[RISCV_MODE_##_X].tvt;                \
                                                                                 \
     /* set xcause.inhv=1 before vector lookup */                                \
     WR_CSR_FIELD(_P, _x##cause, inhv, 1);                                       \
@@ -451,8 +577,10 @@ inline static void notifyERETDerived(riscvP riscv, riscvMode mode) {
 
     riscvExtCBP extCB;
 
-    for(extCB=riscv->extCBs; extCB; extCB=extCB->next) {
-        notifyTrapDerived(riscv, mode, extCB->ERETNotifier, extCB->clientData);
+    if(getTrapCache(riscv)->ERETNotify) {
+        for(extCB=riscv->extCBs; extCB; extCB=extCB->next) {
+            notifyTrapDerived(riscv, mode, extCB->ERETNotifier, extCB->clientData);
+        }
     }
 }
 
@@ -474,6 +602,11 @@ void riscvTakeException(
     riscvException exception,
     Uns64          tval
 ) {
+    // model timing events recorded before the exception if required
+    if(riscv->timing) {
+        riscvTimingFlushBatch(riscv);
+    }
+
     if(inDebugMode(riscv)) {
 
         // terminate execution of program buffer
@@ -492,8 +625,6 @@ void riscvTakeException(
         riscvMode   modeY     = getCurrentMode(riscv);
         riscvMode   modeX;
         riscvExtCBP extCB;
-        Uns64       base;
-        riscvICMode mode;
 
         // adjust baseInstructions based on the exception code to take into
         // account whether the previous instruction has retired, unless
@@ -512,6 +643,9 @@ void riscvTakeException(
         // clear any active exclusive access
         clearEA(riscv);
 
+        // count traps by cause if required
+        riscvStatsTrap(riscv, isInt, ecode);
+
         // get exception target mode (X)
         if(!isInt) {
             modeX = getExceptionModeX(riscv, ecode);
@@ -548,14 +682,14 @@ void riscvTakeException(
 
             // target user mode
             TARGET_MODE_X(
-                riscv, U, u, isInt, ecodeMod, EPC, base, mode, tval, level
+                riscv, U, u, isInt, ecodeMod, EPC, tval, level
             );
 
         } else if(modeX==RISCV_MODE_SUPERVISOR) {
 
             // target supervisor mode
             TARGET_MODE_X(
-                riscv, S, s, isInt, ecodeMod, EPC, base, mode, tval, level
+                riscv, S, s, isInt, ecodeMod, EPC, tval, level
             );
 
             WR_CSR_FIELD(riscv, mstatus, SPP, modeY);
@@ -564,12 +698,17 @@ void riscvTakeException(
 
             // target machine mode
             TARGET_MODE_X(
-                riscv, M, m, isInt, ecodeMod, EPC, base, mode, tval, level
+                riscv, M, m, isInt, ecodeMod, EPC, tval, level
             );
 
             WR_CSR_FIELD(riscv, mstatus, MPP, modeY);
         }
 
+        // get exception base address and mode (precomputed from xtvec)
+        riscvTrapTargetP target = &getTrapCache(riscv)->target[modeX];
+        Uns64            base   = target->base;
+        riscvICMode      mode   = target->iMode;
+
         // switch to target mode
         riscvSetMode(riscv, modeX);
 
@@ -613,8 +752,12 @@ void riscvTakeException(
         vmirtSetPCException((vmiProcessorP)riscv, handlerPC);
 
         // notify derived model of exception entry if required
-        for(extCB=riscv->extCBs; extCB; extCB=extCB->next) {
-            notifyTrapDerived(riscv, modeX, extCB->trapNotifier, extCB->clientData);
+        if(getTrapCache(riscv)->trapNotify) {
+            for(extCB=riscv->extCBs; extCB; extCB=extCB->next) {
+                notifyTrapDerived(
+                    riscv, modeX, extCB->trapNotifier, extCB->clientData
+                );
+            }
         }
     }
 }
@@ -766,8 +909,15 @@ static void doERETCommon(
     // notify derived model of exception return if required
     notifyERETDerived(riscv, retMode);
 
-    // check for pending interrupts
-    riscvTestInterrupt(riscv);
+    // check for pending interrupts (not required if none are pending, which is
+    // the common case when returning from a system call)
+    if(
+        getPending(riscv) ||
+        (riscv->pendEnab.id!=RV_NO_INT) ||
+        RISCV_DEBUG_EXCEPT(riscv)
+    ) {
+        riscvTestInterrupt(riscv);
+    }
 }
 
 //
@@ -1400,14 +1550,12 @@ static Uns32 getIntPri(Uns32 intNum) {
 }
 
 //
-// Refresh pending basic interrupt state
+// Mask the given basic mode interrupts using global interrupt enable and
+// delegation state
 //
-static void refreshPendingAndEnabledBasic(riscvP riscv) {
-
-    Uns64 pendingEnabled = getPendingBasic(riscv);
+static Uns64 maskBasicInterrupts(riscvP riscv, Uns64 interrupts) {
 
-    // apply interrupt masks
-    if(pendingEnabled) {
+    if(interrupts) {
 
         // get raw interrupt enable bits
         Bool MIE = RD_CSR_FIELD(riscv, mstatus, MIE);
@@ -1427,11 +1575,22 @@ static void refreshPendingAndEnabledBasic(riscvP riscv) {
         Uns64 uMask   = sideleg;
 
         // handle masked interrupts
-        if(!MIE) {pendingEnabled &= ~mMask;}
-        if(!SIE) {pendingEnabled &= ~sMask;}
-        if(!UIE) {pendingEnabled &= ~uMask;}
+        if(!MIE) {interrupts &= ~mMask;}
+        if(!SIE) {interrupts &= ~sMask;}
+        if(!UIE) {interrupts &= ~uMask;}
     }
 
+    return interrupts;
+}
+
+//
+// Refresh pending basic interrupt state
+//
+static void refreshPendingAndEnabledBasic(riscvP riscv) {
+
+    // apply interrupt masks
+    Uns64 pendingEnabled = maskBasicInterrupts(riscv, getPendingBasic(riscv));
+
     // print exception status
     if(RISCV_DEBUG_EXCEPT(riscv)) {
 
@@ -1865,6 +2024,63 @@ void riscvWFI(riscvP riscv) {
     }
 }
 
+//
+// Could an interrupt cause exit from a loop that is not otherwise making
+// progress? This is true if any CLIC mode is in use or any basic mode interrupt
+// is locally and globally enabled
+//
+static Bool interruptCanExitLoop(riscvP riscv) {
+
+    return (
+        useCLICM(riscv) ||
+        useCLICS(riscv) ||
+        useCLICU(riscv) ||
+        (maskBasicInterrupts(riscv, RD_CSR(riscv, mie))!=0)
+    );
+}
+
+//
+// Called on each iteration of a loop that cannot change architectural state:
+// terminate simulation if the loop has executed the configured number of
+// consecutive iterations with no interrupt able to cause it to exit
+//
+void riscvSpinLoop(riscvP riscv, Uns64 loopPC, Uns32 loopInstructions) {
+
+    riscvConfigCP cfg    = &riscv->configInfo;
+    Uns64         iCount = vmirtGetExecutedICount((vmiProcessorP)riscv);
+
+    // start a new sequence of iterations if this is a different loop, if other
+    // instructions have been executed since the previous iteration or if an
+    // interrupt could cause loop exit
+    if(
+        (riscv->spinPC!=loopPC)                            ||
+        ((iCount-riscv->spinICount)!=loopInstructions)     ||
+        inDebugMode(riscv)                                 ||
+        interruptCanExitLoop(riscv)
+    ) {
+        riscv->spinPC         = loopPC;
+        riscv->spinIterations = 0;
+    }
+
+    riscv->spinICount = iCount;
+
+    // terminate simulation if the iteration limit has been reached
+    if(++riscv->spinIterations >= cfg->spin_loop_limit) {
+
+        vmiMessage("W", CPU_PREFIX "_SPIN",
+            SRCREF_FMT
+            "no progress after %u iterations of loop at 0x"FMT_Ax" - "
+            "terminating with exit code %u",
+            SRCREF_ARGS(riscv, loopPC),
+            riscv->spinIterations,
+            loopPC,
+            cfg->spin_loop_exit_code
+        );
+
+        vmirtFinish(cfg->spin_loop_exit_code);
+    }
+}
+
 //
 // Handle any pending and enabled interrupts
 //
@@ -2502,10 +2718,9 @@ static void writeCLICInterrupt(riscvP root, Uns32 offset, Uns8 newValue) {
 //
 static void refreshPendingAndEnabledCLIC(riscvP hart) {
 
-    riscvP root    = hart->smpRoot;
-    Uns32  maxRank = 0;
-    Int32  id      = RV_NO_INT;
-    Uns32  wordIndex;
+    Uns32 maxRank = 0;
+    Int32 id      = RV_NO_INT;
+    Uns32 wordIndex;
 
     // reset presented interrupt details
     hart->clic.sel.priv  = 0;
@@ -2564,9 +2779,9 @@ static void refreshPendingAndEnabledCLIC(riscvP hart) {
         CLIC_REG_DECL(clicintattr) = getCLICInterruptAttr(hart, id);
         Uns8 clicintctl = getCLICInterruptField(hart, id, CIT_clicintctl);
 
-        // get mask of bits in clicintctl representing level
-        Uns32 nlbits     = root->clic.cliccfg.fields.nlbits;
-        Uns8  nlbitsMask = ~((1<<(8-nlbits)) - 1);
+        // get mask of bits in clicintctl representing level (precomputed
+        // from cliccfg.nlbits)
+        Uns8 nlbitsMask = getTrapCache(hart)->clicLevelMask;
 
         // get interrupt target mode
         riscvMode priv = getCLICInterruptMode(hart, id);
@@ -2701,6 +2916,7 @@ static void updateCLICInput(riscvP hart, Uns32 intIndex, Bool newValue) {
 //
 static VMI_SMP_ITER_FN(refreshCCLICInterruptAllCB) {
     if(vmirtGetSMPCpuType(processor)==SMP_TYPE_LEAF) {
+        riscvInvalidateTrapCache((riscvP)processor);
         riscvTestInterrupt((riscvP)processor);
     }
 }
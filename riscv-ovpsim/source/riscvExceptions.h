@@ -51,6 +51,12 @@ void riscvTakeMemoryException(
 //
 void riscvReset(riscvP riscv);
 
+//
+// Invalidate trap target state (required when delegation or trap-vector CSRs
+// or the registered extension notifiers change)
+//
+void riscvInvalidateTrapCache(riscvP riscv);
+
 //
 // Take Illegal Instruction exception
 //
@@ -111,6 +117,11 @@ void riscvSetStepBreakpoint(riscvP riscv);
 //
 void riscvWFI(riscvP riscv);
 
+//
+// Terminate simulation if a loop has made no progress for too long
+//
+void riscvSpinLoop(riscvP riscv, Uns64 loopPC, Uns32 loopInstructions);
+
 //
 // Return mask of implemented local interrupts
 //
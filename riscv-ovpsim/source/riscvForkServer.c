@@ -0,0 +1,429 @@
+/*
+ * Copyright (c) 2005-2020 Imperas Software Ltd., www.imperas.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied.
+ *
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// standard header files
+#include <stdio.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// Imperas header files
+#include "hostapi/impAlloc.h"
+
+// VMI header files
+#include "vmi/vmiMessage.h"
+#include "vmi/vmiRt.h"
+
+// model header files
+#include "riscvForkServer.h"
+#include "riscvMessage.h"
+#include "riscvStructure.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// TYPES
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Maximum length of a payload file name
+//
+#define RISCV_FS_NAME_MAX 1024
+
+//
+// Symbols delimiting the test signature
+//
+#define RISCV_FS_SIG_BEGIN "begin_signature"
+#define RISCV_FS_SIG_END   "end_signature"
+
+//
+// Fork server state
+//
+typedef struct riscvForkServerS {
+    char  *marker;                      // marker symbol name (or empty)
+    char  *payloads;                    // payload list file name
+    Uns64  payloadAddress;              // payload load address
+    Uns64  markerPC;                    // resolved marker address
+    Bool   markerResolved;              // has marker address been resolved?
+    Bool   isChild;                     // is this a forked child?
+    char   payload[RISCV_FS_NAME_MAX];  // payload for this child
+} riscvForkServer;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// UTILITIES
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Return an allocated copy of the given string
+//
+static char *copyString(const char *string) {
+
+    string = string ? string : "";
+
+    char *result = STYPE_CALLOC_N(char, strlen(string)+1);
+
+    strcpy(result, string);
+
+    return result;
+}
+
+//
+// Return the domain used to load payloads and read signatures
+//
+inline static memDomainP getPhysicalDomain(riscvP riscv) {
+    return riscv->physDomains[RISCV_MODE_M][0];
+}
+
+//
+// Look up the address of the named symbol, returning False if it is not found
+//
+static Bool getSymbolAddress(riscvP riscv, const char *name, Uns64 *addressP) {
+
+    vmiSymbolCP symbol = vmirtGetSymbolByName((vmiProcessorP)riscv, name);
+
+    if(symbol) {
+        *addressP = vmirtGetSymbolValue(symbol);
+    }
+
+    return symbol ? True : False;
+}
+
+//
+// Remove any trailing newline or whitespace from the given string
+//
+static void trimString(char *string) {
+
+    Uns32 length = strlen(string);
+
+    while(length && (string[length-1]<=' ')) {
+        string[--length] = 0;
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// CHILD PROCESS ACTIONS
+////////////////////////////////////////////////////////////////////////////////
+
+#if !defined(_WIN32)
+
+//
+// Load the payload file for this child into memory
+//
+static void loadPayload(riscvP riscv, riscvForkServerP fs) {
+
+    memDomainP domain  = getPhysicalDomain(riscv);
+    Uns64      address = fs->payloadAddress;
+    FILE      *file    = fopen(fs->payload, "rb");
+    Uns8       buffer[4096];
+    Uns32      bytes;
+
+    if(!file) {
+
+        vmiMessage("E", CPU_PREFIX "_FSP",
+            NO_SRCREF_FMT "cannot open payload '%s'",
+            NO_SRCREF_ARGS(riscv), fs->payload
+        );
+
+    } else {
+
+        while((bytes=fread(buffer, 1, sizeof(buffer), file))) {
+            vmirtWriteNByteDomain(
+                domain, address, buffer, bytes, 0, MEM_AA_FALSE
+            );
+            address += bytes;
+        }
+
+        fclose(file);
+    }
+}
+
+//
+// Discard translations made before the payload was loaded and restart at the
+// marker, so that code overwritten by the payload is translated afresh
+//
+static void restartAtMarker(riscvP riscv, riscvForkServerP fs) {
+
+    vmiProcessorP processor = (vmiProcessorP)riscv;
+
+    vmirtFlushAllDicts(processor);
+    vmirtSetPC(processor, fs->markerPC);
+}
+
+//
+// Redirect output of this child to a file named after the payload
+//
+static void redirectOutput(riscvForkServerP fs) {
+
+    char name[RISCV_FS_NAME_MAX+8];
+
+    snprintf(name, sizeof(name), "%s.log", fs->payload);
+
+    if(freopen(name, "w", stdout)) {
+        dup2(fileno(stdout), fileno(stderr));
+    }
+}
+
+#endif
+
+//
+// Write the signature of this child to a file named after the payload (one
+// 32-bit word per line, as written by the platform signature dump)
+//
+static void writeSignature(riscvP riscv, riscvForkServerP fs) {
+
+    memDomainP domain = getPhysicalDomain(riscv);
+    Uns64      begin;
+    Uns64      end;
+
+    if(
+        getSymbolAddress(riscv, RISCV_FS_SIG_BEGIN, &begin) &&
+        getSymbolAddress(riscv, RISCV_FS_SIG_END,   &end)
+    ) {
+        char  name[RISCV_FS_NAME_MAX+16];
+        FILE *file;
+
+        snprintf(name, sizeof(name), "%s.signature", fs->payload);
+
+        if(!(file=fopen(name, "w"))) {
+
+            vmiMessage("E", CPU_PREFIX "_FSS",
+                NO_SRCREF_FMT "cannot write signature '%s'",
+                NO_SRCREF_ARGS(riscv), name
+            );
+
+        } else {
+
+            Uns64 address;
+
+            for(address=begin; address<end; address+=4) {
+
+                Uns32 word = vmirtRead4ByteDomain(
+                    domain, address, MEM_ENDIAN_LITTLE, MEM_AA_FALSE
+                );
+
+                fprintf(file, "%08x\n", word);
+            }
+
+            fclose(file);
+        }
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// PUBLIC INTERFACE
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Allocate fork server structures if fork server mode is enabled (the server
+// runs on the first hart only)
+//
+void riscvForkServerNew(riscvP riscv, Uns32 index) {
+
+    riscvConfigCP cfg = &riscv->configInfo;
+
+    if(cfg->fork_server && !index) {
+
+        riscvForkServerP fs = STYPE_CALLOC(riscvForkServer);
+
+        fs->marker         = copyString(cfg->fork_marker);
+        fs->payloads       = copyString(cfg->fork_payloads);
+        fs->payloadAddress = cfg->fork_payload_address;
+
+        riscv->forkServer = fs;
+    }
+}
+
+//
+// Free fork server structures, writing the signature of a forked test
+//
+void riscvForkServerFree(riscvP riscv) {
+
+    riscvForkServerP fs = riscv->forkServer;
+
+    if(fs) {
+
+        if(fs->isChild) {
+            writeSignature(riscv, fs);
+        }
+
+        STYPE_FREE(fs->marker);
+        STYPE_FREE(fs->payloads);
+        STYPE_FREE(fs);
+
+        riscv->forkServer = 0;
+    }
+}
+
+//
+// Is the given address the point at which the fork server should run? If no
+// marker symbol is specified, the server runs at the first instruction
+// translated
+//
+Bool riscvForkServerIsMarker(riscvP riscv, Uns64 thisPC) {
+
+    riscvForkServerP fs = riscv->forkServer;
+
+    if(fs->markerResolved) {
+
+        // no action
+
+    } else if(!fs->marker[0]) {
+
+        fs->markerPC = thisPC;
+
+    } else if(!getSymbolAddress(riscv, fs->marker, &fs->markerPC)) {
+
+        vmiMessage("W", CPU_PREFIX "_FSM",
+            NO_SRCREF_FMT "fork server marker '%s' not found - "
+            "using first instruction",
+            NO_SRCREF_ARGS(riscv), fs->marker
+        );
+
+        fs->markerPC = thisPC;
+    }
+
+    fs->markerResolved = True;
+
+    return fs->markerPC==thisPC;
+}
+
+#if defined(_WIN32)
+
+//
+// Run the fork server (not supported on this host)
+//
+void riscvForkServerRun(riscvP riscv) {
+
+    riscvForkServerP fs = riscv->forkServer;
+
+    if(!fs->isChild) {
+
+        vmiMessage("E", CPU_PREFIX "_FSH",
+            NO_SRCREF_FMT "fork server mode is not supported on this host",
+            NO_SRCREF_ARGS(riscv)
+        );
+
+        fs->isChild = True;
+    }
+}
+
+#else
+
+//
+// Run the fork server: fork one copy-on-write child for each payload in the
+// payload list, wait for it and report its exit status, then terminate with
+// a status indicating whether any child failed. Each child returns from this
+// function with its payload loaded and continues simulation from the marker
+// with all previous translations discarded.
+//
+void riscvForkServerRun(riscvP riscv) {
+
+    riscvForkServerP fs    = riscv->forkServer;
+    FILE            *list  = 0;
+    Uns32            tests = 0;
+    Uns32            fails = 0;
+
+    if(fs->isChild) {
+
+        // no action in child (marker reached again)
+
+    } else if(!(list=fopen(fs->payloads, "r"))) {
+
+        vmiMessage("E", CPU_PREFIX "_FSL",
+            NO_SRCREF_FMT "cannot open payload list '%s'",
+            NO_SRCREF_ARGS(riscv), fs->payloads
+        );
+
+        vmirtFinish(1);
+
+    } else {
+
+        // flush buffered output so that it is not duplicated in children
+        fflush(stdout);
+        fflush(stderr);
+
+        while(fgets(fs->payload, sizeof(fs->payload), list)) {
+
+            trimString(fs->payload);
+
+            if(!fs->payload[0]) {
+                continue;
+            }
+
+            pid_t pid = fork();
+
+            if(pid<0) {
+
+                vmiMessage("E", CPU_PREFIX "_FSF",
+                    NO_SRCREF_FMT "fork failed for payload '%s'",
+                    NO_SRCREF_ARGS(riscv), fs->payload
+                );
+
+                fails++;
+
+            } else if(!pid) {
+
+                // continue simulation in child with the payload loaded
+                fclose(list);
+                fs->isChild = True;
+                redirectOutput(fs);
+                loadPayload(riscv, fs);
+                restartAtMarker(riscv, fs);
+                return;
+
+            } else {
+
+                Int32 status = 0;
+                Int32 code;
+
+                waitpid(pid, &status, 0);
+
+                code = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+
+                if(code) {
+                    fails++;
+                }
+
+                vmiMessage("I", CPU_PREFIX "_FSR",
+                    NO_SRCREF_FMT "payload '%s' exit status %d",
+                    NO_SRCREF_ARGS(riscv), fs->payload, code
+                );
+            }
+
+            tests++;
+        }
+
+        fclose(list);
+
+        vmiMessage("I", CPU_PREFIX "_FSD",
+            NO_SRCREF_FMT "fork server ran %u tests (%u failed)",
+            NO_SRCREF_ARGS(riscv), tests, fails
+        );
+
+        vmirtFinish(fails ? 1 : 0);
+    }
+}
+
+#endif
+
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2005-2020 Imperas Software Ltd., www.imperas.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied.
+ *
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#pragma once
+
+// Imperas header files
+#include "hostapi/impTypes.h"
+
+// model header files
+#include "riscvTypeRefs.h"
+
+//
+// Allocate fork server structures if fork server mode is enabled
+//
+void riscvForkServerNew(riscvP riscv, Uns32 index);
+
+//
+// Free fork server structures, writing the signature of a forked test
+//
+void riscvForkServerFree(riscvP riscv);
+
+//
+// Is the given address the point at which the fork server should run?
+//
+Bool riscvForkServerIsMarker(riscvP riscv, Uns64 thisPC);
+
+//
+// Run the fork server, returning only in a forked child process
+//
+void riscvForkServerRun(riscvP riscv);
+
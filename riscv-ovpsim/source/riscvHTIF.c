@@ -0,0 +1,1148 @@
+/*
+ * Copyright (c) 2005-2020 Imperas Software Ltd., www.imperas.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied.
+ *
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// standard header files
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Imperas header files
+#include "hostapi/impAlloc.h"
+
+// VMI header files
+#include "vmi/vmiMessage.h"
+#include "vmi/vmiRt.h"
+
+// model header files
+#include "riscvHTIF.h"
+#include "riscvMessage.h"
+#include "riscvStructure.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// TYPES
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Symbols identifying the HTIF registers
+//
+#define RISCV_HTIF_TOHOST   "tohost"
+#define RISCV_HTIF_FROMHOST "fromhost"
+
+//
+// Size of the console output buffer
+//
+#define RISCV_HTIF_CONSOLE  1024
+
+//
+// Number of proxied file descriptors (including stdin, stdout and stderr)
+//
+#define RISCV_HTIF_FILES    32
+
+//
+// Maximum bytes transferred by one proxied read or write (larger requests
+// return a partial count)
+//
+#define RISCV_HTIF_XFER_MAX (1<<24)
+
+//
+// Maximum number of host files mapped into guest memory
+//
+#define RISCV_HTIF_MAPS     16
+
+//
+// Size of proxied stat structure (riscv-pk kernel_stat layout)
+//
+#define RISCV_HTIF_STAT     128
+
+//
+// HTIF devices and commands
+//
+#define HTIF_DEV_SYSCALL    0
+#define HTIF_DEV_CONSOLE    1
+#define HTIF_CMD_PUTCHAR    1
+
+//
+// Proxied system call numbers (as used by riscv-pk and newlib)
+//
+#define HTIF_SYS_OPENAT     56
+#define HTIF_SYS_CLOSE      57
+#define HTIF_SYS_LSEEK      62
+#define HTIF_SYS_READ       63
+#define HTIF_SYS_WRITE      64
+#define HTIF_SYS_FSTAT      80
+#define HTIF_SYS_EXIT       93
+#define HTIF_SYS_EXIT_GROUP 94
+#define HTIF_SYS_MUNMAP     215
+#define HTIF_SYS_MMAP       222
+
+//
+// Proxied file open flags and error codes (guest values)
+//
+#define HTIF_O_ACCMODE      0x003
+#define HTIF_O_WRONLY       0x001
+#define HTIF_O_RDWR         0x002
+#define HTIF_O_TRUNC        0x200
+#define HTIF_O_APPEND       0x400
+#define HTIF_PROT_READ      0x1
+#define HTIF_PROT_WRITE     0x2
+#define HTIF_PROT_EXEC      0x4
+#define HTIF_MAP_SHARED     0x01
+#define HTIF_MAP_PRIVATE    0x02
+#define HTIF_MAP_TYPE       0x0f
+#define HTIF_MAP_ANONYMOUS  0x20
+#define HTIF_ENOENT         2
+#define HTIF_EBADF          9
+#define HTIF_ENOMEM         12
+#define HTIF_EACCES         13
+#define HTIF_EINVAL         22
+#define HTIF_EMFILE         24
+#define HTIF_ENOSYS         38
+
+//
+// HTIF register index
+//
+typedef enum htifRegE {
+    HTIF_TOHOST,            // tohost register
+    HTIF_FROMHOST,          // fromhost register
+    HTIF_LAST               // KEEP LAST: for sizing
+} htifReg;
+
+//
+// Host file mapped into guest memory
+//
+typedef struct htifMapS {
+    Bool    used;                           // whether mapping is in use
+    Uns64   addr;                           // guest physical address
+    Uns64   bytes;                          // mapping size
+} htifMap, *htifMapP;
+
+//
+// HTIF device state
+//
+typedef struct riscvHTIFS {
+    riscvP  riscv;                          // owning hart
+    Bool    bound;                          // has binding been attempted?
+    Uns64   address[HTIF_LAST];             // register addresses
+    Uns64   value[HTIF_LAST];               // register values
+    FILE   *files[RISCV_HTIF_FILES];        // proxied files
+    Uns8   *xfer;                           // transfer buffer
+    Uns64   xferSize;                       // transfer buffer size
+    Uns8   *window;                         // host memory backing mmap window
+    htifMap maps[RISCV_HTIF_MAPS];          // host files mapped into memory
+    Uns32   consoleUsed;                    // buffered console bytes
+    char    console[RISCV_HTIF_CONSOLE+1];  // console output buffer
+} riscvHTIF;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// UTILITIES
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Return the domain used for proxied system call buffers
+//
+inline static memDomainP getPhysicalDomain(riscvP riscv) {
+    return riscv->physDomains[RISCV_MODE_M][0];
+}
+
+//
+// Look up the address of the named symbol, returning False if it is not found
+//
+static Bool getSymbolAddress(riscvP riscv, const char *name, Uns64 *addressP) {
+
+    vmiSymbolCP symbol = vmirtGetSymbolByName((vmiProcessorP)riscv, name);
+
+    if(symbol) {
+        *addressP = vmirtGetSymbolValue(symbol);
+    }
+
+    return symbol ? True : False;
+}
+
+//
+// Read a 64-bit little-endian word from guest memory
+//
+static Uns64 readGuest8(riscvP riscv, Uns64 address) {
+    return vmirtRead8ByteDomain(
+        getPhysicalDomain(riscv), address, MEM_ENDIAN_LITTLE, MEM_AA_FALSE
+    );
+}
+
+//
+// Return a transfer buffer of at least the given size
+//
+static Uns8 *getXferBuffer(riscvHTIFP htif, Uns64 bytes) {
+
+    if(bytes>htif->xferSize) {
+
+        if(htif->xfer) {
+            STYPE_FREE(htif->xfer);
+        }
+
+        htif->xfer     = STYPE_CALLOC_N(Uns8, bytes);
+        htif->xferSize = bytes;
+    }
+
+    return htif->xfer;
+}
+
+//
+// Write a little-endian value of the given size to a buffer
+//
+static void putLE(Uns8 *buffer, Uns32 offset, Uns64 value, Uns32 bytes) {
+
+    Uns32 i;
+
+    for(i=0; i<bytes; i++) {
+        buffer[offset+i] = value >> (i*8);
+    }
+}
+
+//
+// Write a 64-bit little-endian word to guest memory
+//
+static void writeGuest8(riscvP riscv, Uns64 address, Uns64 value) {
+    vmirtWrite8ByteDomain(
+        getPhysicalDomain(riscv), address, MEM_ENDIAN_LITTLE, value,
+        MEM_AA_FALSE
+    );
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// CONSOLE
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Write any buffered console output
+//
+static void flushConsole(riscvHTIFP htif) {
+
+    if(htif->consoleUsed) {
+        htif->console[htif->consoleUsed] = 0;
+        vmiPrintf("%s", htif->console);
+        htif->consoleUsed = 0;
+    }
+}
+
+//
+// Append bytes to the console output buffer, flushing it at each newline or
+// when full
+//
+static void writeConsole(riscvHTIFP htif, const char *data, Uns32 bytes) {
+
+    Uns32 i;
+
+    for(i=0; i<bytes; i++) {
+
+        char ch = data[i];
+
+        // NUL characters cannot be printed
+        if(ch) {
+            htif->console[htif->consoleUsed++] = ch;
+        }
+
+        if((ch=='\n') || (htif->consoleUsed==RISCV_HTIF_CONSOLE)) {
+            flushConsole(htif);
+        }
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// PROXIED SYSTEM CALLS
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Terminate simulation with the given exit code
+//
+static void doExit(riscvHTIFP htif, Int32 code) {
+
+    riscvP riscv = htif->riscv;
+
+    flushConsole(htif);
+
+    vmiMessage("I", CPU_PREFIX "_HTX",
+        NO_SRCREF_FMT "HTIF exit code %d",
+        NO_SRCREF_ARGS(riscv), code
+    );
+
+    vmirtFinish(code);
+}
+
+//
+// Return the proxied file with the given descriptor (or null if invalid)
+//
+static FILE *getFile(riscvHTIFP htif, Uns64 fd) {
+    return (fd<RISCV_HTIF_FILES) ? htif->files[fd] : 0;
+}
+
+//
+// Return host fopen mode for guest open flags
+//
+static const char *getOpenMode(Uns64 flags) {
+
+    Uns64 access = flags & HTIF_O_ACCMODE;
+
+    if(access==HTIF_O_WRONLY) {
+        return (flags & HTIF_O_APPEND) ? "ab" : "wb";
+    } else if(access!=HTIF_O_RDWR) {
+        return "rb";
+    } else if(flags & HTIF_O_APPEND) {
+        return "a+b";
+    } else if(flags & HTIF_O_TRUNC) {
+        return "w+b";
+    } else {
+        return "r+b";
+    }
+}
+
+//
+// Proxied openat (directory descriptor is ignored)
+//
+static Int64 sysOpenAt(riscvHTIFP htif, Uns64 pathVA, Uns64 flags) {
+
+    memDomainP domain = getPhysicalDomain(htif->riscv);
+    char       path[1024];
+    Uns32      i;
+    Uns32      fd;
+    FILE      *file;
+
+    // read NUL-terminated path
+    for(i=0; i<sizeof(path)-1; i++) {
+        if(!(path[i]=vmirtRead1ByteDomain(domain, pathVA+i, MEM_AA_FALSE))) {
+            break;
+        }
+    }
+    path[i] = 0;
+
+    // find free descriptor
+    for(fd=3; (fd<RISCV_HTIF_FILES) && htif->files[fd]; fd++) {
+        // no action
+    }
+
+    if(fd==RISCV_HTIF_FILES) {
+        return -HTIF_EMFILE;
+    } else if(!(file=fopen(path, getOpenMode(flags)))) {
+        return -HTIF_ENOENT;
+    } else {
+        htif->files[fd] = file;
+        return fd;
+    }
+}
+
+//
+// Proxied close (stdin, stdout and stderr are never closed)
+//
+static Int64 sysClose(riscvHTIFP htif, Uns64 fd) {
+
+    FILE *file = getFile(htif, fd);
+
+    if(!file) {
+        return -HTIF_EBADF;
+    } else if(fd>2) {
+        fclose(file);
+        htif->files[fd] = 0;
+    }
+
+    return 0;
+}
+
+//
+// Proxied lseek
+//
+static Int64 sysLseek(riscvHTIFP htif, Uns64 fd, Int64 offset, Uns64 whence) {
+
+    FILE *file = getFile(htif, fd);
+
+    if(!file) {
+        return -HTIF_EBADF;
+    } else if(fseek(file, offset, whence)) {
+        return -HTIF_EBADF;
+    } else {
+        return ftell(file);
+    }
+}
+
+//
+// Proxied read, transferring the entire buffer with one host call
+//
+static Int64 sysRead(riscvHTIFP htif, Uns64 fd, Uns64 bufVA, Uns64 bytes) {
+
+    riscvP riscv = htif->riscv;
+    FILE  *file  = getFile(htif, fd);
+    Int64  result;
+
+    if(bytes>RISCV_HTIF_XFER_MAX) {
+        bytes = RISCV_HTIF_XFER_MAX;
+    }
+
+    if(!file) {
+
+        result = -HTIF_EBADF;
+
+    } else {
+
+        Uns8 *buffer = getXferBuffer(htif, bytes+1);
+
+        result = fread(buffer, 1, bytes, file);
+
+        vmirtWriteNByteDomain(
+            getPhysicalDomain(riscv), bufVA, buffer, result, 0, MEM_AA_FALSE
+        );
+    }
+
+    return result;
+}
+
+//
+// Proxied write, transferring the entire buffer with one host call (stdout is
+// written through the console buffer)
+//
+static Int64 sysWrite(riscvHTIFP htif, Uns64 fd, Uns64 bufVA, Uns64 bytes) {
+
+    riscvP riscv = htif->riscv;
+    FILE  *file  = getFile(htif, fd);
+    Int64  result;
+
+    if(bytes>RISCV_HTIF_XFER_MAX) {
+        bytes = RISCV_HTIF_XFER_MAX;
+    }
+
+    if(!file) {
+
+        result = -HTIF_EBADF;
+
+    } else {
+
+        Uns8 *buffer = getXferBuffer(htif, bytes+1);
+
+        vmirtReadNByteDomain(
+            getPhysicalDomain(riscv), bufVA, buffer, bytes, 0, MEM_AA_FALSE
+        );
+
+        if(fd==1) {
+            writeConsole(htif, (const char *)buffer, bytes);
+            result = bytes;
+        } else {
+            flushConsole(htif);
+            result = fwrite(buffer, 1, bytes, file);
+        }
+    }
+
+    return result;
+}
+
+//
+// Return the preferred I/O block size of a host file
+//
+static Uns32 getBlockSize(struct stat *st) {
+#if defined(_WIN32)
+    return 4096;
+#else
+    return st->st_blksize;
+#endif
+}
+
+//
+// Proxied fstat, writing the riscv-pk kernel_stat layout
+//
+static Int64 sysFstat(riscvHTIFP htif, Uns64 fd, Uns64 statVA) {
+
+    FILE       *file = getFile(htif, fd);
+    struct stat st;
+
+    if(!file || fstat(fileno(file), &st)) {
+
+        return -HTIF_EBADF;
+
+    } else {
+
+        Uns8 buffer[RISCV_HTIF_STAT] = {0};
+
+        putLE(buffer,   0, st.st_dev,           8);
+        putLE(buffer,   8, st.st_ino,           8);
+        putLE(buffer,  16, st.st_mode,          4);
+        putLE(buffer,  20, st.st_nlink,         4);
+        putLE(buffer,  24, st.st_uid,           4);
+        putLE(buffer,  28, st.st_gid,           4);
+        putLE(buffer,  32, st.st_rdev,          8);
+        putLE(buffer,  48, st.st_size,          8);
+        putLE(buffer,  56, getBlockSize(&st),   4);
+        putLE(buffer,  64, (st.st_size+511)/512, 8);
+        putLE(buffer,  72, st.st_atime,         8);
+        putLE(buffer,  88, st.st_mtime,         8);
+        putLE(buffer, 104, st.st_ctime,         8);
+
+        vmirtWriteNByteDomain(
+            getPhysicalDomain(htif->riscv), statVA, buffer, sizeof(buffer),
+            0, MEM_AA_FALSE
+        );
+
+        return 0;
+    }
+}
+
+#if defined(_WIN32)
+
+//
+// Reserve the mmap window (not supported on this host)
+//
+static void mapWindow(riscvHTIFP htif) {
+
+    riscvP riscv = htif->riscv;
+
+    if(riscv->configInfo.htif_mmap_size) {
+        vmiMessage("W", CPU_PREFIX "_HTW",
+            NO_SRCREF_FMT "HTIF mmap is not supported on this host - "
+            "mmap disabled",
+            NO_SRCREF_ARGS(riscv)
+        );
+    }
+}
+
+//
+// Release the mmap window (not supported on this host)
+//
+static void unmapWindow(riscvHTIFP htif) {
+    // no action
+}
+
+//
+// Proxied mmap (not supported on this host)
+//
+static Int64 sysMmap(
+    riscvHTIFP htif,
+    Uns64      addr,
+    Uns64      length,
+    Uns64      prot,
+    Uns64      flags,
+    Uns64      fd,
+    Uns64      offset
+) {
+    return -HTIF_ENOSYS;
+}
+
+//
+// Proxied munmap (not supported on this host)
+//
+static Int64 sysMunmap(riscvHTIFP htif, Uns64 addr, Uns64 length) {
+    return -HTIF_ENOSYS;
+}
+
+#else
+
+//
+// Return the distinct external (shared physical) domains of the hart, data
+// domain first; these are below the PMP domains of every hart, so mappings
+// made in them are visible to all harts and all accesses are checked by PMP
+//
+static Uns32 getExternalDomains(riscvP riscv, memDomainP domains[2]) {
+
+    vmiProcessorP processor = (vmiProcessorP)riscv;
+
+    domains[0] = vmirtGetProcessorExternalDataDomain(processor);
+    domains[1] = vmirtGetProcessorExternalCodeDomain(processor);
+
+    return (domains[0]==domains[1]) ? 1 : 2;
+}
+
+//
+// Flush translated code of all harts (used when the contents of the mmap
+// window change)
+//
+static VMI_SMP_ITER_FN(flushDictsCB) {
+    if(vmirtGetSMPCpuType(processor)==SMP_TYPE_LEAF) {
+        vmirtFlushAllDicts(processor);
+    }
+}
+
+//
+// Set guest privilege for a range in the mmap window and discard any code
+// translated from it
+//
+static void protectWindow(
+    riscvHTIFP htif,
+    Uns64      addr,
+    Uns64      bytes,
+    memPriv    priv
+) {
+
+    riscvP     riscv = htif->riscv;
+    memDomainP domains[2];
+    Uns32      num   = getExternalDomains(riscv, domains);
+    Uns32      i;
+
+    for(i=0; i<num; i++) {
+        vmirtProtectMemory(domains[i], addr, addr+bytes-1, priv, MEM_PRIV_SET);
+    }
+
+    vmirtIterAllProcessors((vmiProcessorP)riscv->smpRoot, flushDictsCB, 0);
+}
+
+//
+// Replace a range of the mmap window with zero-filled anonymous host memory,
+// so that the host address backing it remains valid
+//
+static void clearWindow(riscvHTIFP htif, Uns64 addr, Uns64 bytes) {
+
+    Uns64 offset = addr - htif->riscv->configInfo.htif_mmap_base;
+
+    mmap(
+        htif->window+offset,
+        bytes,
+        PROT_READ|PROT_WRITE,
+        MAP_FIXED|MAP_PRIVATE|MAP_ANONYMOUS,
+        -1,
+        0
+    );
+}
+
+//
+// Reserve the mmap window given by parameters htif_mmap_base and
+// htif_mmap_size. The window must not contain memory or devices: it is backed
+// by one host memory reservation mapped in the shared external domains, so
+// that it is visible to all harts and all accesses are checked by PMP. It is
+// inaccessible to the guest except where a file is mapped.
+//
+static void mapWindow(riscvHTIFP htif) {
+
+    riscvP     riscv    = htif->riscv;
+    Uns64      base     = riscv->configInfo.htif_mmap_base;
+    Uns64      size     = riscv->configInfo.htif_mmap_size;
+    Uns64      pageSize = sysconf(_SC_PAGESIZE);
+    Uns64      highPA   = base+size-1;
+    memDomainP domains[2];
+    Uns32      num      = getExternalDomains(riscv, domains);
+    Uns32      i;
+
+    if(!size) {
+        return;
+    } else if(((base|size) & (pageSize-1)) || (highPA<base)) {
+        vmiMessage("W", CPU_PREFIX "_HTW",
+            NO_SRCREF_FMT "HTIF mmap window 0x"FMT_64x" size 0x"FMT_64x" is "
+            "not page aligned - mmap disabled",
+            NO_SRCREF_ARGS(riscv), base, size
+        );
+        return;
+    }
+
+    for(i=0; i<num; i++) {
+        if(vmirtGetDomainMapped(domains[i], base, highPA)) {
+            vmiMessage("W", CPU_PREFIX "_HTW",
+                NO_SRCREF_FMT "HTIF mmap window 0x"FMT_64x":0x"FMT_64x" "
+                "contains memory or devices - mmap disabled",
+                NO_SRCREF_ARGS(riscv), base, highPA
+            );
+            return;
+        }
+    }
+
+    void *host = mmap(
+        0, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0
+    );
+
+    if(host==MAP_FAILED) {
+        vmiMessage("W", CPU_PREFIX "_HTW",
+            NO_SRCREF_FMT "HTIF mmap window of 0x"FMT_64x" bytes could not "
+            "be reserved - mmap disabled",
+            NO_SRCREF_ARGS(riscv), size
+        );
+        return;
+    }
+
+    for(i=0; i<num; i++) {
+        vmirtMapNativeMemory(domains[i], base, highPA, host);
+        vmirtProtectMemory(
+            domains[i], base, highPA, MEM_PRIV_NONE, MEM_PRIV_SET
+        );
+    }
+
+    htif->window = host;
+}
+
+//
+// Release the mmap window at the end of simulation
+//
+static void unmapWindow(riscvHTIFP htif) {
+
+    if(htif->window) {
+        munmap(htif->window, htif->riscv->configInfo.htif_mmap_size);
+        htif->window = 0;
+    }
+}
+
+//
+// Return guest memory privilege for proxied mmap protection
+//
+static memPriv getMapPriv(Uns64 prot) {
+
+    memPriv priv = MEM_PRIV_NONE;
+
+    if(prot & HTIF_PROT_READ)  {priv |= MEM_PRIV_R;}
+    if(prot & HTIF_PROT_WRITE) {priv |= MEM_PRIV_W;}
+    if(prot & HTIF_PROT_EXEC)  {priv |= MEM_PRIV_X;}
+
+    return priv;
+}
+
+//
+// Return the mapping at the given address (or a free mapping slot if addr is
+// zero), or null if there is none
+//
+static htifMapP findMap(riscvHTIFP htif, Uns64 addr) {
+
+    Uns32 i;
+
+    for(i=0; i<RISCV_HTIF_MAPS; i++) {
+
+        htifMapP map = &htif->maps[i];
+
+        if(addr ? (map->used && (map->addr==addr)) : !map->used) {
+            return map;
+        }
+    }
+
+    return 0;
+}
+
+//
+// Return a Boolean indicating whether the given range lies in the mmap window
+// and does not overlap an existing mapping
+//
+static Bool validMapRange(riscvHTIFP htif, Uns64 addr, Uns64 bytes) {
+
+    Uns64 base = htif->riscv->configInfo.htif_mmap_base;
+    Uns64 size = htif->riscv->configInfo.htif_mmap_size;
+    Uns32 i;
+
+    if((addr<base) || (bytes>size) || (addr-base > size-bytes)) {
+        return False;
+    }
+
+    for(i=0; i<RISCV_HTIF_MAPS; i++) {
+
+        htifMapP map = &htif->maps[i];
+
+        if(
+            map->used &&
+            (addr < map->addr+map->bytes) &&
+            (map->addr < addr+bytes)
+        ) {
+            return False;
+        }
+    }
+
+    return True;
+}
+
+//
+// Proxied mmap: map a host file directly into the mmap window at the given
+// nonzero physical address, so that accesses to it need no copying. Guest
+// access is restricted by prot. With MAP_SHARED guest stores update the file;
+// with MAP_PRIVATE they modify guest memory only. The mapping must not extend
+// beyond the end of the file.
+//
+static Int64 sysMmap(
+    riscvHTIFP htif,
+    Uns64      addr,
+    Uns64      length,
+    Uns64      prot,
+    Uns64      flags,
+    Uns64      fd,
+    Uns64      offset
+) {
+    FILE       *file     = getFile(htif, fd);
+    Uns64       pageSize = sysconf(_SC_PAGESIZE);
+    Uns64       bytes    = (length+pageSize-1) & -pageSize;
+    Uns64       type     = flags & HTIF_MAP_TYPE;
+    htifMapP    map      = findMap(htif, 0);
+    struct stat st;
+
+    if(!htif->window) {
+        return -HTIF_ENOSYS;
+    } else if(!file || fstat(fileno(file), &st)) {
+        return -HTIF_EBADF;
+    } else if(!addr || !length || ((addr|offset) & (pageSize-1))) {
+        return -HTIF_EINVAL;
+    } else if((type!=HTIF_MAP_SHARED) && (type!=HTIF_MAP_PRIVATE)) {
+        return -HTIF_EINVAL;
+    } else if(flags & HTIF_MAP_ANONYMOUS) {
+        return -HTIF_EINVAL;
+    } else if(offset+bytes > ((st.st_size+pageSize-1) & -pageSize)) {
+        return -HTIF_EINVAL;
+    } else if(!validMapRange(htif, addr, bytes)) {
+        return -HTIF_EINVAL;
+    } else if(!map) {
+        return -HTIF_ENOMEM;
+    }
+
+    // replace window host memory with the file (the host address backing the
+    // guest range does not change)
+    void *host = mmap(
+        htif->window + (addr-htif->riscv->configInfo.htif_mmap_base),
+        bytes,
+        (prot & HTIF_PROT_WRITE) ? PROT_READ|PROT_WRITE : PROT_READ,
+        MAP_FIXED | ((type==HTIF_MAP_SHARED) ? MAP_SHARED : MAP_PRIVATE),
+        fileno(file),
+        offset
+    );
+
+    if(host==MAP_FAILED) {
+        Int64 result = (errno==EACCES) ? -HTIF_EACCES : -HTIF_ENOMEM;
+        clearWindow(htif, addr, bytes);
+        return result;
+    }
+
+    // allow guest access with requested protection
+    protectWindow(htif, addr, bytes, getMapPriv(prot));
+
+    // record mapping so that it can be released
+    map->used  = True;
+    map->addr  = addr;
+    map->bytes = bytes;
+
+    return addr;
+}
+
+//
+// Proxied munmap: only entire mappings made by mmap can be released; the range
+// becomes inaccessible to the guest again
+//
+static Int64 sysMunmap(riscvHTIFP htif, Uns64 addr, Uns64 length) {
+
+    Uns64    pageSize = sysconf(_SC_PAGESIZE);
+    Uns64    bytes    = (length+pageSize-1) & -pageSize;
+    htifMapP map      = addr ? findMap(htif, addr) : 0;
+
+    if(!map || (map->bytes!=bytes)) {
+        return -HTIF_EINVAL;
+    }
+
+    protectWindow(htif, addr, bytes, MEM_PRIV_NONE);
+    clearWindow(htif, addr, bytes);
+
+    map->used = False;
+
+    return 0;
+}
+
+#endif
+
+//
+// Handle a proxied system call described by the eight-word block at the given
+// address, writing the result to the first word
+//
+static void doSyscall(riscvHTIFP htif, Uns64 address) {
+
+    riscvP riscv = htif->riscv;
+    Uns64  args[8];
+    Int64  result;
+    Uns32  i;
+
+    for(i=0; i<8; i++) {
+        args[i] = readGuest8(riscv, address+i*8);
+    }
+
+    switch(args[0]) {
+
+        case HTIF_SYS_EXIT:
+        case HTIF_SYS_EXIT_GROUP:
+            doExit(htif, args[1]);
+            return;
+
+        case HTIF_SYS_OPENAT:
+            result = sysOpenAt(htif, args[2], args[3]);
+            break;
+
+        case HTIF_SYS_CLOSE:
+            result = sysClose(htif, args[1]);
+            break;
+
+        case HTIF_SYS_LSEEK:
+            result = sysLseek(htif, args[1], args[2], args[3]);
+            break;
+
+        case HTIF_SYS_READ:
+            result = sysRead(htif, args[1], args[2], args[3]);
+            break;
+
+        case HTIF_SYS_WRITE:
+            result = sysWrite(htif, args[1], args[2], args[3]);
+            break;
+
+        case HTIF_SYS_FSTAT:
+            result = sysFstat(htif, args[1], args[2]);
+            break;
+
+        case HTIF_SYS_MMAP:
+            result = sysMmap(
+                htif, args[1], args[2], args[3], args[4], args[5], args[6]
+            );
+            break;
+
+        case HTIF_SYS_MUNMAP:
+            result = sysMunmap(htif, args[1], args[2]);
+            break;
+
+        default:
+            vmiMessage("W", CPU_PREFIX "_HTS",
+                NO_SRCREF_FMT "unsupported HTIF system call "FMT_64u,
+                NO_SRCREF_ARGS(riscv), args[0]
+            );
+            result = -HTIF_ENOSYS;
+            break;
+    }
+
+    writeGuest8(riscv, address, result);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// HTIF REGISTERS
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Handle a command written to tohost
+//
+static void doCommand(riscvHTIFP htif, Uns64 command) {
+
+    riscvP riscv   = htif->riscv;
+    Uns32  device  = command >> 56;
+    Uns32  cmd     = (command >> 48) & 0xff;
+    Uns64  payload = command & 0xffffffffffffULL;
+
+    // command has been accepted
+    htif->value[HTIF_TOHOST] = 0;
+
+    if((device==HTIF_DEV_SYSCALL) && (payload&1)) {
+
+        // test exit with code in upper payload bits
+        doExit(htif, payload>>1);
+
+    } else if(device==HTIF_DEV_SYSCALL) {
+
+        // proxied system call, then respond
+        doSyscall(htif, payload);
+        htif->value[HTIF_FROMHOST] = 1;
+
+    } else if((device==HTIF_DEV_CONSOLE) && (cmd==HTIF_CMD_PUTCHAR)) {
+
+        char ch = payload;
+
+        writeConsole(htif, &ch, 1);
+
+    } else {
+
+        vmiMessage("W", CPU_PREFIX "_HTC",
+            NO_SRCREF_FMT "unsupported HTIF command 0x"FMT_6408x,
+            NO_SRCREF_ARGS(riscv), command
+        );
+    }
+}
+
+//
+// Return HTIF register and byte offset for the given address
+//
+static htifReg getReg(riscvHTIFP htif, Uns64 address, Uns32 *offsetP) {
+
+    htifReg reg = HTIF_TOHOST;
+
+    if((address-htif->address[HTIF_TOHOST]) >= 8) {
+        reg = HTIF_FROMHOST;
+    }
+
+    *offsetP = address-htif->address[reg];
+
+    return reg;
+}
+
+//
+// Read HTIF register
+//
+static VMI_MEM_READ_FN(readHTIF) {
+
+    riscvHTIFP htif   = userData;
+    Uns8      *value8 = value;
+    Uns32      offset;
+    htifReg    reg    = getReg(htif, address, &offset);
+    Uns32      i;
+
+    for(i=0; (i<bytes) && (offset+i<8); i++) {
+        value8[i] = htif->value[reg] >> ((offset+i)*8);
+    }
+}
+
+//
+// Write HTIF register (a tohost command is handled when its most-significant
+// byte is written, so that it may be written as two 32-bit halves)
+//
+static VMI_MEM_WRITE_FN(writeHTIF) {
+
+    riscvHTIFP  htif   = userData;
+    const Uns8 *value8 = value;
+    Uns32       offset;
+    htifReg     reg    = getReg(htif, address, &offset);
+    Uns32       i;
+
+    for(i=0; (i<bytes) && (offset+i<8); i++) {
+
+        Uns32 shift = (offset+i)*8;
+
+        htif->value[reg] &= ~(0xffULL << shift);
+        htif->value[reg] |= (Uns64)value8[i] << shift;
+    }
+
+    if((reg==HTIF_TOHOST) && (offset+i==8) && htif->value[reg]) {
+        doCommand(htif, htif->value[reg]);
+    }
+}
+
+//
+// Install HTIF register callbacks at the given address in each distinct PMP
+// data domain of the hart (all data accesses, whether physical or virtual,
+// are made through these domains)
+//
+static void mapRegister(riscvHTIFP htif, Uns64 address) {
+
+    riscvP    riscv = htif->riscv;
+    riscvMode mode;
+    riscvMode prev;
+
+    for(mode=0; mode<RISCV_MODE_LAST; mode++) {
+
+        memDomainP domain = riscv->pmpDomains[mode][0];
+
+        // skip domains shared with a lower mode
+        for(prev=0; prev<mode; prev++) {
+            if(riscv->pmpDomains[prev][0]==domain) {
+                break;
+            }
+        }
+
+        if(domain && (prev==mode)) {
+            vmirtMapCallbacks(
+                domain, address, address+7, readHTIF, writeHTIF, htif
+            );
+        }
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// PUBLIC INTERFACE
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Allocate HTIF device structures if the HTIF device is enabled (the device is
+// owned by the first hart only)
+//
+void riscvHTIFNew(riscvP riscv, Uns32 index) {
+
+    if(riscv->configInfo.htif && !index) {
+
+        riscvHTIFP htif = STYPE_CALLOC(riscvHTIF);
+
+        htif->riscv    = riscv;
+        htif->files[0] = stdin;
+        htif->files[1] = stdout;
+        htif->files[2] = stderr;
+
+        riscv->htif = htif;
+    }
+}
+
+//
+// Bind the HTIF device to the tohost and fromhost symbols (once only, when
+// the first instruction is translated, so that the program symbols are known)
+//
+void riscvHTIFBind(riscvP riscv) {
+
+    riscvHTIFP htif = riscv->htif;
+
+    if(!htif->bound) {
+
+        Uns64 *address = htif->address;
+
+        htif->bound = True;
+
+        mapWindow(htif);
+
+        if(!getSymbolAddress(riscv, RISCV_HTIF_TOHOST, &address[HTIF_TOHOST])) {
+
+            vmiMessage("W", CPU_PREFIX "_HTB",
+                NO_SRCREF_FMT "HTIF symbol '%s' not found - HTIF disabled",
+                NO_SRCREF_ARGS(riscv), RISCV_HTIF_TOHOST
+            );
+
+        } else {
+
+            mapRegister(htif, address[HTIF_TOHOST]);
+
+            // fromhost is optional (but must not overlap tohost)
+            if(
+                getSymbolAddress(
+                    riscv, RISCV_HTIF_FROMHOST, &address[HTIF_FROMHOST]
+                ) &&
+                ((address[HTIF_FROMHOST]-address[HTIF_TOHOST]) >= 8)
+            ) {
+                mapRegister(htif, address[HTIF_FROMHOST]);
+            }
+        }
+    }
+}
+
+//
+// Free HTIF device structures, flushing buffered console output
+//
+void riscvHTIFFree(riscvP riscv) {
+
+    riscvHTIFP htif = riscv->htif;
+
+    if(htif) {
+
+        Uns32 fd;
+
+        flushConsole(htif);
+
+        for(fd=3; fd<RISCV_HTIF_FILES; fd++) {
+            if(htif->files[fd]) {
+                fclose(htif->files[fd]);
+            }
+        }
+
+        unmapWindow(htif);
+
+        if(htif->xfer) {
+            STYPE_FREE(htif->xfer);
+        }
+
+        STYPE_FREE(htif);
+
+        riscv->htif = 0;
+    }
+}
+
@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2005-2020 Imperas Software Ltd., www.imperas.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied.
+ *
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#pragma once
+
+// Imperas header files
+#include "hostapi/impTypes.h"
+
+// model header files
+#include "riscvTypeRefs.h"
+
+//
+// Allocate HTIF device structures if the HTIF device is enabled
+//
+void riscvHTIFNew(riscvP riscv, Uns32 index);
+
+//
+// Bind the HTIF device to the tohost and fromhost symbols (once only)
+//
+void riscvHTIFBind(riscvP riscv);
+
+//
+// Free HTIF device structures, flushing buffered console output
+//
+void riscvHTIFFree(riscvP riscv);
+
@@ -28,17 +28,25 @@
 
 // Model header files
 #include "riscvCluster.h"
+#include "riscvBBV.h"
 #include "riscvBus.h"
 #include "riscvConfig.h"
 #include "riscvCSR.h"
 #include "riscvDebug.h"
 #include "riscvDoc.h"
 #include "riscvExceptions.h"
+#include "riscvForkServer.h"
+#include "riscvHTIF.h"
 #include "riscvFunctions.h"
 #include "riscvMessage.h"
+#include "riscvMetrics.h"
 #include "riscvMorph.h"
 #include "riscvParameters.h"
+#include "riscvStateExport.h"
+#include "riscvStats.h"
 #include "riscvStructure.h"
+#include "riscvTiming.h"
+#include "riscvTransaction.h"
 #include "riscvUtils.h"
 #include "riscvVM.h"
 #include "riscvVMConstants.h"
@@ -90,6 +98,10 @@ static void initLeafModelCBs(riscvP riscv) {
 
     // from riscvCSR.h
     riscv->cb.newCSR             = riscvNewCSR;
+
+    // from riscvTransaction.h
+    riscv->cb.tCommit            = riscvTLogCommit;
+    riscv->cb.tAbort             = riscvTLogAbort;
 }
 
 //
@@ -237,6 +249,7 @@ static void applyParamsSMP(riscvP riscv, riscvParamValuesP params) {
     cfg->dexc_address      = params->dexc_address;
     cfg->updatePTEA        = params->updatePTEA;
     cfg->updatePTED        = params->updatePTED;
+    cfg->tlb_prefetch      = params->tlb_prefetch;
     cfg->unaligned         = params->unaligned;
     cfg->unalignedAMO      = params->unalignedAMO;
     cfg->wfi_is_nop        = params->wfi_is_nop;
@@ -259,6 +272,8 @@ static void applyParamsSMP(riscvP riscv, riscvParamValuesP params) {
     cfg->Zvlsseg           = params->Zvlsseg;
     cfg->Zvamo             = params->Zvamo;
     cfg->Zvediv            = params->Zvediv;
+    cfg->lazy_tail_zero    = params->lazy_tail_zero;
+    cfg->pm_key_variants   = params->pm_key_variants;
     cfg->CLICLEVELS        = params->CLICLEVELS;
     cfg->CLICANDBASIC      = params->CLICANDBASIC;
     cfg->CLICVERSION       = params->CLICVERSION;
@@ -269,6 +284,65 @@ static void applyParamsSMP(riscvP riscv, riscvParamValuesP params) {
     cfg->CLICMNXTI         = params->CLICMNXTI;
     cfg->CLICMCSW          = params->CLICMCSW;
 
+    // get timing model configuration
+    cfg->timing_model        = params->timing_model;
+    cfg->timing_lat_alu      = params->timing_lat_alu;
+    cfg->timing_lat_mul      = params->timing_lat_mul;
+    cfg->timing_lat_div      = params->timing_lat_div;
+    cfg->timing_lat_load     = params->timing_lat_load;
+    cfg->timing_lat_store    = params->timing_lat_store;
+    cfg->timing_lat_branch   = params->timing_lat_branch;
+    cfg->timing_lat_jump     = params->timing_lat_jump;
+    cfg->timing_lat_fp       = params->timing_lat_fp;
+    cfg->timing_lat_fdiv     = params->timing_lat_fdiv;
+    cfg->timing_lat_system   = params->timing_lat_system;
+    cfg->timing_lat_vector   = params->timing_lat_vector;
+    cfg->timing_icache_size  = params->timing_icache_size;
+    cfg->timing_dcache_size  = params->timing_dcache_size;
+    cfg->timing_cache_line   = powerOfTwo(
+        params->timing_cache_line, "timing_cache_line"
+    );
+    cfg->timing_cache_ways   = params->timing_cache_ways;
+    cfg->timing_cache_miss   = params->timing_cache_miss;
+    cfg->timing_tlb_entries  = params->timing_tlb_entries;
+    cfg->timing_tlb_miss     = params->timing_tlb_miss;
+    cfg->timing_bp_entries   = params->timing_bp_entries;
+    cfg->timing_mispredict   = params->timing_mispredict;
+    cfg->timing_time_divisor = params->timing_time_divisor;
+
+    // get spin loop detection configuration
+    cfg->spin_loop_limit     = params->spin_loop_limit;
+    cfg->spin_loop_exit_code = params->spin_loop_exit_code;
+
+    // get fork server configuration
+    cfg->fork_server          = params->fork_server;
+    cfg->fork_marker          = params->fork_marker;
+    cfg->fork_payloads        = params->fork_payloads;
+    cfg->fork_payload_address = params->fork_payload_address;
+
+    // get HTIF device configuration
+    cfg->htif           = params->htif;
+    cfg->htif_mmap_base = params->htif_mmap_base;
+    cfg->htif_mmap_size = params->htif_mmap_size;
+
+    // get statistics configuration
+    cfg->statistics      = params->statistics;
+    cfg->statistics_file = params->statistics_file;
+
+    // get live metrics configuration
+    cfg->metrics_file     = params->metrics_file;
+    cfg->metrics_interval = params->metrics_interval;
+
+    // get basic block vector profiling configuration
+    cfg->bbv_file        = params->bbv_file;
+    cfg->bbv_interval    = params->bbv_interval;
+    cfg->bbv_checkpoints = params->bbv_checkpoints;
+
+    // get architectural state export configuration
+    cfg->export_file   = params->export_file;
+    cfg->export_icount = params->export_icount;
+    cfg->export_symbol = params->export_symbol;
+
     // set number of children
     Bool isSMPMember = riscv->parent && !riscvIsCluster(riscv->parent);
     cfg->numHarts = isSMPMember ? 0 : params->numHarts;
@@ -443,6 +517,27 @@ VMI_CONSTRUCTOR_FN(riscvConstructor) {
         // allocate CLIC data structures
         riscvNewCLIC(riscv, smpContext->index);
 
+        // allocate timing model structures
+        riscvTimingNew(riscv);
+
+        // allocate fork server structures
+        riscvForkServerNew(riscv, smpContext->index);
+
+        // allocate HTIF device structures
+        riscvHTIFNew(riscv, smpContext->index);
+
+        // enable event counting and install statistics commands
+        riscvStatsNew(riscv);
+
+        // start publishing live metrics
+        riscvMetricsNew(riscv);
+
+        // allocate basic block vector profiling structures
+        riscvBBVNew(riscv);
+
+        // allocate architectural state export structures
+        riscvStateExportNew(riscv);
+
         // do initial reset
         riscvReset(riscv);
     }
@@ -469,9 +564,31 @@ VMI_DESTRUCTOR_FN(riscvDestructor) {
 
     riscvP riscv = (riscvP)processor;
 
+    // free fork server structures (before memory domains are freed)
+    riscvForkServerFree(riscv);
+
+    // free HTIF device structures, flushing console output
+    riscvHTIFFree(riscv);
+
+    // export architectural state at exit if required (before memory domains
+    // are freed)
+    riscvStateExportFree(riscv);
+
+    // write final basic block vector interval
+    riscvBBVFree(riscv);
+
+    // publish final live metrics
+    riscvMetricsFree(riscv);
+
+    // report and free statistics
+    riscvStatsFree(riscv);
+
     // free register descriptions
     riscvFreeRegInfo(riscv);
 
+    // free transaction log (before memory domains are freed)
+    riscvTLogFree(riscv);
+
     // free virtual memory structures
     riscvVMFree(riscv);
 
@@ -498,6 +615,9 @@ VMI_DESTRUCTOR_FN(riscvDestructor) {
 
     // free CLIC data structures
     riscvFreeCLIC(riscv);
+
+    // free timing model structures
+    riscvTimingFree(riscv);
 }
 
 
@@ -584,6 +704,7 @@ VMI_SAVE_STATE_FN(riscvSaveState) {
 
         case SRT_BEGIN_CORE:
             // start of individual core
+            riscvVMaterializeTails(riscv);
             break;
 
         case SRT_END_CORE:
@@ -614,6 +735,9 @@ VMI_SAVE_STATE_FN(riscvSaveState) {
     // save timer state not covered by register read/write API
     riscvTimerSave(riscv, cxt, phase);
 
+    // save timing model state not covered by register read/write API
+    riscvTimingSave(riscv, cxt, phase);
+
     // end of SMP cluster
     if(phase==SRT_END) {
         vmirtIterAllProcessors(processor, endSave, 0);
@@ -637,6 +761,8 @@ VMI_RESTORE_STATE_FN(riscvRestoreState) {
         case SRT_BEGIN_CORE:
             // start of individual core
             riscvUpdateExclusiveAccessCallback(riscv, False);
+            riscvTLogAbort(riscv);
+            riscvVMaterializeTails(riscv);
             break;
 
         case SRT_END_CORE:
@@ -669,6 +795,9 @@ VMI_RESTORE_STATE_FN(riscvRestoreState) {
     // restore timer state not covered by register read/write API
     riscvTimerRestore(riscv, cxt, phase);
 
+    // restore timing model state not covered by register read/write API
+    riscvTimingRestore(riscv, cxt, phase);
+
     // end of SMP cluster
     if(phase==SRT_END) {
         vmirtIterAllProcessors(processor, endRestore, 0);
@@ -0,0 +1,326 @@
+/*
+ * Copyright (c) 2005-2020 Imperas Software Ltd., www.imperas.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied.
+ *
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// standard header files
+#include <string.h>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+// Imperas header files
+#include "hostapi/impAlloc.h"
+
+// VMI header files
+#include "vmi/vmiMessage.h"
+#include "vmi/vmiRt.h"
+
+// model header files
+#include "riscvMessage.h"
+#include "riscvMetrics.h"
+#include "riscvStructure.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// TYPES
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Live metrics file layout
+//
+typedef struct riscvMetricsFileS {
+    riscvMetricsHeader header;
+    riscvMetricsRecord records[RISCV_METRICS_MAX_HARTS];
+} riscvMetricsFile, *riscvMetricsFileP;
+
+//
+// Per-hart live metrics state
+//
+typedef struct riscvMetricsS {
+    riscvMetricsRecord *record;     // published record for this hart
+    vmiModelTimerP      timer;      // update timer
+    Uns32               interval;   // update interval (instructions)
+    Uns64               lastTime;   // host time at last update (us)
+    Uns64               lastRetired;// instructions at last update
+    Uns64               lastTraps;  // traps at last update
+    Uns64               lastMisses; // TLB misses at last update
+} riscvMetrics;
+
+//
+// Metrics file shared by all harts in this simulation
+//
+static riscvMetricsFileP metricsFile;
+static Uns32             metricsUsers;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// UTILITIES
+////////////////////////////////////////////////////////////////////////////////
+
+#if !defined(_WIN32)
+
+//
+// Return current program counter
+//
+inline static Uns64 getPC(riscvP riscv) {
+    return vmirtGetPC((vmiProcessorP)riscv);
+}
+
+//
+// Return current host time in microseconds
+//
+static Uns64 getHostTime(void) {
+
+    struct timeval tv;
+
+    gettimeofday(&tv, 0);
+
+    return (tv.tv_sec*1000000ULL) + tv.tv_usec;
+}
+
+//
+// Return total traps taken by the hart
+//
+static Uns64 getTraps(riscvP riscv) {
+
+    Uns64 traps = 0;
+    Uns32 i;
+
+    for(i=0; i<RISCV_STATS_CAUSES; i++) {
+        traps += riscv->stats.exceptions[i] + riscv->stats.interrupts[i];
+    }
+
+    return traps;
+}
+
+//
+// Map the shared metrics file, creating it if this is the first user
+//
+static riscvMetricsFileP mapMetricsFile(riscvP riscv, const char *name) {
+
+    if(!metricsFile) {
+
+        Int32 fd = open(name, O_RDWR|O_CREAT|O_TRUNC, 0644);
+        void *map;
+
+        if(fd<0) {
+
+            // no action
+
+        } else if(ftruncate(fd, sizeof(riscvMetricsFile))) {
+
+            close(fd);
+            fd = -1;
+
+        } else if((map=mmap(
+            0, sizeof(riscvMetricsFile), PROT_READ|PROT_WRITE, MAP_SHARED,
+            fd, 0
+        ))!=MAP_FAILED) {
+
+            riscvMetricsFileP file = map;
+
+            memcpy(file->header.magic, RISCV_METRICS_MAGIC, 8);
+            file->header.version     = RISCV_METRICS_VERSION;
+            file->header.maxHarts    = RISCV_METRICS_MAX_HARTS;
+            file->header.recordBytes = sizeof(riscvMetricsRecord);
+
+            metricsFile = file;
+        }
+
+        if(fd>=0) {
+            close(fd);
+        }
+
+        if(!metricsFile) {
+            vmiMessage("E", CPU_PREFIX "_MTF",
+                NO_SRCREF_FMT "cannot create metrics file '%s'",
+                NO_SRCREF_ARGS(riscv), name
+            );
+        }
+    }
+
+    if(metricsFile) {
+        metricsUsers++;
+    }
+
+    return metricsFile;
+}
+
+//
+// Unmap the shared metrics file if this is the last user
+//
+static void unmapMetricsFile(void) {
+
+    if(metricsFile && !--metricsUsers) {
+        munmap(metricsFile, sizeof(riscvMetricsFile));
+        metricsFile = 0;
+    }
+}
+
+//
+// Update the published record for this hart
+//
+static void updateRecord(riscvP riscv) {
+
+    riscvMetricsP       metrics = riscv->metrics;
+    riscvMetricsRecord *record  = metrics->record;
+    Uns64               now     = getHostTime();
+    Uns64               retired = vmirtGetExecutedICount((vmiProcessorP)riscv);
+    Uns64               traps   = getTraps(riscv);
+    Uns64               misses  = riscv->stats.tlbMisses;
+    double              seconds = (now-metrics->lastTime)/1e6;
+
+    // indicate record update is in progress
+    record->sequence++;
+    __sync_synchronize();
+
+    record->updateTime = now;
+    record->retired    = retired;
+    record->PC         = getPC(riscv);
+    record->traps      = traps;
+    record->tlbMisses  = misses;
+    record->mode       = getCurrentMode(riscv);
+
+    if(seconds>0) {
+        record->mips        = (retired-metrics->lastRetired)/seconds/1e6;
+        record->trapRate    = (traps-metrics->lastTraps)/seconds;
+        record->tlbMissRate = (misses-metrics->lastMisses)/seconds;
+    }
+
+    // indicate record update is complete
+    __sync_synchronize();
+    record->sequence++;
+
+    metrics->lastTime    = now;
+    metrics->lastRetired = retired;
+    metrics->lastTraps   = traps;
+    metrics->lastMisses  = misses;
+}
+
+//
+// Metrics update timer callback
+//
+static VMI_ICOUNT_FN(metricsUpdate) {
+
+    riscvP riscv = (riscvP)processor;
+
+    updateRecord(riscv);
+
+    vmirtSetModelTimer(riscv->metrics->timer, riscv->metrics->interval);
+}
+
+#endif
+
+
+////////////////////////////////////////////////////////////////////////////////
+// PUBLIC INTERFACE
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Start publishing live metrics if a metrics file is configured
+//
+void riscvMetricsNew(riscvP riscv) {
+
+    riscvConfigCP cfg  = &riscv->configInfo;
+    const char   *name = cfg->metrics_file;
+
+    if(!name || !name[0]) {
+
+        // no action
+
+#if defined(_WIN32)
+
+    } else {
+
+        vmiMessage("E", CPU_PREFIX "_MTH",
+            NO_SRCREF_FMT "live metrics are not supported on this host",
+            NO_SRCREF_ARGS(riscv)
+        );
+
+#else
+
+    } else if(mapMetricsFile(riscv, name)) {
+
+        riscvMetricsFileP file  = metricsFile;
+        Uns32             index = file->header.numHarts;
+
+        if(index>=RISCV_METRICS_MAX_HARTS) {
+
+            vmiMessage("W", CPU_PREFIX "_MTM",
+                NO_SRCREF_FMT "live metrics not published (more than %u harts)",
+                NO_SRCREF_ARGS(riscv), RISCV_METRICS_MAX_HARTS
+            );
+
+            unmapMetricsFile();
+
+        } else {
+
+            riscvMetricsP       metrics = STYPE_CALLOC(riscvMetrics);
+            riscvMetricsRecord *record  = &file->records[index];
+
+            // claim record slot
+            file->header.numHarts = index+1;
+
+            record->hartId = RD_CSR(riscv, mhartid);
+            strncpy(
+                record->name,
+                vmirtProcessorName((vmiProcessorP)riscv),
+                RISCV_METRICS_NAME_MAX-1
+            );
+
+            metrics->record   = record;
+            metrics->interval = cfg->metrics_interval;
+            metrics->lastTime = getHostTime();
+            metrics->timer    = vmirtCreateModelTimer(
+                (vmiProcessorP)riscv, metricsUpdate, 64, 0
+            );
+
+            vmirtSetModelTimer(metrics->timer, metrics->interval);
+
+            riscv->metrics = metrics;
+        }
+
+#endif
+    }
+}
+
+//
+// Publish final metrics and stop publishing
+//
+void riscvMetricsFree(riscvP riscv) {
+
+    riscvMetricsP metrics = riscv->metrics;
+
+    if(metrics) {
+
+#if !defined(_WIN32)
+        updateRecord(riscv);
+        vmirtDeleteModelTimer(metrics->timer);
+        unmapMetricsFile();
+#endif
+
+        STYPE_FREE(metrics);
+
+        riscv->metrics = 0;
+    }
+}
+
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2005-2020 Imperas Software Ltd., www.imperas.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied.
+ *
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#pragma once
+
+// Imperas header files
+#include "hostapi/impTypes.h"
+
+// model header files
+#include "riscvTypeRefs.h"
+
+//
+// Identification of the live metrics file format (this layout is also decoded
+// by the riscvMetrics.py reader)
+//
+#define RISCV_METRICS_MAGIC     "RVMETRC1"
+#define RISCV_METRICS_VERSION   1
+#define RISCV_METRICS_MAX_HARTS 256
+#define RISCV_METRICS_NAME_MAX  64
+
+//
+// Live metrics file header
+//
+typedef struct riscvMetricsHeaderS {
+    char   magic[8];                        // RISCV_METRICS_MAGIC
+    Uns32  version;                         // RISCV_METRICS_VERSION
+    Uns32  maxHarts;                        // number of record slots
+    Uns32  numHarts;                        // number of record slots used
+    Uns32  recordBytes;                     // size of each record
+} riscvMetricsHeader;
+
+//
+// Live metrics record for one hart (rates apply to the last update interval;
+// sequence is odd while the record is being updated, so readers should retry
+// until they see the same even value before and after reading the record)
+//
+typedef struct riscvMetricsRecordS {
+    Uns64  sequence;                        // update sequence number
+    Uns64  updateTime;                      // host time of update (us)
+    Uns64  retired;                         // instructions executed
+    Uns64  PC;                              // current program counter
+    Uns64  traps;                           // traps taken
+    Uns64  tlbMisses;                       // TLB misses
+    double mips;                            // MIPS
+    double trapRate;                        // traps per second
+    double tlbMissRate;                     // TLB misses per second
+    Uns32  mode;                            // current mode
+    Uns32  hartId;                          // mhartid
+    char   name[RISCV_METRICS_NAME_MAX];    // processor name
+} riscvMetricsRecord;
+
+//
+// Start publishing live metrics if a metrics file is configured
+//
+void riscvMetricsNew(riscvP riscv);
+
+//
+// Publish final metrics and stop publishing
+//
+void riscvMetricsFree(riscvP riscv);
+
@@ -104,6 +104,20 @@ typedef RISCV_GET_DATA_ENDIAN_FN((*riscvGetDataEndianFn));
 #define RISCV_SET_TMODE_FN(_NAME) void _NAME(riscvP riscv, Bool enable)
 typedef RISCV_SET_TMODE_FN((*riscvSetTModeFn));
 
+//
+// Commit the built-in transaction log, writing buffered stores to memory;
+// returns False (discarding the log) if a store by another hart has conflicted
+// with the transaction
+//
+#define RISCV_TCOMMIT_FN(_NAME) Bool _NAME(riscvP riscv)
+typedef RISCV_TCOMMIT_FN((*riscvTCommitFn));
+
+//
+// Discard the built-in transaction log
+//
+#define RISCV_TABORT_FN(_NAME) void _NAME(riscvP riscv)
+typedef RISCV_TABORT_FN((*riscvTAbortFn));
+
 //
 // Check for pending interrupts
 //
@@ -313,6 +327,17 @@ typedef RISCV_TLOAD_FN((*riscvTLoadFn));
 )
 typedef RISCV_TSTORE_FN((*riscvTStoreFn));
 
+//
+// Notifier called when a store by another hart conflicts with the built-in
+// transaction log (called in the context of the storing hart)
+//
+#define RISCV_TCONFLICT_FN(_NAME) void _NAME( \
+    riscvP riscv,               \
+    Addr   VA,                  \
+    void  *clientData           \
+)
+typedef RISCV_TCONFLICT_FN((*riscvTConflictFn));
+
 //
 // Implement PMA check for the given address range
 //
@@ -345,6 +370,18 @@ typedef RISCV_READ_BASE_CSR_FN((*riscvReadBaseCSRFn));
 )
 typedef RISCV_WRITE_BASE_CSR_FN((*riscvWriteBaseCSRFn));
 
+//
+// Return the latency in cycles of the instruction at the given address when
+// the timing model is enabled, or a negative value to use the default latency
+// of its instruction class
+//
+#define RISCV_INSTRUCTION_LATENCY_FN(_NAME) Int32 _NAME( \
+    riscvP riscv,               \
+    Uns64  thisPC,              \
+    void  *clientData           \
+)
+typedef RISCV_INSTRUCTION_LATENCY_FN((*riscvInstructionLatencyFn));
+
 //
 // Container structure for all callbacks implemented by the base model
 //
@@ -384,6 +421,10 @@ typedef struct riscvModelCBS {
     // from riscvCSR.h
     riscvNewCSRFn             newCSR;
 
+    // from riscvTransaction.h
+    riscvTCommitFn            tCommit;
+    riscvTAbortFn             tAbort;
+
 } riscvModelCB;
 
 //
@@ -419,9 +460,13 @@ typedef struct riscvExtCBS {
     riscvIASSwitchFn          switchCB;
     riscvTLoadFn              tLoad;
     riscvTStoreFn             tStore;
+    riscvTConflictFn          tConflict;
 
     // PMA check actions
     riscvPMACheckFn           PMACheck;
 
+    // timing model actions
+    riscvInstructionLatencyFn instructionLatency;
+
 } riscvExtCB;
 
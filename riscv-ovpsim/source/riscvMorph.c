@@ -26,16 +26,23 @@
 #include "vmi/vmiRt.h"
 
 // model header files
+#include "riscvBBV.h"
 #include "riscvBlockState.h"
 #include "riscvCSRTypes.h"
 #include "riscvDecode.h"
 #include "riscvDecodeTypes.h"
 #include "riscvExceptions.h"
+#include "riscvForkServer.h"
+#include "riscvHTIF.h"
 #include "riscvFunctions.h"
 #include "riscvMessage.h"
 #include "riscvMorph.h"
 #include "riscvRegisters.h"
+#include "riscvStateExport.h"
+#include "riscvStats.h"
 #include "riscvStructure.h"
+#include "riscvTiming.h"
+#include "riscvTransaction.h"
 #include "riscvTypeRefs.h"
 #include "riscvUtils.h"
 #include "riscvVM.h"
@@ -159,6 +166,7 @@ typedef struct riscvMorphStateS {
     riscvP           riscv;         // current processor
     Bool             inDelaySlot;   // whether in delay slot
     Uns8             tmpIndex;      // next unallocated temporary index
+    Bool             timingBatch;   // whether timing events may be batched
     riscvVExternalFn externalCB;    // external implementation callback
     void            *userData;      // for externally-implemented operations
 } riscvMorphState;
@@ -213,8 +221,9 @@ inline static riscvArchitecture getCurrentArch(riscvP riscv) {
 //
 // Validate current polymorphic block key
 //
-inline static void emitCheckPolymorphic(void) {
+inline static void emitCheckPolymorphic(riscvP riscv) {
     vmimtPolymorphicBlock(16, RISCV_PM_KEY);
+    riscv->blockState->pmKeyUsed = True;
 }
 
 //
@@ -1041,7 +1050,7 @@ inline static Bool inTransactionMode(riscvMorphStateP state) {
 
     // validate transaction mode state if required
     if(riscv->useTMode) {
-        emitCheckPolymorphic();
+        emitCheckPolymorphic(riscv);
     }
 
     if((riscv->pmKey & PMK_TRANSACTION)) {
@@ -1060,6 +1069,35 @@ inline static Bool inTransactionMode(riscvMorphStateP state) {
     }
 }
 
+//
+// Return a Boolean indicating if transaction mode must be tested at run time
+// instead of by specializing the block on the polymorphic key (required in
+// blocks in which key specialization is limited)
+//
+inline static Bool testTransactionModeRT(riscvMorphStateP state) {
+
+    riscvP riscv = state->riscv;
+
+    return riscv->useTMode && riscv->blockState->pmKeyLimited;
+}
+
+//
+// Emit code to jump to the returned label if transaction mode is enabled at
+// run time
+//
+static vmiLabelP emitTransactionModeJump(riscvMorphStateP state) {
+
+    vmiLabelP tMode = vmimtNewLabel();
+    vmiReg    tmp   = newTmp(state);
+
+    vmimtBinopRRC(16, vmi_AND, tmp, RISCV_PM_KEY, PMK_TRANSACTION, 0);
+    vmimtCompareRCJumpLabel(16, vmi_COND_NE, tmp, 0, tMode);
+
+    freeTmp(state);
+
+    return tMode;
+}
+
 //
 // Do transaction load of up to 8 bytes
 //
@@ -1128,9 +1166,14 @@ static void emitLoadTModeMBO(
     vmiReg           ra,
     memConstraint    constraint
 ) {
+    riscvP    riscv   = state->riscv;
     Bool      sExtend = !state->info.unsExt;
-    memEndian endian  = riscvGetCurrentDataEndianMT(state->riscv);
-    vmiCallFn cb      = (vmiCallFn)doLoadTMode;
+    memEndian endian  = riscvGetCurrentDataEndianMT(riscv);
+    vmiCallFn cb      = (
+        riscvTLogExtensionAccess(riscv) ?
+        (vmiCallFn)doLoadTMode :
+        (vmiCallFn)riscvTLogLoad
+    );
 
     // extend address to 64 bits if required
     ra = emitTransactionVA(state, ra, offset);
@@ -1162,8 +1205,13 @@ static void emitStoreTModeMBO(
     vmiReg           rs,
     memConstraint    constraint
 ) {
-    memEndian endian = riscvGetCurrentDataEndianMT(state->riscv);
-    vmiCallFn cb     = (vmiCallFn)doStoreTMode;
+    riscvP    riscv  = state->riscv;
+    memEndian endian = riscvGetCurrentDataEndianMT(riscv);
+    vmiCallFn cb     = (
+        riscvTLogExtensionAccess(riscv) ?
+        (vmiCallFn)doStoreTMode :
+        (vmiCallFn)riscvTLogStore
+    );
 
     // extend address to 64 bits if required
     ra = emitTransactionVA(state, ra, offset);
@@ -1223,6 +1271,84 @@ static void emitStoreNormalMBO(
     vmimtStoreRRO(memBits, offset, ra, rs, endian, constraint);
 }
 
+//
+// Emit call to process timing model events recorded in the current block
+//
+static void emitTimingFlush(riscvP riscv) {
+
+    riscvBlockStateP blockState = riscv->blockState;
+
+    if(blockState->timingBatch) {
+
+        vmimtArgProcessor();
+        vmimtCall((vmiCallFn)riscvTimingFlushBatch);
+
+        blockState->timingBatch = 0;
+    }
+}
+
+//
+// Emit code to record a timing model event of the given type, returning the
+// index of the entry to fill (the batch is processed first if it is full)
+//
+static Uns32 emitTimingEntry(riscvP riscv, riscvTimingBatchType type) {
+
+    riscvBlockStateP blockState = riscv->blockState;
+
+    if(blockState->timingBatch==RISCV_TIMING_BATCH) {
+        emitTimingFlush(riscv);
+    }
+
+    Uns32 index = blockState->timingBatch++;
+
+    vmimtMoveRC(8,  RISCV_TIMING_ENTRY(index, type), type);
+    vmimtMoveRC(32, RISCV_TIMING_BATCH_NUM, index+1);
+
+    return index;
+}
+
+//
+// Model data access with the timing model if it is enabled (accesses are
+// recorded for batched processing unless the instruction iterates at run time,
+// when the access is modelled immediately)
+//
+static void emitTimingDataAccess(
+    riscvMorphStateP state,
+    vmiReg           ra,
+    Addr             offset,
+    Bool             isStore
+) {
+    riscvP riscv = state->riscv;
+
+    if(riscv->timing) {
+
+        // extend address to 64 bits if required
+        vmiReg VA = emitTransactionVA(state, ra, offset);
+
+        if(state->timingBatch) {
+
+            riscvTimingBatchType type = isStore ? RVTB_STORE : RVTB_LOAD;
+            Uns32                index = emitTimingEntry(riscv, type);
+
+            // record the access
+            vmimtMoveRR(64, RISCV_TIMING_ENTRY(index, address), VA);
+
+        } else {
+
+            vmiCallFn cb = isStore ?
+                (vmiCallFn)riscvTimingStore :
+                (vmiCallFn)riscvTimingLoad;
+
+            // emit call to model the access
+            vmimtArgProcessor();
+            vmimtArgReg(64, VA);
+            vmimtCall(cb);
+        }
+
+        freeTmp(state);
+    }
+}
+
 //
 // Load value from memory for explicit memBits and offset
 //
@@ -1235,7 +1361,23 @@ static void emitLoadCommonMBO(
     Uns64            offset,
     memConstraint    constraint
 ) {
-    if(inTransactionMode(state)) {
+    emitTimingDataAccess(state, ra, offset, False);
+
+    if(testTransactionModeRT(state)) {
+
+        vmiLabelP tMode = emitTransactionModeJump(state);
+        vmiLabelP done  = vmimtNewLabel();
+
+        // normal load if transaction mode is disabled
+        emitLoadNormalMBO(state, rdBits, memBits, offset, rd, ra, constraint);
+        vmimtUncondJumpLabel(done);
+
+        // transaction load if transaction mode is enabled
+        vmimtInsertLabel(tMode);
+        emitLoadTModeMBO(state, rdBits, memBits, offset, rd, ra, constraint);
+        vmimtInsertLabel(done);
+
+    } else if(inTransactionMode(state)) {
         emitLoadTModeMBO(state, rdBits, memBits, offset, rd, ra, constraint);
     } else {
         emitLoadNormalMBO(state, rdBits, memBits, offset, rd, ra, constraint);
@@ -1253,7 +1395,23 @@ static void emitStoreCommonMBO(
     Uns64            offset,
     memConstraint    constraint
 ) {
-    if(inTransactionMode(state)) {
+    emitTimingDataAccess(state, ra, offset, True);
+
+    if(testTransactionModeRT(state)) {
+
+        vmiLabelP tMode = emitTransactionModeJump(state);
+        vmiLabelP done  = vmimtNewLabel();
+
+        // normal store if transaction mode is disabled
+        emitStoreNormalMBO(state, memBits, offset, ra, rs, constraint);
+        vmimtUncondJumpLabel(done);
+
+        // transaction store if transaction mode is enabled
+        vmimtInsertLabel(tMode);
+        emitStoreTModeMBO(state, memBits, offset, ra, rs, constraint);
+        vmimtInsertLabel(done);
+
+    } else if(inTransactionMode(state)) {
         emitStoreTModeMBO(state, memBits, offset, ra, rs, constraint);
     } else {
         emitStoreNormalMBO(state, memBits, offset, ra, rs, constraint);
@@ -1393,6 +1551,86 @@ static RISCV_MORPH_FN(emitBinopRRR) {
     writeReg(riscv, rdA);
 }
 
+//
+// Emit integer divide or remainder, handling divide-by-zero and signed overflow
+// explicitly so that the host operation never faults:
+// - divide by zero: quotient is all ones, remainder is the dividend
+// - signed overflow: quotient is the dividend, remainder is zero
+//
+static void emitDivide(
+    Uns32    bits,
+    vmiBinop binop,
+    vmiReg   rd,
+    vmiReg   rs1,
+    vmiReg   rs2
+) {
+    Bool      isRem    = (binop==vmi_IREM) || (binop==vmi_REM);
+    Bool      isSigned = (binop==vmi_IREM) || (binop==vmi_IDIV);
+    Uns64     ones     = (bits==64) ? -1 : ((1ULL<<bits)-1);
+    Uns64     minInt   = 1ULL<<(bits-1);
+    vmiLabelP notZero  = vmimtNewLabel();
+    vmiLabelP done     = vmimtNewLabel();
+
+    // handle divide by zero
+    vmimtCompareRCJumpLabel(bits, vmi_COND_NE, rs2, 0, notZero);
+
+    if(isRem) {
+        vmimtMoveRR(bits, rd, rs1);
+    } else {
+        vmimtMoveRC(bits, rd, ones);
+    }
+
+    vmimtUncondJumpLabel(done);
+
+    // here if divisor is non-zero
+    vmimtInsertLabel(notZero);
+
+    // handle signed overflow (most-negative dividend divided by -1)
+    if(isSigned) {
+
+        vmiLabelP noOverflow = vmimtNewLabel();
+
+        vmimtCompareRCJumpLabel(bits, vmi_COND_NE, rs2, ones, noOverflow);
+        vmimtCompareRCJumpLabel(bits, vmi_COND_NE, rs1, minInt, noOverflow);
+
+        if(isRem) {
+            vmimtMoveRC(bits, rd, 0);
+        } else {
+            vmimtMoveRR(bits, rd, rs1);
+        }
+
+        vmimtUncondJumpLabel(done);
+
+        // here if operation cannot overflow
+        vmimtInsertLabel(noOverflow);
+    }
+
+    // do divide or remainder
+    vmimtBinopRRR(bits, binop, rd, rs1, rs2, 0);
+
+    // here when result has been assigned
+    vmimtInsertLabel(done);
+}
+
+//
+// Implement integer divide or remainder (three registers)
+//
+static RISCV_MORPH_FN(emitDivopRRR) {
+
+    riscvP       riscv = state->riscv;
+    riscvRegDesc rdA   = getRVReg(state, 0);
+    riscvRegDesc rs1A  = getRVReg(state, 1);
+    riscvRegDesc rs2A  = getRVReg(state, 2);
+    vmiReg       rd    = getVMIReg(riscv, rdA);
+    vmiReg       rs1   = getVMIReg(riscv, rs1A);
+    vmiReg       rs2   = getVMIReg(riscv, rs2A);
+    Uns32        bits  = getRBits(rdA);
+
+    emitDivide(bits, state->attrs->binop, rd, rs1, rs2);
+
+    writeReg(riscv, rdA);
+}
+
 //
 // Implement generic Mulop (three registers, selecting result upper half)
 //
@@ -1618,6 +1856,43 @@ static void checkTargetAddressAlignedR(
     }
 }
 
+//
+// If spin loop detection is enabled and this jump or branch returns to the
+// start of a block in which no instruction can change architectural state,
+// emit a call to check loop progress (if flag is not VMI_NOREG, the check is
+// made only if the flag is True)
+//
+static void emitSpinLoopCheck(riscvMorphStateP state, Uns64 tgt, vmiReg flag) {
+
+    riscvP           riscv      = state->riscv;
+    riscvBlockStateP blockState = riscv->blockState;
+
+    if(
+        riscv->configInfo.spin_loop_limit &&
+        blockState->spinLoop              &&
+        (blockState->spinStartPC==tgt)
+    ) {
+        vmiLabelP noLoop = 0;
+
+        // skip check if flag is False
+        if(!VMI_ISNOREG(flag)) {
+            noLoop = vmimtNewLabel();
+            vmimtCondJumpLabel(flag, False, noLoop);
+        }
+
+        // emit call to check loop progress (loop includes this instruction)
+        vmimtArgProcessor();
+        vmimtArgUns64(tgt);
+        vmimtArgUns32(blockState->spinInstructions+1);
+        vmimtCall((vmiCallFn)riscvSpinLoop);
+
+        // here if loop is not taken
+        if(noLoop) {
+            vmimtInsertLabel(noLoop);
+        }
+    }
+}
+
 //
 // Branch based on register comparison
 //
@@ -1635,6 +1910,18 @@ static RISCV_MORPH_FN(emitBranchRR) {
     // do comparison
     vmimtCompareRR(bits, state->attrs->cond, rs1, rs2, tmp);
 
+    // model branch prediction if timing model is enabled (the branch ends the
+    // block, so all recorded events are processed here)
+    if(riscv->timing) {
+
+        Uns32 index = emitTimingEntry(riscv, RVTB_BRANCH);
+
+        vmimtMoveRC(64, RISCV_TIMING_ENTRY(index, address), state->info.thisPC);
+        vmimtMoveRR(8,  RISCV_TIMING_ENTRY(index, taken),   tmp);
+
+        emitTimingFlush(riscv);
+    }
+
     // validate target address alignment
     if(!isTargetAddressAlignedC(riscv, tgt)) {
 
@@ -1650,6 +1937,9 @@ static RISCV_MORPH_FN(emitBranchRR) {
         vmimtInsertLabel(noBranch);
     }
 
+    // check progress of spin loop if required
+    emitSpinLoopCheck(state, tgt, tmp);
+
     // do branch
     vmimtCondJump(tmp, True, 0, tgt, VMI_NOREG, vmi_JH_RELATIVE);
 }
@@ -1688,6 +1978,12 @@ static RISCV_MORPH_FN(emitJAL) {
         emitTargetAddressUnalignedC(riscv, tgt);
     }
 
+    // check progress of spin loop if required
+    emitSpinLoopCheck(state, tgt, VMI_NOREG);
+
+    // process timing model events recorded in this block
+    emitTimingFlush(riscv);
+
     // emit call using calculated linkPC and adjusted lr
     Uns64 linkPC = getLinkPC(state, &lr);
     vmimtUncondJump(linkPC, tgt, lr, hint|vmi_JH_RELATIVE);
@@ -1726,6 +2022,21 @@ static RISCV_MORPH_FN(emitJALR) {
         hint = vmi_JH_NONE;
     }
 
+    // model target prediction if timing model is enabled (returns are assumed
+    // to be predicted by a return address stack)
+    if(riscv->timing && (hint!=vmi_JH_RETURN)) {
+
+        Uns32  index = emitTimingEntry(riscv, RVTB_INDIRECT);
+        Uns64  PC    = state->info.thisPC;
+        vmiReg tgt   = RISCV_TIMING_ENTRY(index, target);
+
+        vmimtMoveRC(64, RISCV_TIMING_ENTRY(index, address), PC);
+        vmimtMoveExtendRR(64, tgt, bits, ra, False);
+    }
+
+    // process timing model events recorded in this block
+    emitTimingFlush(riscv);
+
     // emit call using calculated linkPC and adjusted lr
     Uns64 linkPC = getLinkPC(state, &lr);
     vmimtUncondJumpReg(linkPC, ra, lr, hint|vmi_JH_RELATIVE);
@@ -2055,6 +2366,9 @@ static vmiLabelP validateEA(
     // indicate store failed
     vmimtMoveRC(rdBits, rd, 1);
 
+    // count failed SC instructions if required
+    riscvStatsEmitInc(state->riscv, RISCV_STATS(scFailures));
+
     // jump to instruction end
     vmimtUncondJumpLabel(done);
 
@@ -2417,7 +2731,13 @@ static void emitCSRRCommon(riscvMorphStateP state, vmiReg rs1, Bool write) {
             }
 
             // do the write
-            riscvEmitCSRWrite(attrs, riscv, rdTmp, rs1Tmp, cbTmp);
+            if(useRS1 && (state->info.csrUpdate!=RV_CSR_RW)) {
+                riscvEmitCSRWriteSetClear(
+                    attrs, riscv, rdTmp, rs1Tmp, cbTmp, rs1
+                );
+            } else {
+                riscvEmitCSRWrite(attrs, riscv, rdTmp, rs1Tmp, cbTmp);
+            }
 
             // adjust code generator state after CSR write if required
             if(attrs->wstateCB) {
@@ -4612,7 +4932,7 @@ static riscvVLMULx8Mt getVLMULMt(riscvMorphStateP state) {
 
     if(VLMULx8==VLMULx8MT_UNKNOWN) {
 
-        emitCheckPolymorphic();
+        emitCheckPolymorphic(riscv);
 
         VLMULx8 = svlmulToVLMULx8(getSVLMUL(riscv));
         blockState->VLMULx8Mt = VLMULx8;
@@ -4632,7 +4952,7 @@ static riscvSEWMt getSEWMt(riscvMorphStateP state) {
 
     if(SEW==SEWMT_UNKNOWN) {
 
-        emitCheckPolymorphic();
+        emitCheckPolymorphic(riscv);
 
         blockState->SEWMt = SEW = vsewToSEW(RD_CSR_FIELD(riscv, vtype, vsew));
     }
@@ -4656,7 +4976,7 @@ static riscvVLClassMt getVLClassMt(riscvMorphStateP state, iterDescP id) {
         Uns32          vl      = RD_CSR(riscv, vl);
         Uns32          vlMax   = id->VLEN*VLMULx8/(SEW*8);
 
-        emitCheckPolymorphic();
+        emitCheckPolymorphic(riscv);
 
         if(!vl) {
             vlClass = VLCLASSMT_ZERO;
@@ -5789,7 +6109,25 @@ static void zeroVdPdTopBLT(
         // iterate over all segment registers affected
         for(i=0; i<=id->nf; i++) {
 
-            if(zeroVd & getTopZeroVdMask(i)) {
+            if(!(zeroVd & getTopZeroVdMask(i))) {
+
+                // no action for this segment register
+
+            } else if(riscv->configInfo.lazy_tail_zero) {
+
+                // get next segment register requiring top-zero
+                riscvRegDesc vdA = getSegmentRegister(id, getRVReg(state, 0), i);
+
+                // record register top part as zero, deferring the zeroing
+                // until the top part is observed
+                vmimtArgProcessor();
+                vmimtArgUns32(getRIndex(vdA));
+                vmimtArgUns32(VLENxN/8);
+                vmimtArgReg(32, t0);
+                vmimtArgUns32(id->SEW/8);
+                vmimtCall((vmiCallFn)riscvVDeferTail);
+
+            } else {
 
                 // get next segment register requiring top-zero
                 vmiReg vd = getSegmentRegisterV0(state, id, i);
@@ -6003,6 +6341,114 @@ static riscvVLClassMt fillVectorOperationData(
     return vlClass;
 }
 
+//
+// Emit code to zero any deferred tail of the indexed vector register group
+// operand that could be observed by this instruction
+//
+static void observeVectorTail(
+    riscvMorphStateP state,
+    iterDescP        id,
+    Uns32            argIndex,
+    riscvRegDesc     rA
+) {
+    riscvVShape vShape   = state->attrs->vShape;
+    vrDescP     vr       = &id->vr[argIndex];
+    Uns32       EMUL     = (vr->type==VRT_VECTOR) ? vr->EMUL : 1;
+    Uns32       EEWBytes = 0;
+
+    // operands accessed only as the first vl elements need only tails that
+    // start below that extent to be zeroed
+    if(
+        (vr->type==VRT_VECTOR)                 &&
+        !state->info.isWhole                   &&
+        !isUnindexedN(vShape, argIndex)        &&
+        !isIndexedVRegisterStriped(id, argIndex)
+    ) {
+        EEWBytes = vr->EEW/8;
+    }
+
+    vmimtArgProcessor();
+    vmimtArgUns32(getRIndex(rA));
+    vmimtArgUns32(EMUL);
+    vmimtArgUns32(EEWBytes);
+    vmimtCall((vmiCallFn)riscvVObserveTail);
+}
+
+//
+// Return mask of the components of the indexed vector register group operand
+//
+static Uns32 getVectorTailMask(iterDescP id, Uns32 argIndex, riscvRegDesc rA) {
+
+    vrDescP vr   = &id->vr[argIndex];
+    Uns32   EMUL = (vr->type==VRT_VECTOR) ? vr->EMUL : 1;
+
+    return ((1ULL<<EMUL)-1) << getRIndex(rA);
+}
+
+//
+// Emit code to zero deferred tails of vector register operands before they
+// are observed by this instruction (tails recorded by riscvVDeferTail)
+//
+static void observeVectorTails(riscvMorphStateP state, iterDescP id) {
+
+    riscvP       riscv = state->riscv;
+    riscvRegDesc mask  = state->info.mask;
+    Uns32        regs  = 0;
+    Uns32        pass;
+
+    if(riscv->configInfo.lazy_tail_zero) {
+
+        vmiLabelP noTail = vmimtNewLabel();
+
+        // first pass computes the registers referenced by the instruction,
+        // second pass zeroes any observed tails if some are pending
+        for(pass=0; pass<2; pass++) {
+
+            Uns32 i, j;
+
+            if(pass) {
+                vmiReg t0 = newTmp(state);
+                vmimtBinopRRC(32, vmi_AND, t0, RISCV_V_TAIL_PENDING, regs, 0);
+                vmimtCompareRCJumpLabel(32, vmi_COND_EQ, t0, 0, noTail);
+                freeTmp(state);
+            }
+
+            // handle vector register operands (including segment registers)
+            for(i=0; i<RV_MAX_AREGS; i++) {
+
+                riscvRegDesc rA = getRVReg(state, i);
+                Uns32        nf = i ? 0 : id->nf;
+
+                if(rA && isVReg(rA)) {
+                    for(j=0; j<=nf; j++) {
+                        riscvRegDesc sr = getSegmentRegister(id, rA, j);
+                        if(pass) {
+                            observeVectorTail(state, id, i, sr);
+                        } else {
+                            regs |= getVectorTailMask(id, i, sr);
+                        }
+                    }
+                }
+            }
+
+            // handle mask register (all mask bits may be observed)
+            if(!mask) {
+                // no action
+            } else if(pass) {
+                vmimtArgProcessor();
+                vmimtArgUns32(getRIndex(mask));
+                vmimtArgUns32(1);
+                vmimtArgUns32(0);
+                vmimtCall((vmiCallFn)riscvVObserveTail);
+            } else {
+                regs |= 1U<<getRIndex(mask);
+            }
+        }
+
+        vmimtInsertLabel(noTail);
+    }
+}
+
 //
 // Emit code to dispatch a vector operation
 //
@@ -6035,6 +6481,9 @@ static RISCV_MORPH_FN(emitVectorOp) {
             riscvVShape vShape = state->attrs->vShape;
             Uns32       SEWMul = getSEWMultiplier(vShape);
 
+            // zero deferred tails observed by this operation
+            observeVectorTails(state, &id);
+
             // start a new vector operation
             startVectorOp(state, &id, True);
 
@@ -6101,6 +6550,9 @@ static RISCV_MORPH_FN(emitScalarOp) {
 
         } else if(scalarD || (vlClass!=VLCLASSMT_ZERO)) {
 
+            // zero deferred tails observed by this operation
+            observeVectorTails(state, &id);
+
             // start a new vector operation
             startVectorOp(state, &id, False);
 
@@ -6237,6 +6689,12 @@ static Uns32 setVLSEWLMUL(riscvP riscv, Uns64 vl, Uns32 vtypeBits) {
     riscvVType vtype = {vtypeBits};
     Bool       vill  = !riscvValidVType(riscv, vtype);
 
+    // zero deferred vector register tails if vtype changes (tails recorded
+    // with the previous element width and grouping are not carried over)
+    if(riscv->vTailPending && (RD_CSR(riscv, vtype)!=vtypeBits)) {
+        riscvVMaterializeTails(riscv);
+    }
+
     // handle illegal vtype setting
     if(vill) {
         vtype.u32 = 0;
@@ -6315,6 +6773,9 @@ static void emitUpdateVTypeVL(riscvMorphStateP state) {
     // indicate written registers
     vmimtRegWriteImpl("vtype");
     vmimtRegWriteImpl("vl");
+
+    // count vsetvl/vsetvli executions if required
+    riscvStatsEmitInc(state->riscv, RISCV_STATS(vsetvl));
 }
 
 //
@@ -7500,6 +7961,17 @@ static RISCV_MORPHV_FN(emitVRBinaryIntCB) {
     vmimtBinopRRR(id->SEW, state->attrs->binop, id->r[0], id->r[1], arg2, 0);
 }
 
+//
+// Per-element callback for integer divide and remainder instructions with two
+// register operands
+//
+static RISCV_MORPHV_FN(emitVRDivideIntCB) {
+
+    vmiReg arg2 = id->r[2];
+
+    emitDivide(id->SEW, state->attrs->binop, id->r[0], id->r[1], arg2);
+}
+
 //
 // Per-element callback for integer instructions with register and constant
 // operands
@@ -8802,6 +9274,359 @@ static RISCV_CHECKV_FN(emitEDIVCheckCB) {
 }
 
 
+////////////////////////////////////////////////////////////////////////////////
+// TIMING MODEL
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Is the binary operation an integer multiply?
+//
+static Bool isMultiplyBinop(vmiBinop binop) {
+    return (binop==vmi_MUL) || (binop==vmi_IMUL) || (binop==vmi_IMULSU);
+}
+
+//
+// Return timing model class for the current instruction
+//
+static riscvTimingClass getTimingClass(riscvMorphStateP state) {
+
+    riscvMorphAttrCP      attrs  = state->attrs;
+    riscvMorphFn          morph  = attrs->morph;
+    octiaInstructionClass iClass = attrs->iClass;
+    octiaInstructionClass sClass = (
+        OCL_IC_SYSTEM|OCL_IC_SYSREG|OCL_IC_IBARRIER|OCL_IC_DBARRIER
+    );
+
+    if(
+        (morph==emitVectorOp)  || (morph==emitScalarOp) ||
+        (morph==emitVSetVLRRR) || (morph==emitVSetVLRRC)
+    ) {
+        return RVTC_VECTOR;
+    } else if((morph==emitLoad) || (morph==emitLR)) {
+        return RVTC_LOAD;
+    } else if(
+        (morph==emitStore)       || (morph==emitSC) ||
+        (morph==emitAMOBinopRRR) || (morph==emitAMOSwapRRR)
+    ) {
+        return RVTC_STORE;
+    } else if(morph==emitBranchRR) {
+        return RVTC_BRANCH;
+    } else if((morph==emitJAL) || (morph==emitJALR)) {
+        return RVTC_JUMP;
+    } else if((iClass & sClass) || (state->info.type==RV_IT_CUSTOM)) {
+        return RVTC_SYSTEM;
+    } else if(state->info.arch & ISA_DF) {
+        return (iClass & (OCL_IC_DIVIDE|OCL_IC_SQRT)) ? RVTC_FDIV : RVTC_FP;
+    } else if(morph==emitDivopRRR) {
+        return RVTC_DIV;
+    } else if((morph!=emitBinopRRR) && (morph!=emitMulopHRRR)) {
+        return RVTC_ALU;
+    } else if(isMultiplyBinop(attrs->binop)) {
+        return RVTC_MUL;
+    } else {
+        return RVTC_ALU;
+    }
+}
+
+//
+// Return static latency of the current instruction, allowing a derived model
+// to override the default for its instruction class
+//
+static Uns32 getTimingLatency(riscvMorphStateP state, riscvTimingClass tClass) {
+
+    riscvP      riscv = state->riscv;
+    riscvExtCBP extCB;
+
+    for(extCB=riscv->extCBs; extCB; extCB=extCB->next) {
+
+        if(extCB->instructionLatency) {
+
+            Int32 latency = extCB->instructionLatency(
+                riscv, state->info.thisPC, extCB->clientData
+            );
+
+            if(latency>=0) {
+                return latency;
+            }
+        }
+    }
+
+    return riscvTimingLatency(riscv, tClass);
+}
+
+//
+// Can an instruction of the given class cause the current block to be left?
+// Accumulated latency must be committed before such instructions.
+//
+static Bool isTimingCommitClass(riscvTimingClass tClass) {
+
+    switch(tClass) {
+
+        case RVTC_ALU:
+        case RVTC_MUL:
+        case RVTC_DIV:
+        case RVTC_FP:
+        case RVTC_FDIV:
+            return False;
+
+        default:
+            return True;
+    }
+}
+
+//
+// Emit timing model update for the current instruction. Static latencies are
+// accumulated at morph time and committed to the cycle count with a single
+// add at points where the block might be left (and at the end of each fetch
+// line). Instruction fetches (once per fetch line), data accesses and branches
+// are recorded inline and processed by a single call before system, vector and
+// jump instructions and at the end of the block.
+//
+static void emitTimingUpdate(riscvMorphStateP state) {
+
+    riscvP           riscv      = state->riscv;
+    riscvBlockStateP blockState = riscv->blockState;
+    riscvTimingClass tClass     = getTimingClass(state);
+    Uns32            shift      = riscvTimingFetchShift(riscv);
+    Uns64            thisPC     = state->info.thisPC;
+    Uns64            nextPC     = thisPC + state->info.bytes;
+    Uns64            thisLine   = (thisPC>>shift) + 1;
+
+    // events are processed before instructions that could observe or change
+    // timing model state; vector instructions model accesses immediately
+    // because they iterate at run time
+    if((tClass==RVTC_SYSTEM) || (tClass==RVTC_VECTOR)) {
+        emitTimingFlush(riscv);
+    } else {
+        state->timingBatch = True;
+    }
+
+    // record instruction fetch when a new line is entered
+    if(blockState->timingLine!=thisLine) {
+
+        Uns32 index = emitTimingEntry(riscv, RVTB_FETCH);
+
+        blockState->timingLine = thisLine;
+
+        vmimtMoveRC(64, RISCV_TIMING_ENTRY(index, address), thisPC);
+    }
+
+    // accumulate static latency of this instruction
+    blockState->timingCycles += getTimingLatency(state, tClass);
+
+    // commit accumulated latency if required
+    if(
+        blockState->timingCycles &&
+        (isTimingCommitClass(tClass) || ((nextPC>>shift)+1 != thisLine))
+    ) {
+        vmimtBinopRC(
+            64, vmi_ADD, RISCV_TIMING_CYCLES, blockState->timingCycles, 0
+        );
+        blockState->timingCycles = 0;
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// STATISTICS
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Return the index of the extension to which the instruction is attributed:
+// the highest-lettered extension it requires other than C (so that, for
+// example, compressed floating point loads are attributed to F or D), or I
+// for base instructions
+//
+static Uns32 getStatsExtension(riscvMorphStateP state) {
+
+    riscvArchitecture letters = (
+        state->info.arch &
+        (RISCV_FEATURE_BIT('Z')*2-1) &
+        ~ISA_C
+    );
+    Uns32 index = RISCV_FEATURE_INDEX('I');
+
+    if(letters) {
+        for(index=RISCV_FEATURE_INDEX('Z'); !(letters & (1<<index)); index--) {
+            // no action
+        }
+    } else if(state->info.arch & ISA_C) {
+        index = RISCV_FEATURE_INDEX('C');
+    }
+
+    return index;
+}
+
+//
+// Emit code to update instruction statistics, recording the start address of
+// each new block
+//
+static void emitStatsUpdate(riscvMorphStateP state) {
+
+    riscvP           riscv      = state->riscv;
+    riscvBlockStateP blockState = riscv->blockState;
+
+    if(blockState->statsBlockStart) {
+        riscvStatsBlock(riscv, state->info.thisPC);
+        blockState->statsBlockStart = False;
+    }
+
+    riscvStatsEmitInc(riscv, RISCV_STATS(extension[getStatsExtension(state)]));
+    riscvStatsEmitInc(riscv, RISCV_STATS(iClass[getTimingClass(state)]));
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// BASIC BLOCK VECTOR PROFILING
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Emit code to record entry to a new block for BBV profiling (the block
+// identifier is allocated when the block is translated)
+//
+static void emitBBVBlock(riscvMorphStateP state) {
+
+    riscvP           riscv      = state->riscv;
+    riscvBlockStateP blockState = riscv->blockState;
+
+    if(blockState->bbvBlockStart) {
+
+        Uns32 id = riscvBBVBlockId(riscv, state->info.thisPC);
+
+        vmimtArgProcessor();
+        vmimtArgUns32(id);
+        vmimtCall((vmiCallFn)riscvBBVBlock);
+
+        blockState->bbvBlockStart = False;
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// SPIN LOOP DETECTION
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Can the instruction just translated be part of a loop that makes no
+// progress? This is the case for stores (which are idempotent when repeated),
+// branches, direct jumps, fences and instructions that write constant values
+// to registers
+//
+static Bool isSpinLoopInstruction(riscvMorphStateP state) {
+
+    riscvMorphFn morph = state->attrs->morph;
+
+    return (
+        (morph==emitStore)    ||
+        (morph==emitBranchRR) ||
+        (morph==emitJAL)      ||
+        (morph==emitNOP)      ||
+        (morph==emitMoveRC)   ||
+        (morph==emitMoveRPC)
+    );
+}
+
+//
+// Update spin loop detection state before an instruction is translated
+//
+static void startSpinLoopInstruction(riscvMorphStateP state) {
+
+    riscvBlockStateP blockState = state->riscv->blockState;
+
+    // record the address of the first instruction in the block
+    if(!blockState->spinInstructions) {
+        blockState->spinStartPC = state->info.thisPC;
+    }
+}
+
+//
+// Update spin loop detection state after an instruction is translated
+//
+static void endSpinLoopInstruction(riscvMorphStateP state) {
+
+    riscvBlockStateP blockState = state->riscv->blockState;
+
+    blockState->spinInstructions++;
+
+    if(!isSpinLoopInstruction(state)) {
+        blockState->spinLoop = False;
+    }
+}
+
+//
+// Is tracking of polymorphic block translations required (for statistics or
+// to bound the number of specialized variants of each block)?
+//
+inline static Bool trackPMKey(riscvP riscv) {
+    return (
+        riscv->configInfo.statistics ||
+        riscv->configInfo.pm_key_variants
+    );
+}
+
+//
+// Update polymorphic key tracking state before an instruction is translated;
+// if key specialization of the block is limited, end the block before its
+// key-dependent instruction so that preceding code is translated only once
+//
+static void startPMKeyInstruction(riscvMorphStateP state) {
+
+    riscvP           riscv      = state->riscv;
+    riscvBlockStateP blockState = riscv->blockState;
+    Uns64            thisPC     = state->info.thisPC;
+    Uns64            keyPC;
+
+    // record the address of the first instruction in the block and whether
+    // key specialization of the block is limited
+    if(!blockState->pmKeyPC) {
+
+        blockState->pmKeyPC = thisPC+1;
+
+        if(riscvStatsPMKeyLimited(riscv, thisPC, &keyPC)) {
+            blockState->pmKeyLimited = True;
+            blockState->pmKeyLimitPC = keyPC+1;
+        }
+    }
+
+    // end a limited block before its key-dependent instruction
+    if(
+        blockState->pmKeyLimited &&
+        (thisPC+state->info.bytes+1 == blockState->pmKeyLimitPC)
+    ) {
+        vmimtEndBlock();
+    }
+}
+
+//
+// Update polymorphic key tracking state after an instruction is translated;
+// when the instruction is the first in the block to depend on the key, record
+// the translation and, if the block has been translated with too many key
+// variants, end the block and limit its key specialization (following code is
+// translated separately and preceding code will be translated without key
+// specialization)
+//
+static void endPMKeyInstruction(riscvMorphStateP state) {
+
+    riscvP           riscv      = state->riscv;
+    riscvBlockStateP blockState = riscv->blockState;
+    Uns32            limit      = riscv->configInfo.pm_key_variants;
+
+    if(blockState->pmKeyUsed && !blockState->pmKeyRecorded) {
+
+        Uns64 PC       = blockState->pmKeyPC-1;
+        Uns64 keyPC    = state->info.thisPC;
+        Uns32 variants = riscvStatsPMKey(riscv, PC, keyPC, riscv->pmKey);
+
+        blockState->pmKeyRecorded = True;
+
+        if(limit && (variants>limit)) {
+            riscvStatsPMKeyLimit(riscv, PC);
+            riscv->stats.pmFallbacks++;
+            vmimtEndBlock();
+        }
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // INSTRUCTION TABLE
 ////////////////////////////////////////////////////////////////////////////////
@@ -8828,14 +9653,14 @@ const static riscvMorphAttr dispatchTable[] = {
     [RV_IT_XOR_R]            = {morph:emitBinopRRR,  binop:vmi_XOR,    iClass:OCL_IC_INTEGER},
 
     // M-extension R-type instructions
-    [RV_IT_DIV_R]            = {morph:emitBinopRRR,  binop:vmi_IDIV,   iClass:OCL_IC_INTEGER},
-    [RV_IT_DIVU_R]           = {morph:emitBinopRRR,  binop:vmi_DIV,    iClass:OCL_IC_INTEGER},
+    [RV_IT_DIV_R]            = {morph:emitDivopRRR,  binop:vmi_IDIV,   iClass:OCL_IC_INTEGER},
+    [RV_IT_DIVU_R]           = {morph:emitDivopRRR,  binop:vmi_DIV,    iClass:OCL_IC_INTEGER},
     [RV_IT_MUL_R]            = {morph:emitBinopRRR,  binop:vmi_MUL,    iClass:OCL_IC_INTEGER},
     [RV_IT_MULH_R]           = {morph:emitMulopHRRR, binop:vmi_IMUL,   iClass:OCL_IC_INTEGER},
     [RV_IT_MULHSU_R]         = {morph:emitMulopHRRR, binop:vmi_IMULSU, iClass:OCL_IC_INTEGER},
     [RV_IT_MULHU_R]          = {morph:emitMulopHRRR, binop:vmi_MUL,    iClass:OCL_IC_INTEGER},
-    [RV_IT_REM_R]            = {morph:emitBinopRRR,  binop:vmi_IREM,   iClass:OCL_IC_INTEGER},
-    [RV_IT_REMU_R]           = {morph:emitBinopRRR,  binop:vmi_REM,    iClass:OCL_IC_INTEGER},
+    [RV_IT_REM_R]            = {morph:emitDivopRRR,  binop:vmi_IREM,   iClass:OCL_IC_INTEGER},
+    [RV_IT_REMU_R]           = {morph:emitDivopRRR,  binop:vmi_REM,    iClass:OCL_IC_INTEGER},
 
     // base I-type instructions
     [RV_IT_ADDI_I]           = {morph:emitBinopRRC,  binop:vmi_ADD,    iClass:OCL_IC_INTEGER},
@@ -9007,10 +9832,10 @@ const static riscvMorphAttr dispatchTable[] = {
     [RV_IT_VNCLIP_VR]        = {morph:emitVectorOp, opTCB:emitVRRShiftIntCB, binop:vmi_SAR,      vShape:RVVW_V1I_V2I_V1I_SAT,  argType:RVVX_SS},
 
     // V-extension MVV/MVX-type common instructions
-    [RV_IT_VDIVU_VR]         = {morph:emitVectorOp, opTCB:emitVRBinaryIntCB, binop:vmi_DIV },
-    [RV_IT_VDIV_VR]          = {morph:emitVectorOp, opTCB:emitVRBinaryIntCB, binop:vmi_IDIV},
-    [RV_IT_VREMU_VR]         = {morph:emitVectorOp, opTCB:emitVRBinaryIntCB, binop:vmi_REM },
-    [RV_IT_VREM_VR]          = {morph:emitVectorOp, opTCB:emitVRBinaryIntCB, binop:vmi_IREM},
+    [RV_IT_VDIVU_VR]         = {morph:emitVectorOp, opTCB:emitVRDivideIntCB, binop:vmi_DIV },
+    [RV_IT_VDIV_VR]          = {morph:emitVectorOp, opTCB:emitVRDivideIntCB, binop:vmi_IDIV},
+    [RV_IT_VREMU_VR]         = {morph:emitVectorOp, opTCB:emitVRDivideIntCB, binop:vmi_REM },
+    [RV_IT_VREM_VR]          = {morph:emitVectorOp, opTCB:emitVRDivideIntCB, binop:vmi_IREM},
     [RV_IT_VMUL_VR]          = {morph:emitVectorOp, opTCB:emitVRBinaryIntCB, binop:vmi_IMUL},
     [RV_IT_VMULHU_VR]        = {morph:emitVectorOp, opTCB:emitVRMulHIntCB,   binop:vmi_MUL },
     [RV_IT_VMULHSU_VR]       = {morph:emitVectorOp, opTCB:emitVRMulHIntCB,   binop:vmi_IMULSU},
@@ -9215,6 +10040,29 @@ VMI_START_END_BLOCK_FN(riscvStartBlock) {
     thisState->VZeroTopMt[VTZ_GROUP]  = 0;
     thisState->VStartZeroMt           = forceVStart0(riscv);
 
+    // no timing model state is known initially
+    thisState->timingLine   = 0;
+    thisState->timingCycles = 0;
+    thisState->timingBatch  = 0;
+
+    // block is a candidate spin loop until a state-changing instruction is seen
+    thisState->spinStartPC      = 0;
+    thisState->spinInstructions = 0;
+    thisState->spinLoop         = True;
+
+    // block start address has not yet been recorded in statistics
+    thisState->statsBlockStart = True;
+
+    // block entry has not yet been instrumented for BBV profiling
+    thisState->bbvBlockStart = True;
+
+    // block is not known to be polymorphic initially
+    thisState->pmKeyPC       = 0;
+    thisState->pmKeyUsed     = False;
+    thisState->pmKeyRecorded = False;
+    thisState->pmKeyLimited  = False;
+    thisState->pmKeyLimitPC  = 0;
+
     // inherit any previously-active SEW, VLMUL and VLClass
     if(prevState) {
         thisState->SEWMt     = prevState->SEWMt;
@@ -9237,6 +10085,19 @@ VMI_START_END_BLOCK_FN(riscvEndBlock) {
         "unexpected mismatched blockState at end of block"
     );
 
+    // commit timing model state not yet committed if the block falls through
+    if(riscv->timing) {
+
+        if(thisState->timingCycles) {
+            vmimtBinopRC(
+                64, vmi_ADD, RISCV_TIMING_CYCLES, thisState->timingCycles, 0
+            );
+            thisState->timingCycles = 0;
+        }
+
+        emitTimingFlush(riscv);
+    }
+
     // restore previously-active block state
     riscv->blockState = thisState->prevState;
 }
@@ -9257,6 +10118,7 @@ VMI_MORPH_FN(riscvMorph) {
     state.riscv       = riscv;
     state.inDelaySlot = inDelaySlot;
     state.tmpIndex    = 0;
+    state.timingBatch = False;
 
     // clear mask of X registers targeted by this instruction
     riscv->writtenXMask = 0;
@@ -9297,10 +10159,68 @@ VMI_MORPH_FN(riscvMorph) {
             }
         }
 
+        // run fork server at the marker address if required (a forked child
+        // restarts at the marker after its payload is loaded)
+        if(riscv->forkServer && riscvForkServerIsMarker(riscv, thisPC)) {
+            vmimtArgProcessor();
+            vmimtCallAttrs((vmiCallFn)riscvForkServerRun, VMCA_EXCEPTION);
+        }
+
+        // bind HTIF device to program symbols if required
+        if(riscv->htif) {
+            riscvHTIFBind(riscv);
+        }
+
+        // export architectural state at the export symbol if required
+        if(riscv->stateExport) {
+
+            riscvStateExportBind(riscv);
+
+            if(riscvStateExportIsMarker(riscv, thisPC)) {
+                vmimtArgProcessor();
+                vmimtCall((vmiCallFn)riscvStateExportRun);
+            }
+        }
+
+        // record block entry for BBV profiling if required
+        if(riscv->bbv) {
+            emitBBVBlock(&state);
+        }
+
+        // update timing model if required
+        if(riscv->timing) {
+            emitTimingUpdate(&state);
+        }
+
+        // update statistics if required
+        if(riscv->configInfo.statistics) {
+            emitStatsUpdate(&state);
+        }
+
+        // update spin loop detection state if required
+        if(riscv->configInfo.spin_loop_limit) {
+            startSpinLoopInstruction(&state);
+        }
+
+        // update polymorphic key tracking state if required
+        if(trackPMKey(riscv)) {
+            startPMKeyInstruction(&state);
+        }
+
         // translate the instruction
         vmimtInstructionClassAdd(state.attrs->iClass);
         state.attrs->morph(&state);
 
+        // update spin loop detection state if required
+        if(riscv->configInfo.spin_loop_limit) {
+            endSpinLoopInstruction(&state);
+        }
+
+        // update polymorphic key tracking state if required
+        if(trackPMKey(riscv)) {
+            endPMKeyInstruction(&state);
+        }
+
         // call derived model postMorph functions if required
         for(extCB=riscv->extCBs; extCB; extCB=extCB->next) {
             if(extCB->postMorph) {
@@ -9354,7 +10274,10 @@ void riscvMorphVOp(
 }
 
 //
-// Adjust results for divide-by-zero and integer overflow
+// Adjust results for divide-by-zero and integer overflow (RISC-V divide and
+// remainder instructions handle these cases inline, so this is reached only by
+// derived model instructions that use vmi_IDIV, vmi_DIV, vmi_IREM or vmi_REM
+// directly)
 //
 VMI_ARITH_RESULT_FN(riscvArithResult) {
 
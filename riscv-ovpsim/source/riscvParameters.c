@@ -632,9 +632,11 @@ static riscvParameter parameters[] = {
     {  RVPV_ALL,     default_debug_address,        VMI_UNS64_PARAM_SPEC (riscvParamValues, debug_address,        0, 0,          -1,         "Specify address to which to jump to enter debug in vectored mode")},
     {  RVPV_ALL,     default_dexc_address,         VMI_UNS64_PARAM_SPEC (riscvParamValues, dexc_address,         0, 0,          -1,         "Specify address to which to jump on debug exception in vectored mode")},
     {  RVPV_ALL,     0,                            VMI_BOOL_PARAM_SPEC  (riscvParamValues, verbose,              False,                     "Specify verbose output messages")},
+    {  RVPV_ALL,     0,                            VMI_UNS32_PARAM_SPEC (riscvParamValues, pm_key_variants,      0,   0,        -1,         "Specify number of vector configuration and transaction mode variants with which a block may be translated before the instructions that depend on that state are translated in separate blocks (0 means no limit)")},
     {  RVPV_MPCORE,  default_numHarts,             VMI_UNS32_PARAM_SPEC (riscvParamValues, numHarts,             0, 0,          32,         "Specify the number of hart contexts in a multiprocessor")},
     {  RVPV_S,       default_updatePTEA,           VMI_BOOL_PARAM_SPEC  (riscvParamValues, updatePTEA,           False,                     "Specify whether hardware update of PTE A bit is supported")},
     {  RVPV_S,       default_updatePTED,           VMI_BOOL_PARAM_SPEC  (riscvParamValues, updatePTED,           False,                     "Specify whether hardware update of PTE D bit is supported")},
+    {  RVPV_S,       0,                            VMI_UNS32_PARAM_SPEC (riscvParamValues, tlb_prefetch,         0, 0,          16,         "Specify number of neighbouring page table entries for which TLB entries are created speculatively on a TLB miss (0 disables prefetch)")},
     {  RVPV_ALL,     default_unaligned,            VMI_BOOL_PARAM_SPEC  (riscvParamValues, unaligned,            False,                     "Specify whether the processor supports unaligned memory accesses")},
     {  RVPV_A,       default_unalignedAMO,         VMI_BOOL_PARAM_SPEC  (riscvParamValues, unalignedAMO,         False,                     "Specify whether the processor supports unaligned memory accesses for AMO instructions")},
     {  RVPV_ALL,     default_wfi_is_nop,           VMI_BOOL_PARAM_SPEC  (riscvParamValues, wfi_is_nop,           False,                     "Specify whether WFI should be treated as a NOP (if not, halt while waiting for interrupts)")},
@@ -696,6 +698,7 @@ static riscvParameter parameters[] = {
     {  RVPV_V,       default_Zvamo,                VMI_BOOL_PARAM_SPEC  (riscvParamValues, Zvamo,                False,                     "Specify that Zvamo is implemented (vector extension)")},
     {  RVPV_V,       default_Zvediv,               VMI_BOOL_PARAM_SPEC  (riscvParamValues, Zvediv,               False,                     "Specify that Zvediv is implemented (vector extension)")},
     {  RVPV_V,       default_Zvqmac,               VMI_BOOL_PARAM_SPEC  (riscvParamValues, Zvqmac,               False,                     "Specify that Zvqmac is implemented (vector extension)")},
+    {  RVPV_V,       0,                            VMI_BOOL_PARAM_SPEC  (riscvParamValues, lazy_tail_zero,       True,                      "Specify that zeroing of vector register tail elements is deferred until they are observed (vector extension)")},
 
     // CLIC configuration
     {  RVPV_INT_CFG, default_CLICLEVELS,           VMI_UNS32_PARAM_SPEC (riscvParamValues, CLICLEVELS,           0, 0,          256,        "Specify number of interrupt levels implemented by CLIC, or 0 if CLIC absent")},
@@ -708,6 +711,63 @@ static riscvParameter parameters[] = {
     {  RVPV_CLIC,    default_CLICMNXTI,            VMI_BOOL_PARAM_SPEC  (riscvParamValues, CLICMNXTI,            False,                     "Whether xnxti CSRs implemented")},
     {  RVPV_CLIC,    default_CLICMCSW,             VMI_BOOL_PARAM_SPEC  (riscvParamValues, CLICMCSW,             False,                     "Whether xscratchcsw/xscratchcswl CSRs implemented")},
 
+    // timing model configuration
+    {  RVPV_ALL,     0,                            VMI_BOOL_PARAM_SPEC  (riscvParamValues, timing_model,         False,                     "Enable cycle-approximate timing model (drives cycle, time and hpmcounter CSRs)")},
+    {  RVPV_ALL,     0,                            VMI_UNS32_PARAM_SPEC (riscvParamValues, timing_lat_alu,       1, 0,          1024,       "Specify latency in cycles of integer ALU instructions (timing model)")},
+    {  RVPV_ALL,     0,                            VMI_UNS32_PARAM_SPEC (riscvParamValues, timing_lat_mul,       3, 0,          1024,       "Specify latency in cycles of integer multiply instructions (timing model)")},
+    {  RVPV_ALL,     0,                            VMI_UNS32_PARAM_SPEC (riscvParamValues, timing_lat_div,       34, 0,         1024,       "Specify latency in cycles of integer divide and remainder instructions (timing model)")},
+    {  RVPV_ALL,     0,                            VMI_UNS32_PARAM_SPEC (riscvParamValues, timing_lat_load,      2, 0,          1024,       "Specify latency in cycles of load instructions that hit in the data cache (timing model)")},
+    {  RVPV_ALL,     0,                            VMI_UNS32_PARAM_SPEC (riscvParamValues, timing_lat_store,     1, 0,          1024,       "Specify latency in cycles of store and AMO instructions that hit in the data cache (timing model)")},
+    {  RVPV_ALL,     0,                            VMI_UNS32_PARAM_SPEC (riscvParamValues, timing_lat_branch,    1, 0,          1024,       "Specify latency in cycles of correctly-predicted conditional branches (timing model)")},
+    {  RVPV_ALL,     0,                            VMI_UNS32_PARAM_SPEC (riscvParamValues, timing_lat_jump,      2, 0,          1024,       "Specify latency in cycles of unconditional jumps (timing model)")},
+    {  RVPV_ALL,     0,                            VMI_UNS32_PARAM_SPEC (riscvParamValues, timing_lat_fp,        4, 0,          1024,       "Specify latency in cycles of floating point instructions (timing model)")},
+    {  RVPV_ALL,     0,                            VMI_UNS32_PARAM_SPEC (riscvParamValues, timing_lat_fdiv,      20, 0,         1024,       "Specify latency in cycles of floating point divide and square root instructions (timing model)")},
+    {  RVPV_ALL,     0,                            VMI_UNS32_PARAM_SPEC (riscvParamValues, timing_lat_system,    8, 0,          1024,       "Specify latency in cycles of system, CSR and fence instructions (timing model)")},
+    {  RVPV_ALL,     0,                            VMI_UNS32_PARAM_SPEC (riscvParamValues, timing_lat_vector,    4, 0,          1024,       "Specify latency in cycles of vector instructions (timing model)")},
+    {  RVPV_ALL,     0,                            VMI_UNS32_PARAM_SPEC (riscvParamValues, timing_icache_size,   16384, 0,      (1<<24),    "Specify L1 instruction cache size in bytes, or 0 for a perfect cache (timing model)")},
+    {  RVPV_ALL,     0,                            VMI_UNS32_PARAM_SPEC (riscvParamValues, timing_dcache_size,   16384, 0,      (1<<24),    "Specify L1 data cache size in bytes, or 0 for a perfect cache (timing model)")},
+    {  RVPV_ALL,     0,                            VMI_UNS32_PARAM_SPEC (riscvParamValues, timing_cache_line,    64, 4,         4096,       "Specify L1 cache line size in bytes (constrained to a power of two, timing model)")},
+    {  RVPV_ALL,     0,                            VMI_UNS32_PARAM_SPEC (riscvParamValues, timing_cache_ways,    4, 1,          64,         "Specify L1 cache associativity (timing model)")},
+    {  RVPV_ALL,     0,                            VMI_UNS32_PARAM_SPEC (riscvParamValues, timing_cache_miss,    20, 0,         1024,       "Specify L1 cache miss penalty in cycles (timing model)")},
+    {  RVPV_ALL,     0,                            VMI_UNS32_PARAM_SPEC (riscvParamValues, timing_tlb_entries,   32, 0,         4096,       "Specify number of TLB entries, or 0 for a perfect TLB (timing model)")},
+    {  RVPV_ALL,     0,                            VMI_UNS32_PARAM_SPEC (riscvParamValues, timing_tlb_miss,      30, 0,         1024,       "Specify TLB miss penalty in cycles (timing model)")},
+    {  RVPV_ALL,     0,                            VMI_UNS32_PARAM_SPEC (riscvParamValues, timing_bp_entries,    1024, 0,       (1<<20),    "Specify number of branch predictor entries, or 0 for static not-taken prediction (timing model)")},
+    {  RVPV_ALL,     0,                            VMI_UNS32_PARAM_SPEC (riscvParamValues, timing_mispredict,    3, 0,          1024,       "Specify branch misprediction penalty in cycles (timing model)")},
+    {  RVPV_ALL,     0,                            VMI_UNS32_PARAM_SPEC (riscvParamValues, timing_time_divisor,  100, 1,        (1<<20),    "Specify number of modelled cycles per increment of the time CSR (timing model)")},
+
+    // spin loop detection configuration
+    {  RVPV_ALL,     0,                            VMI_UNS32_PARAM_SPEC (riscvParamValues, spin_loop_limit,      0,   0,        -1,         "Specify number of consecutive iterations of a loop that cannot change architectural state before simulation is terminated (0 disables spin loop detection)")},
+    {  RVPV_ALL,     0,                            VMI_UNS32_PARAM_SPEC (riscvParamValues, spin_loop_exit_code,  124, 0,        255,        "Specify exit code used when simulation is terminated by spin loop detection")},
+
+    // fork server configuration
+    {  RVPV_ALL,     0,                            VMI_BOOL_PARAM_SPEC  (riscvParamValues, fork_server,          False,                     "Specify whether to run as a fork server, forking a copy-on-write child process for each payload when the fork marker is reached")},
+    {  RVPV_ALL,     0,                            VMI_STRING_PARAM_SPEC(riscvParamValues, fork_marker,          "begin_testcode",          "Specify symbol at which the fork server forks (if empty or not found, fork at the first instruction)")},
+    {  RVPV_ALL,     0,                            VMI_STRING_PARAM_SPEC(riscvParamValues, fork_payloads,        "",                        "Specify file listing payload files, one per line (fork server)")},
+    {  RVPV_ALL,     0,                            VMI_UNS64_PARAM_SPEC (riscvParamValues, fork_payload_address, 0, 0,          -1,         "Specify physical address at which each payload is loaded (fork server)")},
+
+    // HTIF device configuration
+    {  RVPV_ALL,     0,                            VMI_BOOL_PARAM_SPEC  (riscvParamValues, htif,                 False,                     "Specify whether to implement an HTIF device bound to program symbols tohost and fromhost, providing console output, test exit codes and proxied system calls")},
+    {  RVPV_ALL,     0,                            VMI_UNS64_PARAM_SPEC (riscvParamValues, htif_mmap_base,       0, 0,          -1,         "Specify the base physical address of the window reserved for HTIF mmap of host files (must not contain memory or devices)")},
+    {  RVPV_ALL,     0,                            VMI_UNS64_PARAM_SPEC (riscvParamValues, htif_mmap_size,       0, 0,          -1,         "Specify the size of the window reserved for HTIF mmap of host files (0 means that mmap and munmap are not supported)")},
+
+    // statistics configuration
+    {  RVPV_ALL,     0,                            VMI_BOOL_PARAM_SPEC  (riscvParamValues, statistics,           False,                     "Specify whether to count model internal events, reported as JSON at exit and by command dumpStatistics")},
+    {  RVPV_ALL,     0,                            VMI_STRING_PARAM_SPEC(riscvParamValues, statistics_file,      "",                        "Specify file to which JSON statistics are written at exit (if empty, statistics are written to the simulator log)")},
+
+    // live metrics configuration
+    {  RVPV_ALL,     0,                            VMI_STRING_PARAM_SPEC(riscvParamValues, metrics_file,         "",                        "Specify file to be memory-mapped and updated periodically with live per-hart metrics (read with riscvMetrics.py)")},
+    {  RVPV_ALL,     0,                            VMI_UNS32_PARAM_SPEC (riscvParamValues, metrics_interval,     10000000, 1000, -1,      "Specify number of instructions between live metrics updates")},
+
+    // basic block vector profiling configuration
+    {  RVPV_ALL,     0,                            VMI_STRING_PARAM_SPEC(riscvParamValues, bbv_file,             "",                        "Specify file to which SimPoint basic block vectors are written (if empty, BBV profiling is disabled)")},
+    {  RVPV_ALL,     0,                            VMI_UNS64_PARAM_SPEC (riscvParamValues, bbv_interval,         100000000, 1000, -1,     "Specify number of instructions in each BBV profiling interval")},
+    {  RVPV_ALL,     0,                            VMI_STRING_PARAM_SPEC(riscvParamValues, bbv_checkpoints,      "",                        "Specify comma-separated list of BBV intervals at whose start architectural state is written to file <bbv_file>.ckpt.<interval> in the export_file state format")},
+
+    // architectural state export configuration
+    {  RVPV_ALL,     0,                            VMI_STRING_PARAM_SPEC(riscvParamValues, export_file,          "",                        "Specify file to which architectural state (GPRs, FPRs, CSRs, PC and pages written during simulation) is exported (read with riscvWarmStart.py)")},
+    {  RVPV_ALL,     0,                            VMI_UNS64_PARAM_SPEC (riscvParamValues, export_icount,        0, 0,          -1,         "Specify instruction count at which architectural state is exported (if zero and export_symbol is empty, state is exported at the end of simulation)")},
+    {  RVPV_ALL,     0,                            VMI_STRING_PARAM_SPEC(riscvParamValues, export_symbol,        "",                        "Specify symbol at which architectural state is exported")},
+
     // KEEP LAST
     {  RVPV_ALL,     0,                            VMI_END_PARAM}
 };
@@ -46,6 +46,7 @@ typedef struct riscvParamValuesS {
     VMI_UNS64_PARAM(dexc_address);
     VMI_BOOL_PARAM(updatePTEA);
     VMI_BOOL_PARAM(updatePTED);
+    VMI_UNS32_PARAM(tlb_prefetch);
     VMI_BOOL_PARAM(unaligned);
     VMI_BOOL_PARAM(unalignedAMO);
     VMI_BOOL_PARAM(wfi_is_nop);
@@ -106,6 +107,8 @@ typedef struct riscvParamValuesS {
     VMI_BOOL_PARAM(Zvamo);
     VMI_BOOL_PARAM(Zvediv);
     VMI_BOOL_PARAM(Zvqmac);
+    VMI_BOOL_PARAM(lazy_tail_zero);
+    VMI_UNS32_PARAM(pm_key_variants);
 
     // CLIC configuration
     VMI_UNS64_PARAM(mclicbase);
@@ -119,6 +122,63 @@ typedef struct riscvParamValuesS {
     VMI_BOOL_PARAM(CLICMNXTI);
     VMI_BOOL_PARAM(CLICMCSW);
 
+    // timing model configuration
+    VMI_BOOL_PARAM(timing_model);
+    VMI_UNS32_PARAM(timing_lat_alu);
+    VMI_UNS32_PARAM(timing_lat_mul);
+    VMI_UNS32_PARAM(timing_lat_div);
+    VMI_UNS32_PARAM(timing_lat_load);
+    VMI_UNS32_PARAM(timing_lat_store);
+    VMI_UNS32_PARAM(timing_lat_branch);
+    VMI_UNS32_PARAM(timing_lat_jump);
+    VMI_UNS32_PARAM(timing_lat_fp);
+    VMI_UNS32_PARAM(timing_lat_fdiv);
+    VMI_UNS32_PARAM(timing_lat_system);
+    VMI_UNS32_PARAM(timing_lat_vector);
+    VMI_UNS32_PARAM(timing_icache_size);
+    VMI_UNS32_PARAM(timing_dcache_size);
+    VMI_UNS32_PARAM(timing_cache_line);
+    VMI_UNS32_PARAM(timing_cache_ways);
+    VMI_UNS32_PARAM(timing_cache_miss);
+    VMI_UNS32_PARAM(timing_tlb_entries);
+    VMI_UNS32_PARAM(timing_tlb_miss);
+    VMI_UNS32_PARAM(timing_bp_entries);
+    VMI_UNS32_PARAM(timing_mispredict);
+    VMI_UNS32_PARAM(timing_time_divisor);
+
+    // spin loop detection configuration
+    VMI_UNS32_PARAM(spin_loop_limit);
+    VMI_UNS32_PARAM(spin_loop_exit_code);
+
+    // fork server configuration
+    VMI_BOOL_PARAM(fork_server);
+    VMI_STRING_PARAM(fork_marker);
+    VMI_STRING_PARAM(fork_payloads);
+    VMI_UNS64_PARAM(fork_payload_address);
+
+    // HTIF device configuration
+    VMI_BOOL_PARAM(htif);
+    VMI_UNS64_PARAM(htif_mmap_base);
+    VMI_UNS64_PARAM(htif_mmap_size);
+
+    // statistics configuration
+    VMI_BOOL_PARAM(statistics);
+    VMI_STRING_PARAM(statistics_file);
+
+    // live metrics configuration
+    VMI_STRING_PARAM(metrics_file);
+    VMI_UNS32_PARAM(metrics_interval);
+
+    // basic block vector profiling configuration
+    VMI_STRING_PARAM(bbv_file);
+    VMI_UNS64_PARAM(bbv_interval);
+    VMI_STRING_PARAM(bbv_checkpoints);
+
+    // architectural state export configuration
+    VMI_STRING_PARAM(export_file);
+    VMI_UNS64_PARAM(export_icount);
+    VMI_STRING_PARAM(export_symbol);
+
 } riscvParamValues;
 
 //
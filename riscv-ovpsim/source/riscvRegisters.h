@@ -53,11 +53,16 @@
 #define RISCV_SF_FLAGS          RISCV_CPU_REG(SFMT)
 #define RISCV_JUMP_BASE         RISCV_CPU_REG(jumpBase)
 #define RISCV_PM_KEY            RISCV_CPU_REG(pmKey)
+#define RISCV_STATS(_F)         RISCV_CPU_REG(stats._F)
+#define RISCV_TIMING_CYCLES     RISCV_CPU_REG(timingCycles)
+#define RISCV_TIMING_BATCH_NUM  RISCV_CPU_REG(timingBatchNum)
+#define RISCV_TIMING_ENTRY(_I,_F) RISCV_CPU_REG(timingBatch[_I]._F)
 #define RISCV_VPRED_MASK        RISCV_CPU_TEMP(vFieldMask)
 #define RISCV_VACTIVE_MASK      RISCV_CPU_TEMP(vActiveMask)
 #define RISCV_VTMP              RISCV_CPU_TEMP(vTmp)
 #define RISCV_VSTATE            RISCV_CPU_TEMP(vState)
 #define RISCV_FF                RISCV_CPU_REG(vFirstFault)
+#define RISCV_V_TAIL_PENDING    RISCV_CPU_REG(vTailPending)
 #define RISCV_VLMAX             RISCV_CPU_TEMP(vlMax)
 #define RISCV_OFFSETS_LMULx2    RISCV_CPU_REG(offsetsLMULx2)
 #define RISCV_OFFSETS_LMULx4    RISCV_CPU_REG(offsetsLMULx4)
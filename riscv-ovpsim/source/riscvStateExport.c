@@ -0,0 +1,659 @@
+/*
+ * Copyright (c) 2005-2020 Imperas Software Ltd., www.imperas.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied.
+ *
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// standard header files
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Imperas header files
+#include "hostapi/impAlloc.h"
+
+// VMI header files
+#include "vmi/vmiMessage.h"
+#include "vmi/vmiRt.h"
+
+// model header files
+#include "riscvBBV.h"
+#include "riscvCSR.h"
+#include "riscvCSRTypes.h"
+#include "riscvMessage.h"
+#include "riscvStateExport.h"
+#include "riscvStructure.h"
+#include "riscvUtils.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// TYPES
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Per-hart architectural state export state
+//
+typedef struct riscvStateExportS {
+
+    // configuration
+    char           *name;           // state file name (per hart)
+    char           *symbol;         // symbol at which to export (if any)
+    Uns64           symbolPC;       // resolved symbol address
+    Bool            symbolResolved; // has symbol been looked up?
+    vmiModelTimerP  timer;          // instruction count trigger (if any)
+
+    // dirty page tracking
+    memDomainP      domains[RISCV_MODE_LAST];   // watched domains
+    Uns32           domainsNum;     // number of watched domains
+    Uns64          *pages;          // dirty page numbers plus one
+    Uns32           pagesSize;      // table size (power of 2)
+    Uns32           pagesUsed;      // table entries used
+
+    // status
+    Bool            checkpoints;    // state also written at BBV checkpoints?
+    Bool            bound;          // are dirty pages being tracked?
+    Bool            exported;       // has state been exported?
+
+} riscvStateExport;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// UTILITIES
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Return copy of the given string
+//
+static char *copyString(const char *string) {
+
+    string = string ? string : "";
+
+    char *result = STYPE_CALLOC_N(char, strlen(string)+1);
+
+    strcpy(result, string);
+
+    return result;
+}
+
+//
+// Return current program counter
+//
+inline static Uns64 getPC(riscvP riscv) {
+    return vmirtGetPC((vmiProcessorP)riscv);
+}
+
+//
+// Return the domain used to read page contents
+//
+inline static memDomainP getPhysicalDomain(riscvP riscv) {
+    return riscv->physDomains[RISCV_MODE_M][0];
+}
+
+//
+// Return the address mask of the given domain
+//
+static Uns64 getDomainMask(memDomainP domain) {
+
+    Uns32 bits = vmirtGetDomainAddressBits(domain);
+
+    return (bits==64) ? -1 : ((1ULL<<bits)-1);
+}
+
+//
+// Look up the address of the named symbol, returning False if it is not found
+//
+static Bool getSymbolAddress(riscvP riscv, const char *name, Uns64 *addressP) {
+
+    vmiSymbolCP symbol = vmirtGetSymbolByName((vmiProcessorP)riscv, name);
+
+    if(symbol) {
+        *addressP = vmirtGetSymbolValue(symbol);
+    }
+
+    return symbol ? True : False;
+}
+
+//
+// Compare Uns64 values (for qsort)
+//
+static int compareUns64(const void *a, const void *b) {
+
+    Uns64 va = *(const Uns64 *)a;
+    Uns64 vb = *(const Uns64 *)b;
+
+    return (va<vb) ? -1 : (va>vb) ? 1 : 0;
+}
+
+//
+// Compare CSR records by number (for qsort)
+//
+static int compareCSR(const void *a, const void *b) {
+
+    const riscvStateCSR *ca = a;
+    const riscvStateCSR *cb = b;
+
+    return (Int32)ca->csrNum - (Int32)cb->csrNum;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// DIRTY PAGE TRACKING
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Hash a page number into a table of the given size (a power of 2)
+//
+inline static Uns32 hashPage(Uns64 page, Uns32 size) {
+    return (Uns32)(page * 0x9e3779b97f4a7c15ULL >> 32) & (size-1);
+}
+
+//
+// Insert the given page number into the dirty page table (page numbers are
+// stored plus one so that zero indicates an empty entry)
+//
+static void insertPage(riscvStateExportP se, Uns64 page) {
+
+    Uns64 key  = page+1;
+    Uns32 size = se->pagesSize;
+    Uns32 i    = hashPage(page, size);
+
+    while(se->pages[i] && (se->pages[i]!=key)) {
+        i = (i+1) & (size-1);
+    }
+
+    if(!se->pages[i]) {
+        se->pages[i] = key;
+        se->pagesUsed++;
+    }
+}
+
+//
+// Double the size of the dirty page table
+//
+static void growPages(riscvStateExportP se) {
+
+    Uns64 *old     = se->pages;
+    Uns32  oldSize = se->pagesSize;
+    Uns32  i;
+
+    se->pagesSize = oldSize ? oldSize*2 : 1024;
+    se->pagesUsed = 0;
+    se->pages     = STYPE_CALLOC_N(Uns64, se->pagesSize);
+
+    for(i=0; i<oldSize; i++) {
+        if(old[i]) {
+            insertPage(se, old[i]-1);
+        }
+    }
+
+    if(old) {
+        STYPE_FREE(old);
+    }
+}
+
+//
+// Record pages written by a store, removing the callback for each page from
+// all watched domains on its first write, so that later stores to the page
+// are not intercepted
+//
+static VMI_MEM_WATCH_FN(markDirty) {
+
+    riscvP            riscv = userData;
+    riscvStateExportP se    = riscv->stateExport;
+    Uns64             first = address >> RISCV_STATE_PAGE_SHIFT;
+    Uns64             last  = (address+bytes-1) >> RISCV_STATE_PAGE_SHIFT;
+    Uns64             page;
+    Uns32             i;
+
+    for(page=first; page<=last; page++) {
+
+        Uns64 low  = page << RISCV_STATE_PAGE_SHIFT;
+        Uns64 high = low + RISCV_STATE_PAGE_BYTES - 1;
+
+        // keep table at most half full
+        if((se->pagesUsed*2)>=se->pagesSize) {
+            growPages(se);
+        }
+
+        insertPage(se, page);
+
+        for(i=0; i<se->domainsNum; i++) {
+            vmirtRemoveWriteCallback(
+                se->domains[i], 0, low, high, markDirty, riscv
+            );
+        }
+    }
+}
+
+//
+// Install or remove dirty page callbacks on all distinct PMP data domains,
+// through which all stores are made (the callback for each page is removed
+// on its first write, so only the first store to any page is intercepted)
+//
+static void updateCallbacks(riscvP riscv, Bool install) {
+
+    riscvStateExportP se = riscv->stateExport;
+    riscvMode         mode;
+    Uns32             i;
+
+    if(install) {
+
+        for(mode=0; mode<RISCV_MODE_LAST; mode++) {
+
+            memDomainP domain = riscv->pmpDomains[mode][0];
+
+            // skip domains already found
+            for(i=0; (i<se->domainsNum) && (se->domains[i]!=domain); i++) {
+                // no action
+            }
+
+            if(domain && (i==se->domainsNum)) {
+                se->domains[se->domainsNum++] = domain;
+            }
+        }
+    }
+
+    for(i=0; i<se->domainsNum; i++) {
+
+        memDomainP domain = se->domains[i];
+        Uns64      mask   = getDomainMask(domain);
+
+        if(install) {
+            vmirtAddWriteCallback(domain, 0, 0, mask, markDirty, riscv);
+        } else {
+            vmirtRemoveWriteCallback(domain, 0, 0, mask, markDirty, riscv);
+        }
+    }
+
+    if(!install) {
+        se->domainsNum = 0;
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// STATE FILE
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Fill the state file header, excluding record counts
+//
+static void fillHeader(riscvP riscv, riscvStateHeader *header) {
+
+    Uns32 i;
+
+    memcpy(header->magic, RISCV_STATE_MAGIC, 8);
+
+    header->version   = RISCV_STATE_VERSION;
+    header->hartId    = RD_CSR(riscv, mhartid);
+    header->xlen      = riscvGetXlenArch(riscv);
+    header->flen      = riscvGetFlenArch(riscv);
+    header->mode      = getCurrentMode(riscv);
+    header->pageBytes = RISCV_STATE_PAGE_BYTES;
+    header->iCount    = vmirtGetExecutedICount((vmiProcessorP)riscv);
+    header->PC        = getPC(riscv);
+
+    for(i=0; i<32; i++) {
+        header->x[i] = riscv->x[i];
+        header->f[i] = riscv->f[i];
+    }
+}
+
+//
+// Return all CSRs visible in the normal view, sorted by number
+//
+static riscvStateCSR *getCSRs(riscvP riscv, Uns32 *numP) {
+
+    riscvCSRDetails details = {0};
+    riscvStateCSR  *csrs;
+    Bool            old = riscv->artifactAccess;
+    Uns32           num = 0;
+
+    // count visible CSRs
+    while(riscvGetCSRDetails(riscv, &details, True)) {
+        num++;
+    }
+
+    csrs = STYPE_CALLOC_N(riscvStateCSR, num ? num : 1);
+    num  = 0;
+
+    // read visible CSRs as an artifact access
+    riscv->artifactAccess = True;
+
+    details.attrs = 0;
+    while(riscvGetCSRDetails(riscv, &details, True)) {
+
+        riscvStateCSR *csr   = &csrs[num++];
+        Uns64          value = 0;
+
+        riscvReadCSR(details.attrs, riscv, &value);
+
+        csr->csrNum   = details.attrs->csrNum;
+        csr->writable = (details.access & vmi_RA_W) ? 1 : 0;
+        csr->value    = value;
+    }
+
+    riscv->artifactAccess = old;
+
+    qsort(csrs, num, sizeof(*csrs), compareCSR);
+
+    *numP = num;
+
+    return csrs;
+}
+
+//
+// Return all dirty page numbers, sorted
+//
+static Uns64 *getPages(riscvStateExportP se, Uns32 *numP) {
+
+    Uns64 *pages = STYPE_CALLOC_N(Uns64, se->pagesUsed ? se->pagesUsed : 1);
+    Uns32  num   = 0;
+    Uns32  i;
+
+    for(i=0; i<se->pagesSize; i++) {
+        if(se->pages[i]) {
+            pages[num++] = se->pages[i]-1;
+        }
+    }
+
+    qsort(pages, num, sizeof(*pages), compareUns64);
+
+    *numP = num;
+
+    return pages;
+}
+
+//
+// Write a little-endian value of the given size to the state file
+//
+static void writeLE(FILE *file, Uns64 value, Uns32 bytes) {
+
+    Uns8  buffer[8];
+    Uns32 i;
+
+    for(i=0; i<bytes; i++) {
+        buffer[i] = value >> (i*8);
+    }
+
+    fwrite(buffer, bytes, 1, file);
+}
+
+//
+// Write the state file header (fields in riscvStateHeader order)
+//
+static void writeHeader(FILE *file, riscvStateHeader *header) {
+
+    Uns32 i;
+
+    fwrite(header->magic, sizeof(header->magic), 1, file);
+
+    writeLE(file, header->version,   4);
+    writeLE(file, header->hartId,    4);
+    writeLE(file, header->xlen,      4);
+    writeLE(file, header->flen,      4);
+    writeLE(file, header->mode,      4);
+    writeLE(file, header->numCSRs,   4);
+    writeLE(file, header->numPages,  4);
+    writeLE(file, header->pageBytes, 4);
+    writeLE(file, header->iCount,    8);
+    writeLE(file, header->PC,        8);
+
+    for(i=0; i<32; i++) {
+        writeLE(file, header->x[i], 8);
+    }
+
+    for(i=0; i<32; i++) {
+        writeLE(file, header->f[i], 8);
+    }
+}
+
+//
+// Write a state file CSR record (fields in riscvStateCSR order)
+//
+static void writeCSR(FILE *file, riscvStateCSR *csr) {
+    writeLE(file, csr->csrNum,   4);
+    writeLE(file, csr->writable, 4);
+    writeLE(file, csr->value,    8);
+}
+
+//
+// Write the architectural state file
+//
+static void writeState(riscvP riscv, FILE *file) {
+
+    riscvStateExportP se     = riscv->stateExport;
+    memDomainP        domain = getPhysicalDomain(riscv);
+    riscvStateHeader  header = {{0}};
+    Uns32             numCSRs;
+    Uns32             numPages;
+    riscvStateCSR    *csrs   = getCSRs(riscv, &numCSRs);
+    Uns64            *pages  = getPages(se, &numPages);
+    Uns8              buffer[RISCV_STATE_PAGE_BYTES];
+    Uns32             i;
+
+    fillHeader(riscv, &header);
+
+    header.numCSRs  = numCSRs;
+    header.numPages = numPages;
+
+    writeHeader(file, &header);
+
+    for(i=0; i<numCSRs; i++) {
+        writeCSR(file, &csrs[i]);
+    }
+
+    for(i=0; i<numPages; i++) {
+
+        riscvStatePage page;
+
+        page.address = pages[i] << RISCV_STATE_PAGE_SHIFT;
+
+        vmirtReadNByteDomain(
+            domain, page.address, buffer, sizeof(buffer), 0, MEM_AA_FALSE
+        );
+
+        writeLE(file, page.address, 8);
+        fwrite(buffer, sizeof(buffer), 1, file);
+    }
+
+    STYPE_FREE(csrs);
+    STYPE_FREE(pages);
+}
+
+//
+// Export timer callback
+//
+static VMI_ICOUNT_FN(exportTimer) {
+    riscvStateExportRun((riscvP)processor);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// PUBLIC INTERFACE
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Allocate architectural state export structures if an export file or BBV
+// checkpoints are configured (BBV checkpoints are state files written by
+// riscvStateExportWrite, so dirty pages must be tracked for them too)
+//
+void riscvStateExportNew(riscvP riscv) {
+
+    riscvConfigCP cfg         = &riscv->configInfo;
+    const char   *name        = cfg->export_file ? cfg->export_file : "";
+    Bool          checkpoints = riscv->bbv && riscvBBVHasCheckpoints(riscv);
+
+    if(name[0] || checkpoints) {
+
+        riscvStateExportP se = STYPE_CALLOC(riscvStateExport);
+        char              buffer[1024];
+
+        // harts of a multicore processor write separate files
+        if(name[0] && riscv->parent) {
+            snprintf(
+                buffer, sizeof(buffer), "%s.hart"FMT_64u, name,
+                (Uns64)RD_CSR(riscv, mhartid)
+            );
+            name = buffer;
+        }
+
+        se->name        = copyString(name);
+        se->symbol      = copyString(name[0] ? cfg->export_symbol : "");
+        se->checkpoints = checkpoints;
+
+        // with no export file, there is no export at a trigger or at exit
+        se->exported = !name[0];
+
+        // export at the given instruction count if required
+        if(name[0] && cfg->export_icount) {
+            se->timer = vmirtCreateModelTimer(
+                (vmiProcessorP)riscv, exportTimer, 64, 0
+            );
+            vmirtSetModelTimer(se->timer, cfg->export_icount);
+        }
+
+        growPages(se);
+
+        riscv->stateExport = se;
+    }
+}
+
+//
+// Start tracking dirty pages and resolve any export symbol (once only)
+//
+void riscvStateExportBind(riscvP riscv) {
+
+    riscvStateExportP se = riscv->stateExport;
+
+    if(!se->bound) {
+
+        se->bound = True;
+
+        updateCallbacks(riscv, True);
+
+        if(!se->symbol[0]) {
+
+            // no action
+
+        } else if(getSymbolAddress(riscv, se->symbol, &se->symbolPC)) {
+
+            se->symbolResolved = True;
+
+        } else {
+
+            vmiMessage("W", CPU_PREFIX "_SEM",
+                NO_SRCREF_FMT "state export symbol '%s' not found",
+                NO_SRCREF_ARGS(riscv), se->symbol
+            );
+        }
+    }
+}
+
+//
+// Is the given address the export symbol address?
+//
+Bool riscvStateExportIsMarker(riscvP riscv, Uns64 thisPC) {
+
+    riscvStateExportP se = riscv->stateExport;
+
+    return se->symbolResolved && !se->exported && (se->symbolPC==thisPC);
+}
+
+//
+// Write current architectural state to the named file, returning False if it
+// cannot be created
+//
+Bool riscvStateExportWrite(riscvP riscv, const char *name) {
+
+    riscvStateExportP se = riscv->stateExport;
+    FILE             *file;
+
+    if(!(file=fopen(name, "wb"))) {
+
+        vmiMessage("E", CPU_PREFIX "_SEF",
+            NO_SRCREF_FMT "cannot write state file '%s'",
+            NO_SRCREF_ARGS(riscv), name
+        );
+
+        return False;
+
+    } else {
+
+        writeState(riscv, file);
+        fclose(file);
+
+        vmiMessage("I", CPU_PREFIX "_SEW",
+            NO_SRCREF_FMT "architectural state written to '%s' "
+            "(%u dirty pages)",
+            NO_SRCREF_ARGS(riscv), name, se->pagesUsed
+        );
+
+        return True;
+    }
+}
+
+//
+// Export architectural state (once only)
+//
+void riscvStateExportRun(riscvP riscv) {
+
+    riscvStateExportP se = riscv->stateExport;
+
+    if(!se->exported) {
+
+        se->exported = True;
+
+        // dirty pages need no longer be tracked unless required for BBV
+        // checkpoints
+        if(riscvStateExportWrite(riscv, se->name) && !se->checkpoints) {
+            updateCallbacks(riscv, False);
+        }
+    }
+}
+
+//
+// Export architectural state if not yet exported and free architectural state
+// export structures
+//
+void riscvStateExportFree(riscvP riscv) {
+
+    riscvStateExportP se = riscv->stateExport;
+
+    if(se) {
+
+        // with no instruction count or symbol trigger, export at exit
+        if(!se->timer && !se->symbol[0]) {
+            riscvStateExportRun(riscv);
+        }
+
+        if(se->timer) {
+            vmirtDeleteModelTimer(se->timer);
+        }
+
+        if(se->domainsNum) {
+            updateCallbacks(riscv, False);
+        }
+
+        STYPE_FREE(se->name);
+        STYPE_FREE(se->symbol);
+        STYPE_FREE(se->pages);
+        STYPE_FREE(se);
+
+        riscv->stateExport = 0;
+    }
+}
+
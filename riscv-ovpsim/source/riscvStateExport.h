@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2005-2020 Imperas Software Ltd., www.imperas.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied.
+ *
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#pragma once
+
+// Imperas header files
+#include "hostapi/impTypes.h"
+
+// model header files
+#include "riscvTypeRefs.h"
+
+//
+// Identification of the architectural state file format (this layout is also
+// decoded by the riscvWarmStart.py loader stub generator). All fields are
+// written explicitly little-endian, in structure order with no padding,
+// whatever the host byte order. The file contains:
+//
+// 1. one riscvStateHeader;
+// 2. numCSRs riscvStateCSR records, in CSR number order;
+// 3. numPages riscvStatePage records, in address order, each followed by
+//    pageBytes bytes of memory contents.
+//
+#define RISCV_STATE_MAGIC       "RVSTATE1"
+#define RISCV_STATE_VERSION     1
+#define RISCV_STATE_PAGE_SHIFT  12
+#define RISCV_STATE_PAGE_BYTES  (1<<RISCV_STATE_PAGE_SHIFT)
+
+//
+// Architectural state file header
+//
+typedef struct riscvStateHeaderS {
+    char   magic[8];                        // RISCV_STATE_MAGIC
+    Uns32  version;                         // RISCV_STATE_VERSION
+    Uns32  hartId;                          // mhartid
+    Uns32  xlen;                            // XLEN (32 or 64)
+    Uns32  flen;                            // FLEN (0 if no FPU)
+    Uns32  mode;                            // current mode (0=U, 1=S, 3=M)
+    Uns32  numCSRs;                         // number of CSR records
+    Uns32  numPages;                        // number of page records
+    Uns32  pageBytes;                       // bytes per page record
+    Uns64  iCount;                          // instructions executed
+    Uns64  PC;                              // program counter
+    Uns64  x[32];                           // GPRs
+    Uns64  f[32];                           // FPRs
+} riscvStateHeader;
+
+//
+// Architectural state file CSR record
+//
+typedef struct riscvStateCSRS {
+    Uns32  csrNum;                          // CSR number
+    Uns32  writable;                        // whether CSR is writable
+    Uns64  value;                           // CSR value
+} riscvStateCSR;
+
+//
+// Architectural state file page record (followed by page contents)
+//
+typedef struct riscvStatePageS {
+    Uns64  address;                         // physical address of page
+} riscvStatePage;
+
+//
+// Allocate architectural state export structures if an export file or BBV
+// checkpoints are configured
+//
+void riscvStateExportNew(riscvP riscv);
+
+//
+// Start tracking dirty pages and resolve any export symbol (once only)
+//
+void riscvStateExportBind(riscvP riscv);
+
+//
+// Is the given address the export symbol address?
+//
+Bool riscvStateExportIsMarker(riscvP riscv, Uns64 thisPC);
+
+//
+// Write current architectural state to the named file, returning False if it
+// cannot be created
+//
+Bool riscvStateExportWrite(riscvP riscv, const char *name);
+
+//
+// Export architectural state (once only)
+//
+void riscvStateExportRun(riscvP riscv);
+
+//
+// Export architectural state if not yet exported and free architectural state
+// export structures
+//
+void riscvStateExportFree(riscvP riscv);
+
@@ -0,0 +1,570 @@
+/*
+ * Copyright (c) 2005-2020 Imperas Software Ltd., www.imperas.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied.
+ *
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// standard header files
+#include <stdarg.h>
+#include <stdio.h>
+
+// Imperas header files
+#include "hostapi/impAlloc.h"
+
+// VMI header files
+#include "vmi/vmiMessage.h"
+#include "vmi/vmiMt.h"
+#include "vmi/vmiRt.h"
+
+// model header files
+#include "riscvMessage.h"
+#include "riscvStats.h"
+#include "riscvStructure.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// COUNTER UPDATE
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Emit code to increment the given statistics counter if statistics are
+// enabled
+//
+void riscvStatsEmitInc(riscvP riscv, vmiReg counter) {
+
+    if(riscv->configInfo.statistics) {
+        vmimtBinopRC(64, vmi_ADD, counter, 1, 0);
+    }
+}
+
+//
+// Record a trap with the given cause
+//
+void riscvStatsTrap(riscvP riscv, Bool isInt, Uns32 ecode) {
+
+    if(riscv->stats.countEvents) {
+
+        Uns64 *counts = isInt ? riscv->stats.interrupts : riscv->stats.exceptions;
+
+        if(ecode>=RISCV_STATS_CAUSES) {
+            ecode = RISCV_STATS_CAUSES-1;
+        }
+
+        counts[ecode]++;
+    }
+}
+
+//
+// Return hash table index for the given block address
+//
+inline static Uns32 hashBlockPC(Uns64 PC, Uns32 size) {
+    return ((PC>>1) * 0x9e3779b97f4a7c15ULL) >> 32 & (size-1);
+}
+
+//
+// Insert the given block address in the translated block table (addresses are
+// stored plus one so that zero indicates an empty entry), returning True if it
+// was already present
+//
+static Bool insertBlockPC(riscvStatsP stats, Uns64 PC) {
+
+    Uns64 key  = PC+1;
+    Uns32 size = stats->blockPCsSize;
+    Uns32 i    = hashBlockPC(PC, size);
+
+    while(stats->blockPCs[i] && (stats->blockPCs[i]!=key)) {
+        i = (i+1) & (size-1);
+    }
+
+    if(stats->blockPCs[i]) {
+        return True;
+    }
+
+    stats->blockPCs[i] = key;
+    stats->blockPCsUsed++;
+
+    return False;
+}
+
+//
+// Double the size of the translated block table
+//
+static void growBlockPCs(riscvStatsP stats) {
+
+    Uns64 *old     = stats->blockPCs;
+    Uns32  oldSize = stats->blockPCsSize;
+    Uns32  i;
+
+    stats->blockPCsSize = oldSize ? oldSize*2 : 1024;
+    stats->blockPCsUsed = 0;
+    stats->blockPCs     = STYPE_CALLOC_N(Uns64, stats->blockPCsSize);
+
+    for(i=0; i<oldSize; i++) {
+        if(old[i]) {
+            insertBlockPC(stats, old[i]-1);
+        }
+    }
+
+    if(old) {
+        STYPE_FREE(old);
+    }
+}
+
+//
+// Record translation of a block starting at the given address
+//
+void riscvStatsBlock(riscvP riscv, Uns64 PC) {
+
+    riscvStatsP stats = &riscv->stats;
+
+    // keep table at most half full
+    if((stats->blockPCsUsed*2)>=stats->blockPCsSize) {
+        growBlockPCs(stats);
+    }
+
+    stats->blocks++;
+
+    if(insertBlockPC(stats, PC)) {
+        stats->retranslated++;
+    }
+}
+
+//
+// Return the index of the polymorphic block table entry for the given block
+// address, or of the empty entry where it should be inserted (addresses are
+// stored plus one so that zero indicates an empty entry)
+//
+static Uns32 indexPMKeyBlock(riscvStatsP stats, Uns64 PC) {
+
+    Uns64 key  = PC+1;
+    Uns32 size = stats->pmBlocksSize;
+    Uns32 i    = hashBlockPC(PC, size);
+
+    while(stats->pmBlocks[i].PC && (stats->pmBlocks[i].PC!=key)) {
+        i = (i+1) & (size-1);
+    }
+
+    return i;
+}
+
+//
+// Return the polymorphic block table entry for the given block address,
+// allocating it if required
+//
+static riscvPMKeyBlockP findPMKeyBlock(riscvStatsP stats, Uns64 PC) {
+
+    riscvPMKeyBlockP block = &stats->pmBlocks[indexPMKeyBlock(stats, PC)];
+
+    if(!block->PC) {
+        block->PC = PC+1;
+        stats->pmBlocksUsed++;
+    }
+
+    return block;
+}
+
+//
+// Return the polymorphic block table entry for the given block address, or
+// null if there is none (the table is not modified)
+//
+static riscvPMKeyBlockP lookupPMKeyBlock(riscvStatsP stats, Uns64 PC) {
+
+    riscvPMKeyBlockP block = 0;
+
+    if(stats->pmBlocksSize) {
+        block = &stats->pmBlocks[indexPMKeyBlock(stats, PC)];
+    }
+
+    return (block && block->PC) ? block : 0;
+}
+
+//
+// Double the size of the polymorphic block table
+//
+static void growPMKeyBlocks(riscvStatsP stats) {
+
+    riscvPMKeyBlockP old     = stats->pmBlocks;
+    Uns32            oldSize = stats->pmBlocksSize;
+    Uns32            i;
+
+    stats->pmBlocksSize = oldSize ? oldSize*2 : 256;
+    stats->pmBlocksUsed = 0;
+    stats->pmBlocks     = STYPE_CALLOC_N(riscvPMKeyBlock, stats->pmBlocksSize);
+
+    for(i=0; i<oldSize; i++) {
+        if(old[i].PC) {
+            *findPMKeyBlock(stats, old[i].PC-1) = old[i];
+        }
+    }
+
+    if(old) {
+        STYPE_FREE(old);
+    }
+}
+
+//
+// Double the size of the key set of a polymorphic block
+//
+static void growPMKeys(riscvPMKeyBlockP block) {
+
+    Uns16 *oldKeys   = block->keys;
+    Uns32 *oldCounts = block->counts;
+    Uns32  oldSize   = block->keysSize;
+    Uns32  i;
+
+    block->keysSize = oldSize ? oldSize*2 : 4;
+    block->keys     = STYPE_CALLOC_N(Uns16, block->keysSize);
+    block->counts   = STYPE_CALLOC_N(Uns32, block->keysSize);
+
+    for(i=0; i<oldSize; i++) {
+        block->keys[i]   = oldKeys[i];
+        block->counts[i] = oldCounts[i];
+    }
+
+    if(oldSize) {
+        STYPE_FREE(oldKeys);
+        STYPE_FREE(oldCounts);
+    }
+}
+
+//
+// Record translation of a block starting at the given address that is
+// specialized on the given polymorphic key from the instruction at keyPC,
+// returning the number of distinct keys with which the block has been
+// translated
+//
+Uns32 riscvStatsPMKey(riscvP riscv, Uns64 PC, Uns64 keyPC, Uns32 key) {
+
+    riscvStatsP stats = &riscv->stats;
+
+    // keep table at most half full
+    if((stats->pmBlocksUsed*2)>=stats->pmBlocksSize) {
+        growPMKeyBlocks(stats);
+    }
+
+    riscvPMKeyBlockP block = findPMKeyBlock(stats, PC);
+    Uns32            num   = block->variants;
+    Uns32            i;
+
+    // record the first key-dependent instruction in the block
+    block->keyPC = keyPC+1;
+
+    // count another translation with a previously-recorded key
+    for(i=0; i<num; i++) {
+        if(block->keys[i]==key) {
+            block->counts[i]++;
+            return num;
+        }
+    }
+
+    // add a new key to the set
+    if(num==block->keysSize) {
+        growPMKeys(block);
+    }
+
+    block->keys[num]   = key;
+    block->counts[num] = 1;
+
+    return ++block->variants;
+}
+
+//
+// Record that key specialization of the block starting at the given address
+// is limited because it has been translated with too many keys
+//
+void riscvStatsPMKeyLimit(riscvP riscv, Uns64 PC) {
+
+    riscvPMKeyBlockP block = lookupPMKeyBlock(&riscv->stats, PC);
+
+    if(block) {
+        block->limited = True;
+    }
+}
+
+//
+// If key specialization of the block starting at the given address is
+// limited, return True and the address of its first key-dependent instruction
+//
+Bool riscvStatsPMKeyLimited(riscvP riscv, Uns64 PC, Uns64 *keyPCP) {
+
+    riscvPMKeyBlockP block = lookupPMKeyBlock(&riscv->stats, PC);
+
+    if(block && block->limited) {
+        *keyPCP = block->keyPC-1;
+        return True;
+    } else {
+        return False;
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// JSON REPORT
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Names of instruction classes
+//
+static const char *classNames[RVTC_LAST] = {
+    [RVTC_ALU]    = "alu",
+    [RVTC_MUL]    = "mul",
+    [RVTC_DIV]    = "div",
+    [RVTC_LOAD]   = "load",
+    [RVTC_STORE]  = "store",
+    [RVTC_BRANCH] = "branch",
+    [RVTC_JUMP]   = "jump",
+    [RVTC_FP]     = "fp",
+    [RVTC_FDIV]   = "fdiv",
+    [RVTC_SYSTEM] = "system",
+    [RVTC_VECTOR] = "vector",
+};
+
+//
+// Write formatted text to the given file (or to the simulator log if file is
+// null)
+//
+static void statsPrintf(FILE *file, const char *fmt, ...) {
+
+    va_list ap;
+
+    va_start(ap, fmt);
+
+    if(file) {
+        vfprintf(file, fmt, ap);
+    } else {
+        char buffer[256];
+        vsnprintf(buffer, sizeof(buffer), fmt, ap);
+        vmiPrintf("%s", buffer);
+    }
+
+    va_end(ap);
+}
+
+//
+// Write a JSON object containing the non-zero entries of a counter array,
+// keyed either by the given names or by index
+//
+static void dumpCounts(
+    FILE        *file,
+    const char  *name,
+    const Uns64 *counts,
+    Uns32        num,
+    const char **names,
+    Bool         letters
+) {
+    const char *sep = "";
+    Uns32       i;
+
+    statsPrintf(file, "  \"%s\": {", name);
+
+    for(i=0; i<num; i++) {
+
+        if(!counts[i]) {
+
+            // no action
+
+        } else if(names) {
+
+            statsPrintf(file, "%s\"%s\": "FMT_64u, sep, names[i], counts[i]);
+            sep = ", ";
+
+        } else if(letters) {
+
+            statsPrintf(file, "%s\"%c\": "FMT_64u, sep, 'A'+i, counts[i]);
+            sep = ", ";
+
+        } else {
+
+            statsPrintf(file, "%s\"%u\": "FMT_64u, sep, i, counts[i]);
+            sep = ", ";
+        }
+    }
+
+    statsPrintf(file, "},\n");
+}
+
+//
+// Write a JSON object containing the per-key translation counts of each block
+// that has been translated with more than one polymorphic key
+//
+static void dumpPMKeyBlocks(FILE *file, riscvStatsP stats) {
+
+    const char *sep = "";
+    Uns32       i, j;
+
+    statsPrintf(file, "  \"pm_key_blocks\": {");
+
+    for(i=0; i<stats->pmBlocksSize; i++) {
+
+        riscvPMKeyBlockP block = &stats->pmBlocks[i];
+
+        if(block->variants>1) {
+
+            const char *keySep = "";
+
+            statsPrintf(
+                file, "%s\n    \"0x"FMT_6408x"\": {", sep, block->PC-1
+            );
+
+            for(j=0; j<block->variants; j++) {
+                statsPrintf(
+                    file, "%s\"0x%04x\": %u",
+                    keySep, block->keys[j], block->counts[j]
+                );
+                keySep = ", ";
+            }
+
+            statsPrintf(file, "}");
+            sep = ",";
+        }
+    }
+
+    statsPrintf(file, "%s}\n", sep[0] ? "\n  " : "");
+}
+
+//
+// Write statistics as a JSON object to the given file (or to the simulator
+// log if file is null)
+//
+void riscvStatsDump(riscvP riscv, FILE *file) {
+
+    riscvStatsP stats = &riscv->stats;
+
+    statsPrintf(file, "{\n");
+    statsPrintf(
+        file, "  \"hart\": \"%s\",\n", vmirtProcessorName((vmiProcessorP)riscv)
+    );
+
+    dumpCounts(file, "extension",  stats->extension,  RISCV_STATS_EXTENSIONS, 0, True);
+    dumpCounts(file, "class",      stats->iClass,     RVTC_LAST, classNames, False);
+    dumpCounts(file, "exceptions", stats->exceptions, RISCV_STATS_CAUSES, 0, False);
+    dumpCounts(file, "interrupts", stats->interrupts, RISCV_STATS_CAUSES, 0, False);
+
+    statsPrintf(file, "  \"tlb_misses\": "FMT_64u",\n",       stats->tlbMisses);
+    statsPrintf(file, "  \"tlb_flushes\": "FMT_64u",\n",      stats->tlbFlushes);
+    statsPrintf(file, "  \"pmp_remaps\": "FMT_64u",\n",       stats->pmpRemaps);
+    statsPrintf(file, "  \"csr_read_calls\": "FMT_64u",\n",   stats->csrReadCalls);
+    statsPrintf(file, "  \"csr_write_calls\": "FMT_64u",\n",  stats->csrWriteCalls);
+    statsPrintf(file, "  \"sc_failures\": "FMT_64u",\n",      stats->scFailures);
+    statsPrintf(file, "  \"lr_aborts\": "FMT_64u",\n",        stats->lrAborts);
+    statsPrintf(file, "  \"vsetvl\": "FMT_64u",\n",           stats->vsetvl);
+    statsPrintf(file, "  \"blocks\": "FMT_64u",\n",           stats->blocks);
+    statsPrintf(file, "  \"retranslated\": "FMT_64u",\n",     stats->retranslated);
+    statsPrintf(file, "  \"pm_key_fallbacks\": "FMT_64u",\n", stats->pmFallbacks);
+
+    dumpPMKeyBlocks(file, stats);
+
+    statsPrintf(file, "}\n");
+}
+
+//
+// dumpStatistics command
+//
+static VMIRT_COMMAND_PARSE_FN(dumpStatisticsCommand) {
+
+    riscvStatsDump((riscvP)processor, 0);
+
+    return "1";
+}
+
+//
+// Enable event counting and install statistics commands if required (events
+// are also counted when live metrics are published)
+//
+void riscvStatsNew(riscvP riscv) {
+
+    riscvConfigCP cfg = &riscv->configInfo;
+
+    riscv->stats.countEvents = (
+        cfg->statistics ||
+        (cfg->metrics_file && cfg->metrics_file[0])
+    );
+
+    if(cfg->statistics) {
+
+        vmirtAddCommandParse(
+            (vmiProcessorP)riscv,
+            "dumpStatistics",
+            "show model event statistics as JSON",
+            dumpStatisticsCommand,
+            VMI_CT_QUERY|VMI_CO_CPU|VMI_CA_QUERY
+        );
+    }
+}
+
+//
+// Write statistics to any configured file and free statistics structures
+//
+void riscvStatsFree(riscvP riscv) {
+
+    riscvConfigCP cfg   = &riscv->configInfo;
+    riscvStatsP   stats = &riscv->stats;
+
+    if(cfg->statistics) {
+
+        const char *name = cfg->statistics_file;
+
+        if(!name || !name[0]) {
+
+            riscvStatsDump(riscv, 0);
+
+        } else {
+
+            // harts of a multicore processor write separate files
+            char  buffer[1024];
+            FILE *file;
+
+            if(riscv->parent) {
+                snprintf(
+                    buffer, sizeof(buffer), "%s.hart"FMT_64u, name,
+                    (Uns64)RD_CSR(riscv, mhartid)
+                );
+                name = buffer;
+            }
+
+            if((file=fopen(name, "w"))) {
+                riscvStatsDump(riscv, file);
+                fclose(file);
+            } else {
+                vmiMessage("E", CPU_PREFIX "_STF",
+                    NO_SRCREF_FMT "cannot write statistics file '%s'",
+                    NO_SRCREF_ARGS(riscv), name
+                );
+            }
+        }
+    }
+
+    if(stats->blockPCs) {
+        STYPE_FREE(stats->blockPCs);
+        stats->blockPCs = 0;
+    }
+
+    if(stats->pmBlocks) {
+
+        Uns32 i;
+
+        for(i=0; i<stats->pmBlocksSize; i++) {
+            if(stats->pmBlocks[i].keysSize) {
+                STYPE_FREE(stats->pmBlocks[i].keys);
+                STYPE_FREE(stats->pmBlocks[i].counts);
+            }
+        }
+
+        STYPE_FREE(stats->pmBlocks);
+        stats->pmBlocks = 0;
+    }
+}
+
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2005-2020 Imperas Software Ltd., www.imperas.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied.
+ *
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#pragma once
+
+// standard header files
+#include <stdio.h>
+
+// Imperas header files
+#include "hostapi/impTypes.h"
+
+// VMI header files
+#include "vmi/vmiTypes.h"
+
+// model header files
+#include "riscvTiming.h"
+#include "riscvTypeRefs.h"
+
+//
+// Number of trap causes distinguished (higher causes are counted in the last
+// entry)
+//
+#define RISCV_STATS_CAUSES 64
+
+//
+// Number of extension letters
+//
+#define RISCV_STATS_EXTENSIONS 26
+
+//
+// Polymorphic key translations of a block
+//
+typedef struct riscvPMKeyBlockS {
+    Uns64  PC;                                  // block address plus one
+    Uns64  keyPC;                               // first key use plus one
+    Uns32  variants;                            // distinct keys translated
+    Uns32  keysSize;                            // size of keys and counts
+    Bool   limited;                             // key specialization limited?
+    Uns16 *keys;                                // distinct keys
+    Uns32 *counts;                              // translations per key
+} riscvPMKeyBlock, *riscvPMKeyBlockP;
+
+//
+// Model event statistics (only updated when parameter statistics is True)
+//
+typedef struct riscvStatsS {
+    Uns64  extension[RISCV_STATS_EXTENSIONS];   // instructions by extension
+    Uns64  iClass[RVTC_LAST];                   // instructions by class
+    Uns64  exceptions[RISCV_STATS_CAUSES];      // exceptions by cause
+    Uns64  interrupts[RISCV_STATS_CAUSES];      // interrupts by source
+    Uns64  tlbMisses;                           // TLB misses (table walks)
+    Uns64  tlbFlushes;                          // TLB invalidations
+    Uns64  pmpRemaps;                           // PMP domain remaps
+    Uns64  csrReadCalls;                        // CSR read helper calls
+    Uns64  csrWriteCalls;                       // CSR write helper calls
+    Uns64  scFailures;                          // failed SC instructions
+    Uns64  lrAborts;                            // reservations lost to writes
+    Uns64  vsetvl;                              // vsetvl/vsetvli executions
+    Uns64  blocks;                              // blocks translated
+    Uns64  retranslated;                        // blocks translated again
+    Uns64 *blockPCs;                            // translated block addresses
+    Uns32  blockPCsSize;                        // blockPCs table size
+    Uns32  blockPCsUsed;                        // blockPCs entries used
+    riscvPMKeyBlockP pmBlocks;                  // polymorphic block table
+    Uns32  pmBlocksSize;                        // pmBlocks table size
+    Uns32  pmBlocksUsed;                        // pmBlocks entries used
+    Uns64  pmFallbacks;                         // unspecialized translations
+    Bool   countEvents;                         // count events in helpers?
+} riscvStats;
+
+//
+// Increment the given statistics counter if events are being counted (either
+// for the statistics report or for live metrics)
+//
+#define RISCV_STATS_INC(_R, _F) do {        \
+    if((_R)->stats.countEvents) {           \
+        (_R)->stats._F++;                   \
+    }                                       \
+} while(0)
+
+//
+// Emit code to increment the given statistics counter if statistics are
+// enabled
+//
+void riscvStatsEmitInc(riscvP riscv, vmiReg counter);
+
+//
+// Record a trap with the given cause
+//
+void riscvStatsTrap(riscvP riscv, Bool isInt, Uns32 ecode);
+
+//
+// Record translation of a block starting at the given address
+//
+void riscvStatsBlock(riscvP riscv, Uns64 PC);
+
+//
+// Record translation of a block starting at the given address that is
+// specialized on the given polymorphic key from the instruction at keyPC,
+// returning the number of distinct keys with which the block has been
+// translated
+//
+Uns32 riscvStatsPMKey(riscvP riscv, Uns64 PC, Uns64 keyPC, Uns32 key);
+
+//
+// Record that key specialization of the block starting at the given address
+// is limited because it has been translated with too many keys
+//
+void riscvStatsPMKeyLimit(riscvP riscv, Uns64 PC);
+
+//
+// If key specialization of the block starting at the given address is
+// limited, return True and the address of its first key-dependent instruction
+//
+Bool riscvStatsPMKeyLimited(riscvP riscv, Uns64 PC, Uns64 *keyPCP);
+
+//
+// Write statistics as a JSON object to the given file (or to the simulator
+// log if file is null)
+//
+void riscvStatsDump(riscvP riscv, FILE *file);
+
+//
+// Enable event counting and install statistics commands if required
+//
+void riscvStatsNew(riscvP riscv);
+
+//
+// Write statistics to any configured file and free statistics structures
+//
+void riscvStatsFree(riscvP riscv);
+
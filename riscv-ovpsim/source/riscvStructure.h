@@ -30,6 +30,8 @@
 #include "riscvExceptionTypes.h"
 #include "riscvMode.h"
 #include "riscvModelCallbacks.h"
+#include "riscvStats.h"
+#include "riscvTiming.h"
 #include "riscvTypes.h"
 #include "riscvTypeRefs.h"
 #include "riscvVariant.h"
@@ -104,6 +106,36 @@ typedef struct riscvPendEnabS {
     Bool      isCLIC;   // whether CLIC mode interrupt
 } riscvPendEnab;
 
+//
+// Number of exception and interrupt codes for which trap target modes are
+// cached (codes above this are handled without the cache)
+//
+#define RISCV_TRAP_CACHE_CODES 32
+
+//
+// This holds trap-vector state for a target mode, precomputed from xtvec
+//
+typedef struct riscvTrapTargetS {
+    Uns64       base;           // exception base address
+    Uns64       tvt;            // CLIC SHV vector table base (from xtvt)
+    riscvICMode mode;           // interrupt mode encoded in xtvec
+    riscvICMode iMode;          // effective interrupt mode (including custom)
+} riscvTrapTarget, *riscvTrapTargetP;
+
+//
+// This holds trap target state derived from delegation, trap-vector and CLIC
+// configuration CSRs, precomputed to accelerate trap entry and return
+//
+typedef struct riscvTrapCacheS {
+    Bool            valid;      // whether cached state is valid
+    Bool            trapNotify; // whether any extension trap notifier exists
+    Bool            ERETNotify; // whether any extension ERET notifier exists
+    Uns8            clicLevelMask;  // clicintctl level bits (from nlbits)
+    riscvTrapTarget target[RISCV_MODE_LAST];  // per-target-mode xtvec state
+    Uns8            exceptModeX   [RISCV_MODE_LAST][RISCV_TRAP_CACHE_CODES];
+    Uns8            interruptModeX[RISCV_MODE_LAST][RISCV_TRAP_CACHE_CODES];
+} riscvTrapCache, *riscvTrapCacheP;
+
 //
 // This holds all state contributing to a basic mode interrupt (for debug)
 //
@@ -229,6 +261,7 @@ typedef struct riscvS {
     Uns64              exceptionMask;   // mask of all implemented exceptions
     Uns64              interruptMask;   // mask of all implemented interrupts
     riscvPendEnab      pendEnab;        // pending and enabled interrupt
+    riscvTrapCache     trapCache;       // precomputed trap target state
     Uns32              extInt[RISCV_MODE_LAST]; // external interrupt override
     riscvCLIC          clic;            // source interrupt indicated from CLIC
     riscvException     exception : 16;  // last activated exception
@@ -246,6 +279,19 @@ typedef struct riscvS {
     // Counter/timer support
     Uns64              baseCycles;      // base cycle count
     Uns64              baseInstructions;// base instruction count
+    Uns64              timingCycles;    // cycles modelled by timing model
+    Uns32              timingBatchNum;  // timing model events recorded
+    riscvTimingBatch   timingBatch[RISCV_TIMING_BATCH]; // recorded events
+    riscvTimingP       timing;          // timing model (if enabled)
+    Uns64              spinPC;          // spin loop address
+    Uns64              spinICount;      // instruction count at last iteration
+    Uns32              spinIterations;  // consecutive spin loop iterations
+    riscvForkServerP   forkServer;      // fork server (if enabled)
+    riscvHTIFP         htif;            // HTIF device (if enabled)
+    riscvStats         stats;           // event statistics (if enabled)
+    riscvMetricsP      metrics;         // live metrics (if enabled)
+    riscvBBVP          bbv;             // BBV profiling (if enabled)
+    riscvStateExportP  stateExport;     // state export (if enabled)
 
     // Debug
     vmiRegInfoP        regInfo[2];      // register views (normal and debug)
@@ -265,18 +311,25 @@ typedef struct riscvS {
     Uns32              SCAddressHandle; // SC address port handle (locking)
     Uns32              AMOActiveHandle; // active AMO operation
 
+    // Transaction support
+    riscvTLogP         tLog;            // built-in transaction log
+
     // Timers
     vmiModelTimerP     stepTimer;       // Debug mode single-step timer
 
     // CSR support
-    vmiRangeTableP     csrTable;        // per-CSR lookup table
+    riscvCSRTableP     csrTable;        // per-CSR lookup table (may be shared)
     vmiRangeTableP     csrUIMessage;    // per-CSR unimplemented messages
     riscvBusPortP      csrPort;         // externally-implemented CSR port
+    riscvCSRCacheP     csrCache;        // externally-implemented CSR cache
+    riscvCSRTState     csrTState;       // translation state before CSR write
 
     // Memory management support
     memDomainP         vmDomains  [RISCV_MODE_LAST][2]; // mapped domains
     memDomainP         pmpDomains [RISCV_MODE_LAST][2]; // pmp domains
     memDomainP         physDomains[RISCV_MODE_LAST][2]; // physical domains
+    memDomainP         dataDomainsMPRV[2][RISCV_MODE_LAST]; // data domains
+    Uns8               modesMPP[RISCV_MODE_LAST]; // effective mode per MPP
     memDomainP         CLICDomain;          // CLIC domain
     riscvPMPCFG        pmpcfg;              // pmpcfg registers
     Uns64              pmpaddr[NUM_PMPS];   // pmpaddr registers
@@ -303,6 +356,8 @@ typedef struct riscvS {
     Uns64              vTmp;                 	// vector operation temporary
     UnsPS              vBase[NUM_BASE_REGS];  	// indexed base registers
     Uns32             *v;                     	// vector registers (configurable size)
+    Uns32              vTailPending;         	// registers with deferred tail zeroing
+    Uns32              vTailStart[VREG_NUM]; 	// byte offset of each deferred tail
 
 } riscv;
 
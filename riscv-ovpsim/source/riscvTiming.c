@@ -0,0 +1,704 @@
+/*
+ * Copyright (c) 2005-2020 Imperas Software Ltd., www.imperas.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied.
+ *
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Imperas header files
+#include "hostapi/impAlloc.h"
+
+// VMI header files
+#include "vmi/vmiRt.h"
+#include "vmi/vmiTypes.h"
+
+// model header files
+#include "riscvCSR.h"
+#include "riscvStructure.h"
+#include "riscvTiming.h"
+#include "riscvVMConstants.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// TYPES
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Number of performance monitor counters
+//
+#define RISCV_HPM_NUM 32
+
+//
+// Abstract types
+//
+DEFINE_S(riscvCacheModel);
+
+//
+// Set-associative cache model with LRU replacement (also used for the TLB,
+// with pages instead of lines)
+//
+typedef struct riscvCacheModelS {
+    Uns64 *tags;            // tags (per set, most-recently-used first)
+    Uns32  setMask;         // mask selecting set from line index
+    Uns32  ways;            // number of ways per set
+    Uns32  shift;           // log2 of line (or page) size
+    Uns32  penalty;         // miss penalty in cycles
+} riscvCacheModel;
+
+//
+// Branch predictor model (bimodal 2-bit counters with a direct-mapped target
+// buffer for indirect jumps)
+//
+typedef struct riscvBPModelS {
+    Uns8  *counters;        // 2-bit saturating counters
+    Uns64 *targets;         // indirect jump target buffer
+    Uns32  mask;            // mask selecting entry from PC
+    Uns32  penalty;         // misprediction penalty in cycles
+} riscvBPModel;
+
+//
+// Timing model state
+//
+typedef struct riscvTimingS {
+    Uns32           latency[RVTC_LAST];     // static latency per class
+    Uns32           fetchShift;             // log2 of fetch line size
+    Uns32           timeDivisor;            // cycles per time tick
+    riscvCacheModel icache;                 // instruction cache model
+    riscvCacheModel dcache;                 // data cache model
+    riscvCacheModel tlb;                    // TLB model
+    riscvBPModel    bp;                     // branch predictor model
+    Uns64           events[RVTE_LAST];      // event counts
+    Uns64           hpmBase[RISCV_HPM_NUM]; // base event count per counter
+    Uns8            hpmEvent[RISCV_HPM_NUM];// event selected per counter
+} riscvTiming;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// UTILITIES
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Return log2 of the given value, rounded down
+//
+static Uns32 log2Floor(Uns32 value) {
+
+    Uns32 result = 0;
+
+    while(value>1) {
+        value >>= 1;
+        result++;
+    }
+
+    return result;
+}
+
+//
+// Initialize a cache model with the given size in lines, associativity, line
+// size and miss penalty (a model with no lines always hits)
+//
+static void newCacheModel(
+    riscvCacheModelP cache,
+    Uns32            lines,
+    Uns32            ways,
+    Uns32            lineBytes,
+    Uns32            penalty
+) {
+    cache->shift   = log2Floor(lineBytes);
+    cache->penalty = penalty;
+
+    if(lines) {
+
+        // clamp associativity to the number of lines
+        ways = ways ? ways : 1;
+        ways = (ways<lines) ? ways : lines;
+
+        // number of sets is constrained to a power of two
+        Uns32 sets = 1<<log2Floor(lines/ways);
+
+        cache->ways    = ways;
+        cache->setMask = sets-1;
+        cache->tags    = STYPE_CALLOC_N(Uns64, sets*ways);
+    }
+}
+
+//
+// Free a cache model
+//
+static void freeCacheModel(riscvCacheModelP cache) {
+
+    if(cache->tags) {
+        STYPE_FREE(cache->tags);
+        cache->tags = 0;
+    }
+}
+
+//
+// Look up the given address in a cache model, updating LRU state, and return
+// True if it hits (tags are stored plus one so that zero indicates invalid)
+//
+static Bool lookupCacheModel(riscvCacheModelP cache, Uns64 address) {
+
+    Uns64  tag  = (address>>cache->shift) + 1;
+    Uns32  ways = cache->ways;
+    Uns64 *set;
+    Uns32  i;
+
+    // model without storage always hits
+    if(!cache->tags) {
+        return True;
+    }
+
+    set = &cache->tags[((tag-1) & cache->setMask) * ways];
+
+    // fast path: hit in most-recently-used way
+    if(set[0]==tag) {
+        return True;
+    }
+
+    // search remaining ways
+    for(i=1; (i<ways) && (set[i]!=tag); i++) {
+        // no action
+    }
+
+    Bool hit = (i<ways);
+
+    // evict least-recently-used way on a miss
+    if(!hit) {
+        i = ways-1;
+    }
+
+    // move entry to most-recently-used position
+    for(; i; i--) {
+        set[i] = set[i-1];
+    }
+
+    set[0] = tag;
+
+    return hit;
+}
+
+//
+// Invalidate all entries in a cache model
+//
+static void flushCacheModel(riscvCacheModelP cache) {
+
+    if(cache->tags) {
+
+        Uns32 entries = (cache->setMask+1) * cache->ways;
+        Uns32 i;
+
+        for(i=0; i<entries; i++) {
+            cache->tags[i] = 0;
+        }
+    }
+}
+
+//
+// Invalidate any entry for the given address in a cache model
+//
+static void invalidateCacheModel(riscvCacheModelP cache, Uns64 address) {
+
+    if(cache->tags) {
+
+        Uns64  tag  = (address>>cache->shift) + 1;
+        Uns32  ways = cache->ways;
+        Uns64 *set  = &cache->tags[((tag-1) & cache->setMask) * ways];
+        Uns32  i;
+
+        for(i=0; i<ways; i++) {
+            if(set[i]==tag) {
+                set[i] = 0;
+            }
+        }
+    }
+}
+
+//
+// Account for an event
+//
+inline static void addEvent(riscvTimingP timing, riscvTimingEvent event) {
+    timing->events[event]++;
+}
+
+//
+// Account for additional cycles
+//
+inline static void addCycles(riscvP riscv, Uns32 cycles) {
+    riscv->timingCycles += cycles;
+}
+
+//
+// Is address translation active for the given mode?
+//
+static Bool translationActive(riscvP riscv, riscvMode mode) {
+    return (mode!=RISCV_MODE_MACHINE) && RD_CSR_FIELD(riscv, satp, MODE);
+}
+
+//
+// Model a TLB lookup for the given address if translation is active
+//
+static void accessTLB(riscvP riscv, riscvMode mode, Uns64 VA) {
+
+    riscvTimingP timing = riscv->timing;
+
+    if(
+        translationActive(riscv, mode) &&
+        !lookupCacheModel(&timing->tlb, VA)
+    ) {
+        addEvent(timing, RVTE_TLB_MISS);
+        addCycles(riscv, timing->tlb.penalty);
+    }
+}
+
+//
+// Model a data access to the given virtual address
+//
+static void accessData(riscvP riscv, Uns64 VA, riscvTimingEvent event) {
+
+    riscvTimingP timing = riscv->timing;
+
+    addEvent(timing, event);
+
+    // model address translation
+    accessTLB(riscv, riscv->dmode, VA);
+
+    // model data cache (virtually indexed and tagged)
+    if(!lookupCacheModel(&timing->dcache, VA)) {
+        addEvent(timing, RVTE_DCACHE_MISS);
+        addCycles(riscv, timing->dcache.penalty);
+    }
+}
+
+//
+// Return branch predictor entry index for the given address
+//
+inline static Uns32 getBPIndex(riscvTimingP timing, Uns64 PC) {
+    return (PC>>1) & timing->bp.mask;
+}
+
+//
+// Account for a misprediction
+//
+static void mispredict(riscvP riscv) {
+
+    riscvTimingP timing = riscv->timing;
+
+    addEvent(timing, RVTE_MISPREDICT);
+    addCycles(riscv, timing->bp.penalty);
+}
+
+
+//
+// Model instruction fetch of the line containing the given address
+//
+static void accessFetch(riscvP riscv, Uns64 PC) {
+
+    riscvTimingP timing = riscv->timing;
+
+    // model address translation
+    accessTLB(riscv, getCurrentMode(riscv), PC);
+
+    // model instruction cache
+    if(!lookupCacheModel(&timing->icache, PC)) {
+        addEvent(timing, RVTE_ICACHE_MISS);
+        addCycles(riscv, timing->icache.penalty);
+    }
+}
+
+//
+// Model a conditional branch at the given address
+//
+static void accessBranch(riscvP riscv, Uns64 PC, Bool taken) {
+
+    riscvTimingP timing = riscv->timing;
+
+    addEvent(timing, RVTE_BRANCH);
+
+    if(timing->bp.counters) {
+
+        Uns8 *counter   = &timing->bp.counters[getBPIndex(timing, PC)];
+        Bool  predicted = (*counter>=2);
+
+        // update 2-bit saturating counter
+        if(taken && (*counter<3)) {
+            (*counter)++;
+        } else if(!taken && *counter) {
+            (*counter)--;
+        }
+
+        if(predicted!=taken) {
+            mispredict(riscv);
+        }
+
+    } else if(taken) {
+
+        // static not-taken prediction
+        mispredict(riscv);
+    }
+}
+
+//
+// Model an indirect jump at the given address to the given target
+//
+static void accessIndirect(riscvP riscv, Uns64 PC, Uns64 target) {
+
+    riscvTimingP timing = riscv->timing;
+
+    addEvent(timing, RVTE_BRANCH);
+
+    if(timing->bp.targets) {
+
+        Uns64 *entry = &timing->bp.targets[getBPIndex(timing, PC)];
+
+        if(*entry!=target) {
+            *entry = target;
+            mispredict(riscv);
+        }
+
+    } else {
+
+        // no target buffer
+        mispredict(riscv);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTOR AND DESTRUCTOR
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Allocate timing model structures if the timing model is enabled
+//
+void riscvTimingNew(riscvP riscv) {
+
+    riscvConfigCP cfg = &riscv->configInfo;
+
+    if(cfg->timing_model) {
+
+        riscvTimingP timing    = STYPE_CALLOC(riscvTiming);
+        Uns32        lineBytes = cfg->timing_cache_line;
+        Uns32        bpEntries = 1<<log2Floor(cfg->timing_bp_entries);
+
+        riscv->timing = timing;
+
+        // static latencies per instruction class
+        timing->latency[RVTC_ALU]    = cfg->timing_lat_alu;
+        timing->latency[RVTC_MUL]    = cfg->timing_lat_mul;
+        timing->latency[RVTC_DIV]    = cfg->timing_lat_div;
+        timing->latency[RVTC_LOAD]   = cfg->timing_lat_load;
+        timing->latency[RVTC_STORE]  = cfg->timing_lat_store;
+        timing->latency[RVTC_BRANCH] = cfg->timing_lat_branch;
+        timing->latency[RVTC_JUMP]   = cfg->timing_lat_jump;
+        timing->latency[RVTC_FP]     = cfg->timing_lat_fp;
+        timing->latency[RVTC_FDIV]   = cfg->timing_lat_fdiv;
+        timing->latency[RVTC_SYSTEM] = cfg->timing_lat_system;
+        timing->latency[RVTC_VECTOR] = cfg->timing_lat_vector;
+
+        // time advances once every timeDivisor cycles
+        timing->timeDivisor = cfg->timing_time_divisor ? : 1;
+
+        // fetch lines are cache lines
+        timing->fetchShift = log2Floor(lineBytes);
+
+        // create cache and TLB models
+        newCacheModel(
+            &timing->icache,
+            cfg->timing_icache_size/lineBytes,
+            cfg->timing_cache_ways,
+            lineBytes,
+            cfg->timing_cache_miss
+        );
+        newCacheModel(
+            &timing->dcache,
+            cfg->timing_dcache_size/lineBytes,
+            cfg->timing_cache_ways,
+            lineBytes,
+            cfg->timing_cache_miss
+        );
+        newCacheModel(
+            &timing->tlb,
+            cfg->timing_tlb_entries,
+            cfg->timing_tlb_entries,
+            RISCV_PAGE_SIZE,
+            cfg->timing_tlb_miss
+        );
+
+        // create branch predictor model (counters initially weakly not-taken)
+        if(cfg->timing_bp_entries) {
+
+            Uns32 i;
+
+            timing->bp.counters = STYPE_CALLOC_N(Uns8,  bpEntries);
+            timing->bp.targets  = STYPE_CALLOC_N(Uns64, bpEntries);
+            timing->bp.mask     = bpEntries-1;
+
+            for(i=0; i<bpEntries; i++) {
+                timing->bp.counters[i] = 1;
+            }
+        }
+
+        timing->bp.penalty = cfg->timing_mispredict;
+    }
+}
+
+//
+// Free timing model structures
+//
+void riscvTimingFree(riscvP riscv) {
+
+    riscvTimingP timing = riscv->timing;
+
+    if(timing) {
+
+        freeCacheModel(&timing->icache);
+        freeCacheModel(&timing->dcache);
+        freeCacheModel(&timing->tlb);
+
+        if(timing->bp.counters) {
+            STYPE_FREE(timing->bp.counters);
+            STYPE_FREE(timing->bp.targets);
+        }
+
+        STYPE_FREE(timing);
+
+        riscv->timing = 0;
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// MORPH-TIME INTERFACE
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Return the static latency of an instruction of the given class
+//
+Uns32 riscvTimingLatency(riscvP riscv, riscvTimingClass tClass) {
+    return riscv->timing->latency[tClass];
+}
+
+//
+// Return log2 of the instruction fetch line size
+//
+Uns32 riscvTimingFetchShift(riscvP riscv) {
+    return riscv->timing->fetchShift;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// RUN-TIME INTERFACE
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Model a data load from the given virtual address
+//
+void riscvTimingLoad(riscvP riscv, Uns64 VA) {
+    accessData(riscv, VA, RVTE_LOAD);
+}
+
+//
+// Model a data store to the given virtual address
+//
+void riscvTimingStore(riscvP riscv, Uns64 VA) {
+    accessData(riscv, VA, RVTE_STORE);
+}
+
+//
+// Model all events recorded by translated code since the last call (entries
+// that were not written because of conditional code have type RVTB_NONE)
+//
+void riscvTimingFlushBatch(riscvP riscv) {
+
+    Uns32 num = riscv->timingBatchNum;
+    Uns32 i;
+
+    for(i=0; i<num; i++) {
+
+        riscvTimingBatchP entry = &riscv->timingBatch[i];
+
+        switch(entry->type) {
+
+            case RVTB_FETCH:
+                accessFetch(riscv, entry->address);
+                break;
+
+            case RVTB_LOAD:
+                accessData(riscv, entry->address, RVTE_LOAD);
+                break;
+
+            case RVTB_STORE:
+                accessData(riscv, entry->address, RVTE_STORE);
+                break;
+
+            case RVTB_BRANCH:
+                accessBranch(riscv, entry->address, entry->taken);
+                break;
+
+            case RVTB_INDIRECT:
+                accessIndirect(riscv, entry->address, entry->target);
+                break;
+
+            default:
+                break;
+        }
+
+        entry->type = RVTB_NONE;
+    }
+
+    riscv->timingBatchNum = 0;
+}
+
+//
+// Invalidate the TLB model (all entries)
+//
+void riscvTimingInvalidateTLB(riscvP riscv) {
+    flushCacheModel(&riscv->timing->tlb);
+}
+
+//
+// Invalidate the TLB model entry for the given virtual address
+//
+void riscvTimingInvalidateTLBVA(riscvP riscv, Uns64 VA) {
+    invalidateCacheModel(&riscv->timing->tlb, VA);
+}
+
+//
+// Invalidate the TLB and (virtually-tagged) cache models when the address
+// space changes
+//
+void riscvTimingInvalidateAddressSpace(riscvP riscv) {
+
+    riscvTimingP timing = riscv->timing;
+
+    flushCacheModel(&timing->tlb);
+    flushCacheModel(&timing->icache);
+    flushCacheModel(&timing->dcache);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// COUNTERS
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Return the current count of the given event
+//
+Uns64 riscvTimingEventCount(riscvP riscv, riscvTimingEvent event) {
+    return riscv->timing->events[event];
+}
+
+//
+// Return the current time derived from the cycle count
+//
+Uns64 riscvTimingTime(riscvP riscv) {
+    return riscv->timingCycles / riscv->timing->timeDivisor;
+}
+
+//
+// Return the raw event count selected by the indexed counter
+//
+static Uns64 getHPMCount(riscvTimingP timing, Uns32 index) {
+    return timing->events[timing->hpmEvent[index]];
+}
+
+//
+// Read the indexed performance monitor counter
+//
+Uns64 riscvTimingReadHPM(riscvP riscv, Uns32 index) {
+
+    riscvTimingP timing = riscv->timing;
+
+    return getHPMCount(timing, index) - timing->hpmBase[index];
+}
+
+//
+// Write the indexed performance monitor counter
+//
+void riscvTimingWriteHPM(riscvP riscv, Uns32 index, Uns64 newValue) {
+
+    riscvTimingP timing = riscv->timing;
+
+    timing->hpmBase[index] = getHPMCount(timing, index) - newValue;
+}
+
+//
+// Read the indexed performance monitor event selector
+//
+Uns64 riscvTimingReadHPMEvent(riscvP riscv, Uns32 index) {
+    return riscv->timing->hpmEvent[index];
+}
+
+//
+// Write the indexed performance monitor event selector (unsupported events
+// select no event; the counter value is preserved across the change)
+//
+void riscvTimingWriteHPMEvent(riscvP riscv, Uns32 index, Uns64 newValue) {
+
+    riscvTimingP timing = riscv->timing;
+    Uns64        count  = riscvTimingReadHPM(riscv, index);
+
+    timing->hpmEvent[index] = (newValue<RVTE_LAST) ? newValue : RVTE_NONE;
+
+    riscvTimingWriteHPM(riscv, index, count);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// SAVE/RESTORE SUPPORT
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Save timing model state not covered by register read/write API (cache,
+// TLB and predictor contents are not saved)
+//
+void riscvTimingSave(
+    riscvP              riscv,
+    vmiSaveContextP     cxt,
+    vmiSaveRestorePhase phase
+) {
+    riscvTimingP timing = riscv->timing;
+
+    if((phase==SRT_END_CORE) && timing) {
+        VMIRT_SAVE_FIELD(cxt, riscv, timingCycles);
+        VMIRT_SAVE_FIELD(cxt, timing, events);
+        VMIRT_SAVE_FIELD(cxt, timing, hpmBase);
+        VMIRT_SAVE_FIELD(cxt, timing, hpmEvent);
+    }
+}
+
+//
+// Restore timing model state not covered by register read/write API (cache,
+// TLB and predictor models restart cold)
+//
+void riscvTimingRestore(
+    riscvP              riscv,
+    vmiRestoreContextP  cxt,
+    vmiSaveRestorePhase phase
+) {
+    riscvTimingP timing = riscv->timing;
+
+    if((phase==SRT_END_CORE) && timing) {
+        VMIRT_RESTORE_FIELD(cxt, riscv, timingCycles);
+        VMIRT_RESTORE_FIELD(cxt, timing, events);
+        VMIRT_RESTORE_FIELD(cxt, timing, hpmBase);
+        VMIRT_RESTORE_FIELD(cxt, timing, hpmEvent);
+        riscv->timingBatchNum = 0;
+        flushCacheModel(&timing->icache);
+        flushCacheModel(&timing->dcache);
+        flushCacheModel(&timing->tlb);
+    }
+}
+
@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2005-2020 Imperas Software Ltd., www.imperas.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied.
+ *
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#pragma once
+
+// Imperas header files
+#include "hostapi/impTypes.h"
+
+// model header files
+#include "riscvTypeRefs.h"
+
+//
+// Instruction classes distinguished by the timing model
+//
+typedef enum riscvTimingClassE {
+    RVTC_ALU,           // simple integer operation
+    RVTC_MUL,           // integer multiply
+    RVTC_DIV,           // integer divide or remainder
+    RVTC_LOAD,          // load (including LR)
+    RVTC_STORE,         // store (including SC and AMO)
+    RVTC_BRANCH,        // conditional branch
+    RVTC_JUMP,          // unconditional jump
+    RVTC_FP,            // floating point operation
+    RVTC_FDIV,          // floating point divide or square root
+    RVTC_SYSTEM,        // system, CSR or fence instruction
+    RVTC_VECTOR,        // vector instruction
+    RVTC_LAST           // KEEP LAST
+} riscvTimingClass;
+
+//
+// Events counted by the timing model (these are also the values selected by
+// mhpmevent registers)
+//
+typedef enum riscvTimingEventE {
+    RVTE_NONE,          // no event
+    RVTE_ICACHE_MISS,   // instruction cache miss
+    RVTE_DCACHE_MISS,   // data cache miss
+    RVTE_TLB_MISS,      // TLB miss
+    RVTE_BRANCH,        // conditional branch or indirect jump
+    RVTE_MISPREDICT,    // branch or indirect jump mispredicted
+    RVTE_LOAD,          // data load
+    RVTE_STORE,         // data store
+    RVTE_LAST           // KEEP LAST
+} riscvTimingEvent;
+
+//
+// Maximum number of timing model events recorded by translated code before
+// they are processed by a single call to riscvTimingFlushBatch
+//
+#define RISCV_TIMING_BATCH 16
+
+//
+// Types of timing model event recorded by translated code
+//
+typedef enum riscvTimingBatchTypeE {
+    RVTB_NONE,          // no event (entry not written)
+    RVTB_FETCH,         // instruction fetch of line containing address
+    RVTB_LOAD,          // data load from address
+    RVTB_STORE,         // data store to address
+    RVTB_BRANCH,        // conditional branch at address
+    RVTB_INDIRECT       // indirect jump at address to target
+} riscvTimingBatchType;
+
+//
+// Timing model event recorded by translated code
+//
+typedef struct riscvTimingBatchS {
+    Uns64 address;      // fetch, data or branch address
+    Uns64 target;       // indirect jump target
+    Uns8  type;         // event type (riscvTimingBatchType)
+    Uns8  taken;        // whether conditional branch was taken
+} riscvTimingBatch, *riscvTimingBatchP;
+
+//
+// Allocate timing model structures if the timing model is enabled
+//
+void riscvTimingNew(riscvP riscv);
+
+//
+// Free timing model structures
+//
+void riscvTimingFree(riscvP riscv);
+
+//
+// Return the static latency of an instruction of the given class
+//
+Uns32 riscvTimingLatency(riscvP riscv, riscvTimingClass tClass);
+
+//
+// Return log2 of the instruction fetch line size
+//
+Uns32 riscvTimingFetchShift(riscvP riscv);
+
+//
+// Model a data load from the given virtual address
+//
+void riscvTimingLoad(riscvP riscv, Uns64 VA);
+
+//
+// Model a data store to the given virtual address
+//
+void riscvTimingStore(riscvP riscv, Uns64 VA);
+
+//
+// Model all events recorded by translated code since the last call
+//
+void riscvTimingFlushBatch(riscvP riscv);
+
+//
+// Invalidate the TLB model (all entries)
+//
+void riscvTimingInvalidateTLB(riscvP riscv);
+
+//
+// Invalidate the TLB model entry for the given virtual address
+//
+void riscvTimingInvalidateTLBVA(riscvP riscv, Uns64 VA);
+
+//
+// Invalidate the TLB and (virtually-tagged) cache models when the address
+// space changes
+//
+void riscvTimingInvalidateAddressSpace(riscvP riscv);
+
+//
+// Return the current count of the given event
+//
+Uns64 riscvTimingEventCount(riscvP riscv, riscvTimingEvent event);
+
+//
+// Return the current time derived from the modelled cycle count
+//
+Uns64 riscvTimingTime(riscvP riscv);
+
+//
+// Read the indexed performance monitor counter
+//
+Uns64 riscvTimingReadHPM(riscvP riscv, Uns32 index);
+
+//
+// Write the indexed performance monitor counter
+//
+void riscvTimingWriteHPM(riscvP riscv, Uns32 index, Uns64 newValue);
+
+//
+// Read the indexed performance monitor event selector
+//
+Uns64 riscvTimingReadHPMEvent(riscvP riscv, Uns32 index);
+
+//
+// Write the indexed performance monitor event selector
+//
+void riscvTimingWriteHPMEvent(riscvP riscv, Uns32 index, Uns64 newValue);
+
+//
+// Save timing model state not covered by register read/write API
+//
+void riscvTimingSave(
+    riscvP              riscv,
+    vmiSaveContextP     cxt,
+    vmiSaveRestorePhase phase
+);
+
+//
+// Restore timing model state not covered by register read/write API
+//
+void riscvTimingRestore(
+    riscvP              riscv,
+    vmiRestoreContextP  cxt,
+    vmiSaveRestorePhase phase
+);
+
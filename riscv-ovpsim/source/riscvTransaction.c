@@ -0,0 +1,456 @@
+/*
+ * Copyright (c) 2005-2020 Imperas Software Ltd., www.imperas.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied.
+ *
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// standard header files
+#include <string.h>
+
+// Imperas header files
+#include "hostapi/impAlloc.h"
+
+// VMI header files
+#include "vmi/vmiRt.h"
+
+// model header files
+#include "riscvStructure.h"
+#include "riscvTransaction.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// TYPES
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Size of transaction log granule in bytes (a notional cache line)
+//
+#define TLOG_GRANULE_SHIFT  6
+#define TLOG_GRANULE_BYTES  (1<<TLOG_GRANULE_SHIFT)
+
+//
+// Initial number of transaction log entries (must be a power of two)
+//
+#define TLOG_INITIAL_SIZE   64
+
+//
+// Transaction log entry describing one granule in the read or write set
+//
+typedef struct tLogEntryS {
+    Uns64 granule;                      // granule address plus one (0 if free)
+    Uns64 written;                      // mask of bytes written
+    Bool  read;                         // whether granule is in read set
+    Uns8  data[TLOG_GRANULE_BYTES];     // buffered store data
+} tLogEntry, *tLogEntryP;
+
+//
+// Transaction log
+//
+typedef struct riscvTLogS {
+    tLogEntryP entries;                 // open-addressed entry table
+    Uns32      size;                    // entry table size
+    Uns32      used;                    // entry table entries used
+    memDomainP watchDomain;             // domain with installed callbacks
+    Bool       conflict;                // conflicting store detected?
+} riscvTLog;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// LOG TABLE MANAGEMENT
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Return granule number of the given address
+//
+inline static Uns64 getGranule(Uns64 VA) {
+    return VA >> TLOG_GRANULE_SHIFT;
+}
+
+//
+// Return hash table index for the given granule
+//
+inline static Uns32 hashGranule(Uns64 granule, Uns32 size) {
+    return (granule * 0x9e3779b97f4a7c15ULL) >> 32 & (size-1);
+}
+
+//
+// Return the log entry for the given granule, allocating it if required
+//
+static tLogEntryP findEntry(riscvTLogP tLog, Uns64 granule) {
+
+    Uns64 key  = granule+1;
+    Uns32 size = tLog->size;
+    Uns32 i    = hashGranule(granule, size);
+
+    while(tLog->entries[i].granule && (tLog->entries[i].granule!=key)) {
+        i = (i+1) & (size-1);
+    }
+
+    if(!tLog->entries[i].granule) {
+        tLog->entries[i].granule = key;
+        tLog->used++;
+    }
+
+    return &tLog->entries[i];
+}
+
+//
+// Double the size of the log entry table
+//
+static void growEntries(riscvTLogP tLog) {
+
+    tLogEntryP old     = tLog->entries;
+    Uns32      oldSize = tLog->size;
+    Uns32      i;
+
+    tLog->size    = oldSize ? oldSize*2 : TLOG_INITIAL_SIZE;
+    tLog->used    = 0;
+    tLog->entries = STYPE_CALLOC_N(tLogEntry, tLog->size);
+
+    for(i=0; i<oldSize; i++) {
+        if(old[i].granule) {
+            *findEntry(tLog, old[i].granule-1) = old[i];
+        }
+    }
+
+    if(old) {
+        STYPE_FREE(old);
+    }
+}
+
+//
+// Return the transaction log, allocating it on first use
+//
+static riscvTLogP getTLog(riscvP riscv) {
+
+    if(!riscv->tLog) {
+        riscv->tLog = STYPE_CALLOC(riscvTLog);
+    }
+
+    return riscv->tLog;
+}
+
+//
+// Return the log entry for the given address, allocating it if required
+//
+static tLogEntryP getEntry(riscvTLogP tLog, Uns64 VA) {
+
+    // keep table at most half full
+    if((tLog->used*2)>=tLog->size) {
+        growEntries(tLog);
+    }
+
+    return findEntry(tLog, getGranule(VA));
+}
+
+//
+// Discard all log entries
+//
+static void clearTLog(riscvTLogP tLog) {
+
+    if(tLog->used) {
+        memset(tLog->entries, 0, sizeof(tLogEntry)*tLog->size);
+        tLog->used = 0;
+    }
+
+    tLog->conflict = False;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// CONFLICT DETECTION
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// If this memory access callback is triggered, another hart has stored to a
+// granule in the transaction log
+//
+static VMI_MEM_WATCH_FN(conflictTLog) {
+
+    riscvP riscv = (riscvP)userData;
+
+    if(processor && !riscv->tLog->conflict) {
+
+        riscvExtCBP extCB;
+
+        riscv->tLog->conflict = True;
+
+        // notify derived model of conflict
+        for(extCB=riscv->extCBs; extCB; extCB=extCB->next) {
+            if(extCB->tConflict) {
+                extCB->tConflict(riscv, address, extCB->clientData);
+            }
+        }
+    }
+}
+
+//
+// Install or remove conflict monitor callbacks on all granules in the log
+//
+static void updateCallbacks(riscvP riscv, riscvTLogP tLog, memDomainP domain) {
+
+    Bool  install = domain && True;
+    Uns32 i;
+
+    if(!install) {
+        domain = tLog->watchDomain;
+    }
+
+    for(i=0; i<tLog->size; i++) {
+
+        tLogEntryP entry = &tLog->entries[i];
+
+        if(entry->granule) {
+
+            Uns64 low  = (entry->granule-1) << TLOG_GRANULE_SHIFT;
+            Uns64 high = low + TLOG_GRANULE_BYTES - 1;
+
+            if(install) {
+                vmirtAddWriteCallback(
+                    domain, 0, low, high, conflictTLog, riscv
+                );
+            } else {
+                vmirtRemoveWriteCallback(
+                    domain, 0, low, high, conflictTLog, riscv
+                );
+            }
+        }
+    }
+
+    tLog->watchDomain = install ? domain : 0;
+}
+
+//
+// Install or remove conflict monitor callbacks on transaction log granules
+// (callbacks are installed only while this hart is suspended, so that they
+// are triggered by stores of other harts)
+//
+void riscvTLogUpdateCallbacks(riscvP riscv, Bool install) {
+
+    riscvTLogP tLog = riscv->tLog;
+
+    if(!tLog) {
+
+        // no action
+
+    } else if(install && tLog->used && !tLog->watchDomain) {
+
+        memDomainP domain = vmirtGetProcessorDataDomain((vmiProcessorP)riscv);
+
+        updateCallbacks(riscv, tLog, domain);
+
+    } else if(!install && tLog->watchDomain) {
+
+        updateCallbacks(riscv, tLog, 0);
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// TRANSACTION ACCESS
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Does any extension implement transaction loads and stores itself? (if not,
+// the built-in transaction log is used)
+//
+Bool riscvTLogExtensionAccess(riscvP riscv) {
+
+    riscvExtCBP extCB;
+
+    for(extCB=riscv->extCBs; extCB; extCB=extCB->next) {
+        if(extCB->tLoad || extCB->tStore) {
+            return True;
+        }
+    }
+
+    return False;
+}
+
+//
+// Do transaction load of up to 8 bytes using the built-in transaction log
+//
+Uns64 riscvTLogLoad(riscvP riscv, Uns64 VA, Uns32 bytes) {
+
+    riscvTLogP tLog   = getTLog(riscv);
+    tLogEntryP entry  = 0;
+    Uns8       buffer[8];
+    Uns64      result = 0;
+    Uns32      i;
+
+    // read current memory contents
+    vmirtReadNByteDomain(
+        vmirtGetProcessorDataDomain((vmiProcessorP)riscv),
+        VA, buffer, bytes, 0, MEM_AA_TRUE
+    );
+
+    for(i=0; i<bytes; i++) {
+
+        Uns64 byteVA = VA+i;
+        Uns32 offset = byteVA & (TLOG_GRANULE_BYTES-1);
+
+        // get entry for this granule, adding it to the read set
+        if(!entry || !offset) {
+            entry = getEntry(tLog, byteVA);
+            entry->read = True;
+        }
+
+        // use any buffered store data in preference to memory
+        if(entry->written & (1ULL<<offset)) {
+            buffer[i] = entry->data[offset];
+        }
+
+        result |= (Uns64)buffer[i] << (i*8);
+    }
+
+    return result;
+}
+
+//
+// Do transaction store of up to 8 bytes using the built-in transaction log
+//
+void riscvTLogStore(riscvP riscv, Uns64 VA, Uns64 value, Uns32 bytes) {
+
+    riscvTLogP tLog  = getTLog(riscv);
+    tLogEntryP entry = 0;
+    Uns32      i;
+
+    for(i=0; i<bytes; i++) {
+
+        Uns64 byteVA = VA+i;
+        Uns32 offset = byteVA & (TLOG_GRANULE_BYTES-1);
+
+        // get entry for this granule, adding it to the write set
+        if(!entry || !offset) {
+            entry = getEntry(tLog, byteVA);
+        }
+
+        // buffer store data
+        entry->data[offset]  = value >> (i*8);
+        entry->written      |= 1ULL<<offset;
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// TRANSACTION CONTROL
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Start a new transaction (discarding any previous transaction log)
+//
+void riscvTLogBegin(riscvP riscv) {
+    if(riscv->tLog) {
+        riscvTLogAbort(riscv);
+    }
+}
+
+//
+// Commit the built-in transaction log, writing buffered stores to memory;
+// returns False (discarding the log) if a store by another hart has conflicted
+// with the transaction
+//
+RISCV_TCOMMIT_FN(riscvTLogCommit) {
+
+    riscvTLogP tLog   = riscv->tLog;
+    Bool       result = True;
+
+    if(!tLog) {
+
+        // no action
+
+    } else if(tLog->conflict) {
+
+        result = False;
+
+    } else {
+
+        memDomainP domain = vmirtGetProcessorDataDomain((vmiProcessorP)riscv);
+        Uns32      i;
+
+        for(i=0; i<tLog->size; i++) {
+
+            tLogEntryP entry   = &tLog->entries[i];
+            Uns64      written = entry->written;
+            Uns64      base    = (entry->granule-1) << TLOG_GRANULE_SHIFT;
+            Uns32      offset  = 0;
+
+            // write each contiguous run of buffered bytes
+            while(written) {
+
+                Uns32 bytes = 0;
+
+                while(!(written & (1ULL<<offset))) {
+                    offset++;
+                }
+
+                while((offset+bytes<TLOG_GRANULE_BYTES) &&
+                      (written & (1ULL<<(offset+bytes)))
+                ) {
+                    written &= ~(1ULL<<(offset+bytes));
+                    bytes++;
+                }
+
+                vmirtWriteNByteDomain(
+                    domain, base+offset, &entry->data[offset], bytes,
+                    0, MEM_AA_TRUE
+                );
+
+                offset += bytes;
+            }
+        }
+    }
+
+    // discard the log
+    riscvTLogAbort(riscv);
+
+    return result;
+}
+
+//
+// Discard the built-in transaction log
+//
+RISCV_TABORT_FN(riscvTLogAbort) {
+
+    riscvTLogP tLog = riscv->tLog;
+
+    if(tLog) {
+        riscvTLogUpdateCallbacks(riscv, False);
+        clearTLog(tLog);
+    }
+}
+
+//
+// Free the built-in transaction log
+//
+void riscvTLogFree(riscvP riscv) {
+
+    riscvTLogP tLog = riscv->tLog;
+
+    if(tLog) {
+
+        riscvTLogUpdateCallbacks(riscv, False);
+
+        if(tLog->entries) {
+            STYPE_FREE(tLog->entries);
+        }
+
+        STYPE_FREE(tLog);
+
+        riscv->tLog = 0;
+    }
+}
+
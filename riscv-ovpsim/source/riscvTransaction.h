@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2005-2020 Imperas Software Ltd., www.imperas.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied.
+ *
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#pragma once
+
+// Imperas header files
+#include "hostapi/impTypes.h"
+
+// model header files
+#include "riscvModelCallbacks.h"
+#include "riscvTypeRefs.h"
+
+//
+// Does any extension implement transaction loads and stores itself? (if not,
+// the built-in transaction log is used)
+//
+Bool riscvTLogExtensionAccess(riscvP riscv);
+
+//
+// Do transaction load of up to 8 bytes using the built-in transaction log
+//
+Uns64 riscvTLogLoad(riscvP riscv, Uns64 VA, Uns32 bytes);
+
+//
+// Do transaction store of up to 8 bytes using the built-in transaction log
+//
+void riscvTLogStore(riscvP riscv, Uns64 VA, Uns64 value, Uns32 bytes);
+
+//
+// Start a new transaction (discarding any previous transaction log)
+//
+void riscvTLogBegin(riscvP riscv);
+
+//
+// Commit the built-in transaction log
+//
+RISCV_TCOMMIT_FN(riscvTLogCommit);
+
+//
+// Discard the built-in transaction log
+//
+RISCV_TABORT_FN(riscvTLogAbort);
+
+//
+// Install or remove conflict monitor callbacks on transaction log granules
+//
+void riscvTLogUpdateCallbacks(riscvP riscv, Bool install);
+
+//
+// Free the built-in transaction log
+//
+void riscvTLogFree(riscvP riscv);
+
@@ -23,6 +23,7 @@
 #include "hostapi/typeMacros.h"
 
 DEFINE_S (riscv);
+DEFINE_S (riscvBBV);
 DEFINE_S (riscvBlockState);
 DEFINE_S (riscvBusPort);
 DEFINE_U (riscvCLICIntState);
@@ -30,15 +31,24 @@ DEFINE_S (riscvCLICOutState);
 DEFINE_S (riscvConfig);
 DEFINE_CS(riscvConfig);
 DEFINE_CS(riscvCSRAttrs);
+DEFINE_S (riscvCSRCache);
+DEFINE_S (riscvCSRTable);
 DEFINE_S (riscvExceptionDesc);
 DEFINE_CS(riscvExceptionDesc);
 DEFINE_S (riscvExtCB);
 DEFINE_CS(riscvExtConfig);
+DEFINE_S (riscvForkServer);
+DEFINE_S (riscvHTIF);
 DEFINE_S (riscvInstrInfo);
 DEFINE_S (riscvNetPort);
+DEFINE_S (riscvMetrics);
 DEFINE_CS(riscvMorphAttr);
 DEFINE_S (riscvMorphState);
 DEFINE_S (riscvParamValues);
 DEFINE_S (riscvPendEnab);
+DEFINE_S (riscvStateExport);
+DEFINE_S (riscvStats);
+DEFINE_S (riscvTiming);
 DEFINE_S (riscvTLB);
+DEFINE_S (riscvTLog);
 
@@ -17,6 +17,9 @@
  *
  */
 
+// standard header files
+#include <string.h>
+
 // VMI header files
 #include "vmi/vmiCxt.h"
 #include "vmi/vmiMessage.h"
@@ -30,7 +33,9 @@
 #include "riscvFunctions.h"
 #include "riscvMessage.h"
 #include "riscvMode.h"
+#include "riscvStats.h"
 #include "riscvStructure.h"
+#include "riscvTransaction.h"
 #include "riscvUtils.h"
 #include "riscvVariant.h"
 #include "riscvVM.h"
@@ -145,6 +150,9 @@ void riscvRegisterExtCB(riscvP riscv, riscvExtCBP extCB, Uns32 id) {
     *tail = extCB;
     extCB->next = 0;
     extCB->id   = id;
+
+    // extension notifiers are cached with trap target state
+    riscvInvalidateTrapCache(riscv);
 }
 
 //
@@ -558,6 +566,109 @@ vmiReg riscvGetVReg(riscvP riscv, Uns32 index) {
     return vmimtGetExtReg((vmiProcessorP)riscv, value);
 }
 
+//
+// Return the bytes of the indexed vector register
+//
+inline static Uns8 *getVRegBytes(riscvP riscv, Uns32 index) {
+    return (Uns8 *)&riscv->v[index*riscv->configInfo.VLEN/32];
+}
+
+//
+// Zero the deferred tail of the indexed vector register, if any
+//
+static void materializeVTail(riscvP riscv, Uns32 index) {
+
+    Uns32 mask = 1U<<index;
+
+    if(riscv->vTailPending & mask) {
+
+        Uns32 VLENB = riscv->configInfo.VLEN/8;
+        Uns32 start = riscv->vTailStart[index];
+
+        memset(getVRegBytes(riscv, index)+start, 0, VLENB-start);
+
+        riscv->vTailPending &= ~mask;
+    }
+}
+
+//
+// Record that the top elements of elemBytes in the groupBytes-sized register
+// group with the given base index are zero, deferring the zeroing until the
+// tail is observed. Any existing deferred tail in a component is retained if
+// it starts lower, because bytes above its start cannot have been written
+// since (see riscvVObserveTail).
+//
+void riscvVDeferTail(
+    riscvP riscv,
+    Uns32  index,
+    Uns32  groupBytes,
+    Uns32  elements,
+    Uns32  elemBytes
+) {
+    Uns32 VLENB     = riscv->configInfo.VLEN/8;
+    Uns32 tailBytes = elements*elemBytes;
+    Uns32 start     = (tailBytes<groupBytes) ? groupBytes-tailBytes : 0;
+    Uns32 base;
+
+    for(base=0; base<groupBytes; base+=VLENB, index++) {
+
+        if(start<base+VLENB) {
+
+            Uns32 mask      = 1U<<index;
+            Uns32 compStart = (start>base) ? start-base : 0;
+
+            if(
+                !(riscv->vTailPending & mask) ||
+                (compStart<riscv->vTailStart[index])
+            ) {
+                riscv->vTailStart[index] = compStart;
+            }
+
+            riscv->vTailPending |= mask;
+        }
+    }
+}
+
+//
+// Zero deferred tails of the EMUL registers with the given base index that
+// are observed by an instruction. If EEWBytes is non-zero, the instruction
+// accesses only the first vl elements of that size in the group; otherwise
+// any byte may be accessed.
+//
+void riscvVObserveTail(
+    riscvP riscv,
+    Uns32  index,
+    Uns32  EMUL,
+    Uns32  EEWBytes
+) {
+    Uns32 VLENB  = riscv->configInfo.VLEN/8;
+    Uns32 extent = EEWBytes ? RD_CSR(riscv, vl)*EEWBytes : EMUL*VLENB;
+    Uns32 base;
+
+    for(base=0; EMUL; base+=VLENB, index++, EMUL--) {
+
+        if(
+            (riscv->vTailPending & (1U<<index)) &&
+            (base+riscv->vTailStart[index] < extent)
+        ) {
+            materializeVTail(riscv, index);
+        }
+    }
+}
+
+//
+// Zero all deferred vector register tails (required before vector registers
+// are accessed other than by translated instructions)
+//
+void riscvVMaterializeTails(riscvP riscv) {
+
+    Uns32 index;
+
+    for(index=0; riscv->vTailPending; index++) {
+        materializeVTail(riscv, index);
+    }
+}
+
 //
 // Return index for the first feature identified by the given feature id
 //
@@ -685,6 +796,9 @@ void riscvAbortExclusiveAccess(riscvP riscv) {
 
     if(riscv->exclusiveTag != RISCV_NO_TAG) {
 
+        // count lost reservations if required
+        RISCV_STATS_INC(riscv, lrAborts);
+
         // remove callback on exclusive access monitor region
         updateExclusiveAccessCallback(riscv, False);
 
@@ -712,6 +826,7 @@ VMI_IASSWITCH_FN(riscvContextSwitchCB) {
     riscvExtCBP extCB;
 
     riscvUpdateExclusiveAccessCallback(riscv, state==RS_SUSPEND);
+    riscvTLogUpdateCallbacks(riscv, state==RS_SUSPEND);
 
     // call derived model context switch function if required
     for(extCB=riscv->extCBs; extCB; extCB=extCB->next) {
@@ -739,6 +854,11 @@ RISCV_SET_TMODE_FN(riscvSetTMode) {
         vmirtFlushAllDicts((vmiProcessorP)riscv);
     }
 
+    // entering transaction mode starts a new transaction log
+    if(enable && !riscvGetTMode(riscv)) {
+        riscvTLogBegin(riscv);
+    }
+
     // enable mode using polymorphic key
     if(enable) {
         riscv->pmKey |= PMK_TRANSACTION;
@@ -123,6 +123,34 @@ const char *riscvGetVRegName(Uns32 index);
 //
 vmiReg riscvGetVReg(riscvP riscv, Uns32 index);
 
+//
+// Record a deferred zero tail of the top elements of elemBytes in the
+// groupBytes-sized register group with the given base index
+//
+void riscvVDeferTail(
+    riscvP riscv,
+    Uns32  index,
+    Uns32  groupBytes,
+    Uns32  elements,
+    Uns32  elemBytes
+);
+
+//
+// Zero deferred tails of the EMUL registers with the given base index that
+// are within the first vl elements of EEWBytes (or all tails if EEWBytes is 0)
+//
+void riscvVObserveTail(
+    riscvP riscv,
+    Uns32  index,
+    Uns32  EMUL,
+    Uns32  EEWBytes
+);
+
+//
+// Zero all deferred vector register tails
+//
+void riscvVMaterializeTails(riscvP riscv);
+
 //
 // Get character identifier for the first feature identified by the given
 // feature id
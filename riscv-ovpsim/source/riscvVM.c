@@ -19,6 +19,7 @@
 
 // Standard header files
 #include <stdio.h>      // for sprintf
+#include <time.h>       // for clock
 
 // Imperas header files
 #include "hostapi/impAlloc.h"
@@ -34,7 +35,9 @@
 #include "riscvExceptions.h"
 #include "riscvFunctions.h"
 #include "riscvMessage.h"
+#include "riscvStats.h"
 #include "riscvStructure.h"
+#include "riscvTiming.h"
 #include "riscvUtils.h"
 #include "riscvVM.h"
 #include "riscvVMConstants.h"
@@ -68,6 +71,24 @@ typedef union riscvSimASIDU {
 
 } riscvSimASID;
 
+//
+// Maximum size of a single VMI mapping (4Gb): TLB entries larger than this are
+// mapped as multiple aligned windows of this size
+//
+#define VMI_PAGE_MAX_SHIFT  32
+#define VMI_PAGE_MAX        (1ULL<<VMI_PAGE_MAX_SHIFT)
+
+//
+// Maximum number of windows in a TLB entry (Sv48 512Gb terapage)
+//
+#define TLB_MAX_WINDOWS     128
+
+//
+// Number of neighbouring windows also mapped on each side of an accessed
+// window of a TLB entry larger than VMI_PAGE_MAX
+//
+#define TLB_WINDOW_PREFETCH 1
+
 //
 // Structure representing a single TLB entry
 //
@@ -85,13 +106,23 @@ typedef struct tlbEntryS {
 
     // entry attributes
     Uns8  isMapped :  4;    // TLB entry mapped (per mode)
+    Uns8  variants :  4;    // mapped MSTATUS (SUM, MXR) variants
     Uns32 priv     :  3;    // access privilege
     Uns32 U        :  1;    // user accessible?
     Uns32 G        :  1;    // global bit
     Uns32 A        :  1;    // accessed bit (read or written)
     Uns32 D        :  1;    // dirty bit (written)
     Bool  artifact :  1;    // entry created by artifact lookup (do not match)
-    Uns32 _u1      : 20;    // spare bits
+    Uns32 PTEBytes :  4;    // leaf PTE size in bytes (0 if not recorded)
+    Uns32 _u1      : 16;    // spare bits
+
+    // leaf PTE address and value when mapped (allows D bit update without
+    // a full table walk)
+    Uns64 PTEAddr;
+    Uns64 PTE;
+
+    // mapped windows of entries larger than the VMI maximum mapping size
+    Uns64 windows[2];
 
     // range LUT entry (for fast lookup by address)
     union {
@@ -102,12 +133,32 @@ typedef struct tlbEntryS {
 
 } tlbEntry;
 
+//
+// Maximum number of TLB entries created speculatively on one TLB miss
+//
+#define TLB_PREFETCH_MAX 16
+
+//
+// TLB event counts for one ASID
+//
+typedef struct tlbASIDCountsS {
+    Uns32          ASID;    // ASID plus one (0 if free)
+    riscvTLBCounts counts;  // event counts
+} tlbASIDCounts, *tlbASIDCountsP;
+
 //
 // Structure representing a TLB
 //
 typedef struct riscvTLBS {
     vmiRangeTableP lut;     // range LUT entry (for fast lookup by address)
     tlbEntryP      free;    // list of free TLB entries available for reuse
+    riscvTLBStats  stats;   // TLB statistics
+    tlbASIDCountsP asids;   // per-ASID event counts (open-addressed table)
+    Uns32          asidsSize;   // per-ASID table size
+    Uns32          asidsUsed;   // per-ASID table entries used
+    Uns32          walkReads;   // entries read by current table walk
+    Uns32          prefetchNum; // number of entries created speculatively
+    tlbEntryP      prefetched[TLB_PREFETCH_MAX];    // speculative entries
 } riscvTLB;
 
 //
@@ -129,6 +180,129 @@ typedef enum VAModeE {
 } VAMode;
 
 
+////////////////////////////////////////////////////////////////////////////////
+// TLB STATISTICS
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Initial size of the per-ASID statistics table (must be a power of two)
+//
+#define TLB_ASID_INITIAL_SIZE 16
+
+//
+// Return TLB if TLB events should be counted (when statistics are enabled and
+// the access is not an artifact)
+//
+inline static riscvTLBP getStatsTLB(riscvP riscv) {
+    return (
+        (riscv->stats.countEvents && !riscv->artifactAccess) ? riscv->tlb : 0
+    );
+}
+
+//
+// Return the index of the per-ASID counts entry for the given ASID, or of the
+// empty entry at which it should be allocated
+//
+static Uns32 indexASIDCounts(riscvTLBP tlb, Uns32 ASID) {
+
+    Uns32 size = tlb->asidsSize;
+    Uns32 i    = (ASID * 0x9e3779b9U) >> 16 & (size-1);
+
+    while(tlb->asids[i].ASID && (tlb->asids[i].ASID!=ASID+1)) {
+        i = (i+1) & (size-1);
+    }
+
+    return i;
+}
+
+//
+// Return the per-ASID counts entry for the given ASID, allocating it if
+// required
+//
+static tlbASIDCountsP findASIDCounts(riscvTLBP tlb, Uns32 ASID) {
+
+    Uns32 i = indexASIDCounts(tlb, ASID);
+
+    if(!tlb->asids[i].ASID) {
+        tlb->asids[i].ASID = ASID+1;
+        tlb->asidsUsed++;
+    }
+
+    return &tlb->asids[i];
+}
+
+//
+// Double the size of the per-ASID statistics table
+//
+static void growASIDCounts(riscvTLBP tlb) {
+
+    tlbASIDCountsP old     = tlb->asids;
+    Uns32          oldSize = tlb->asidsSize;
+    Uns32          i;
+
+    tlb->asidsSize = oldSize ? oldSize*2 : TLB_ASID_INITIAL_SIZE;
+    tlb->asidsUsed = 0;
+    tlb->asids     = STYPE_CALLOC_N(tlbASIDCounts, tlb->asidsSize);
+
+    for(i=0; i<oldSize; i++) {
+        if(old[i].ASID) {
+            *findASIDCounts(tlb, old[i].ASID-1) = old[i];
+        }
+    }
+
+    if(old) {
+        STYPE_FREE(old);
+    }
+}
+
+//
+// Return existing event counts for the given ASID, or NULL if there are none
+// (does not allocate)
+//
+static riscvTLBCountsP lookupASIDCounts(riscvTLBP tlb, Uns32 ASID) {
+
+    tlbASIDCountsP entry = 0;
+
+    if(tlb->asidsSize) {
+        entry = &tlb->asids[indexASIDCounts(tlb, ASID)];
+    }
+
+    return (entry && entry->ASID) ? &entry->counts : 0;
+}
+
+//
+// Return event counts for the given ASID, allocating them if required
+//
+static riscvTLBCountsP getASIDCounts(riscvTLBP tlb, Uns32 ASID) {
+
+    // keep table at most half full
+    if((tlb->asidsUsed*2)>=tlb->asidsSize) {
+        growASIDCounts(tlb);
+    }
+
+    return &findASIDCounts(tlb, ASID)->counts;
+}
+
+//
+// Increment the given TLB event counter for the hart and the given ASID
+//
+#define TLB_STATS_INC(_TLB, _ASID, _F) do {                 \
+    (_TLB)->stats.total._F++;                               \
+    getASIDCounts(_TLB, _ASID)->_F++;                       \
+} while(0)
+
+//
+// Increment the given TLB event counter for the hart and the current ASID if
+// statistics are enabled
+//
+#define TLB_STATS_INC_ACTIVE(_R, _F) do {                   \
+    riscvTLBP _tlb = getStatsTLB(_R);                       \
+    if(_tlb) {                                              \
+        TLB_STATS_INC(_tlb, RD_CSR_FIELD(_R, satp, ASID), _F);  \
+    }                                                       \
+} while(0)
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // UTILITIES
 ////////////////////////////////////////////////////////////////////////////////
@@ -195,6 +369,13 @@ inline static Uns32 getEntrySimASID(tlbEntryP entry) {
     return entry->simASID.u32;
 }
 
+//
+// Return index of the MSTATUS (SUM, MXR) variant of a simulated ASID
+//
+inline static Uns32 getSimASIDVariant(riscvSimASID simASID) {
+    return (simASID.f.SUM<<1) | simASID.f.MXR;
+}
+
 //
 // Return TLB entry low VA
 //
@@ -410,6 +591,11 @@ static Uns64 readPageTableEntry(
     riscv->PTWActive  = True;
     riscv->PTWBadAddr = False;
 
+    // count entries read by this table walk
+    if(riscv->tlb) {
+        riscv->tlb->walkReads++;
+    }
+
     // read 4-byte or 8-byte entry
     if(entryBytes==4) {
         result = vmirtRead4ByteDomain(domain, PTEAddr, endian, attrs);
@@ -444,16 +630,36 @@ static void writePageTableEntry(
     if(riscv->artifactAccess) {
         // no action if an artifact access (e.g. page table walk initiated by
         // pseudo-register write)
-    } else if(entryBytes==4) {
-        vmirtWrite4ByteDomain(domain, PTEAddr, endian, value, attrs);
     } else {
-        vmirtWrite8ByteDomain(domain, PTEAddr, endian, value, attrs);
+
+        // count A/D bit updates if required
+        TLB_STATS_INC_ACTIVE(riscv, adUpdates);
+
+        if(entryBytes==4) {
+            vmirtWrite4ByteDomain(domain, PTEAddr, endian, value, attrs);
+        } else {
+            vmirtWrite8ByteDomain(domain, PTEAddr, endian, value, attrs);
+        }
     }
 
     // exit PTW context
     riscv->PTWActive = False;
 }
 
+//
+// Record leaf page table entry address and value in a TLB entry
+//
+inline static void recordPTE(
+    tlbEntryP entry,
+    Uns64     PTEAddr,
+    Uns32     entryBytes,
+    Uns64     PTE
+) {
+    entry->PTEAddr  = PTEAddr;
+    entry->PTEBytes = entryBytes;
+    entry->PTE      = PTE;
+}
+
 
 ////////////////////////////////////////////////////////////////////////////////
 // PAGE TABLE WALK ERROR HANDLING AND REPORTING
@@ -791,6 +997,9 @@ static riscvException tlbLookupSv32(
         }
     }
 
+    // record leaf PTE for subsequent D bit update
+    recordPTE(entry, PTEAddr, 4, PTE.raw);
+
     // entry is valid
     return 0;
 }
@@ -983,6 +1192,9 @@ static riscvException tlbLookupSv39(
         }
     }
 
+    // record leaf PTE for subsequent D bit update
+    recordPTE(entry, PTEAddr, 8, PTE.raw);
+
     // entry is valid
     return 0;
 }
@@ -1175,6 +1387,9 @@ static riscvException tlbLookupSv48(
         }
     }
 
+    // record leaf PTE for subsequent D bit update
+    recordPTE(entry, PTEAddr, 8, PTE.raw);
+
     // entry is valid
     return 0;
 }
@@ -1204,23 +1419,57 @@ static void deleteTLBEntryMappingsMode(
     // action is only needed if the TLB entry is mapped in this mode
     if(entry->isMapped & modeMask) {
 
-        memDomainP dataDomain = riscv->vmDomains[mode][0];
-        memDomainP codeDomain = riscv->vmDomains[mode][1];
-        Uns64      lowVA      = getEntryLowVA(entry);
-        Uns64      highVA     = getEntryHighVA(entry);
-        Uns32      fullASID   = getEntrySimASID(entry);
-        Uns32      ASIDMask   = getEntryASIDMask(entry, mode);
-
-        if(dataDomain) {
-            vmirtUnaliasMemoryVM(dataDomain, lowVA, highVA, ASIDMask, fullASID);
+        memDomainP   dataDomain = riscv->vmDomains[mode][0];
+        memDomainP   codeDomain = riscv->vmDomains[mode][1];
+        Uns64        lowVA      = getEntryLowVA(entry);
+        Uns64        highVA     = getEntryHighVA(entry);
+        Uns32        ASIDMask   = getEntryASIDMask(entry, mode);
+        riscvSimASID simASID    = entry->simASID;
+        riscvSimASID maskASID   = {u32:ASIDMask};
+        Uns32        variants   = 0;
+        Uns32        variant;
+
+        // get (SUM, MXR) variants that are distinct in this mode
+        for(variant=0; variant<4; variant++) {
+            if(entry->variants & (1<<variant)) {
+                variants |= 1<<(variant & ((maskASID.f.SUM<<1) | 1));
+            }
         }
 
-        if(codeDomain && (codeDomain!=dataDomain)) {
-            vmirtUnaliasMemoryVM(codeDomain, lowVA, highVA, ASIDMask, fullASID);
+        // remove mappings for each distinct variant
+        for(variant=0; variant<4; variant++) {
+
+            if(variants & (1<<variant)) {
+
+                simASID.f.SUM = variant>>1;
+                simASID.f.MXR = variant&1;
+
+                Uns32 fullASID = simASID.u32;
+
+                if(dataDomain) {
+                    vmirtUnaliasMemoryVM(
+                        dataDomain, lowVA, highVA, ASIDMask, fullASID
+                    );
+                }
+
+                if(codeDomain && (codeDomain!=dataDomain)) {
+                    vmirtUnaliasMemoryVM(
+                        codeDomain, lowVA, highVA, ASIDMask, fullASID
+                    );
+                }
+            }
         }
 
         // indicate entry is no longer mapped in this mode
         entry->isMapped &= ~modeMask;
+
+        // no variants or windows are mapped once the entry is unmapped in all
+        // modes (the unmapped range above covers every window)
+        if(!entry->isMapped) {
+            entry->variants   = 0;
+            entry->windows[0] = 0;
+            entry->windows[1] = 0;
+        }
     }
 }
 
@@ -1237,30 +1486,6 @@ static void unmapTLBEntry(riscvP riscv, tlbEntryP entry) {
     }
 }
 
-//
-// Unmap a TLB entry when the simulated ASID changes in domains affected by
-// that change
-//
-static void unmapTLBEntryNewASID(
-    riscvP       riscv,
-    tlbEntryP    entry,
-    riscvSimASID newASID
-) {
-    riscvMode mode;
-
-    for(mode=0; mode<RISCV_MODE_LAST; mode++) {
-
-        Uns32 ASIDMask   = getEntryASIDMask(entry, mode);
-        Uns32 oldASIDU32 = ASIDMask & getEntrySimASID(entry);
-        Uns32 newASIDU32 = ASIDMask & newASID.u32;
-
-        // action is only needed if effective ASID in the given mode changes
-        if(oldASIDU32 != newASIDU32) {
-            deleteTLBEntryMappingsMode(riscv, entry, mode);
-        }
-    }
-}
-
 //
 // Return privilege name for the given privilege
 //
@@ -1327,6 +1552,13 @@ static void deleteTLBEntry(riscvP riscv, riscvTLBP tlb, tlbEntryP entry) {
     // emit debug if required
     reportDeleteTLBEntry(riscv, entry);
 
+    // count TLB entry evictions if required
+    riscvTLBP statsTLB = getStatsTLB(riscv);
+
+    if(statsTLB) {
+        TLB_STATS_INC(statsTLB, entry->simASID.f.ASID, evictions);
+    }
+
     // remove the TLB entry from the range LUT
     vmirtRemoveRangeEntry(&tlb->lut, entry->lutEntry);
     entry->lutEntry = 0;
@@ -1507,6 +1739,10 @@ static void invalidateTLBEntriesRange(
     Uns32     ASID
 ) {
     if(tlb) {
+
+        // count TLB flushes if required
+        RISCV_STATS_INC(riscv, tlbFlushes);
+
         ITER_TLB_ENTRY_RANGE(
             riscv, tlb, lowVA, highVA, entry,
             deleteTLBEntryMode(riscv, tlb, entry, mode, ASID)
@@ -1548,6 +1784,11 @@ static void freeTLB(riscvP riscv, riscvTLBP tlb) {
         // free the range table
         vmirtFreeRangeTable(&tlb->lut);
 
+        // free per-ASID statistics
+        if(tlb->asids) {
+            STYPE_FREE(tlb->asids);
+        }
+
         // free the TLB structure
         STYPE_FREE(tlb);
     }
@@ -1725,6 +1966,82 @@ static VMIRT_COMMAND_PARSE_FN(dumpTLBCommand) {
     return "1";
 }
 
+//
+// Dump one set of TLB event counts
+//
+static void dumpTLBCounts(const char *name, riscvTLBCountsP counts) {
+    vmiPrintf(
+        "  %-10s "FMT_64u" misses, "FMT_64u" hits, "FMT_64u" walks, "
+        FMT_64u" A/D updates, "FMT_64u" evictions\n",
+        name, counts->misses, counts->hits, counts->walks,
+        counts->adUpdates, counts->evictions
+    );
+}
+
+//
+// Dump TLB statistics
+//
+static void dumpTLBStats(riscvP riscv, riscvTLBP tlb) {
+
+    static const char *invNames[RVTI_LAST] = {
+        [RVTI_ALL]     = "all",
+        [RVTI_ASID]    = "ASID",
+        [RVTI_VA]      = "VA",
+        [RVTI_VA_ASID] = "VA+ASID",
+    };
+
+    riscvTLBStatsP stats = &tlb->stats;
+    Uns32          i;
+
+    vmiPrintf("TLB STATISTICS:\n");
+
+    dumpTLBCounts("total", &stats->total);
+
+    for(i=0; i<tlb->asidsSize; i++) {
+
+        tlbASIDCountsP entry = &tlb->asids[i];
+
+        if(entry->ASID) {
+
+            char name[16];
+
+            snprintf(name, sizeof(name), "ASID %u", entry->ASID-1);
+            dumpTLBCounts(name, &entry->counts);
+        }
+    }
+
+    vmiPrintf("  walk depth:");
+
+    for(i=0; i<RISCV_TLB_WALK_LEVELS; i++) {
+        vmiPrintf(" %u:"FMT_64u, i+1, stats->walkDepth[i]);
+    }
+
+    vmiPrintf("\n  prefetched entries: "FMT_64u, stats->prefetches);
+
+    vmiPrintf("\n  sfence.vma:");
+
+    for(i=0; i<RVTI_LAST; i++) {
+        vmiPrintf(" %s:"FMT_64u, invNames[i], stats->invalidations[i]);
+    }
+
+    vmiPrintf(
+        "\n  miss path time: "FMT_64u" us\n",
+        (Uns64)(stats->missClocks * 1000000.0 / CLOCKS_PER_SEC)
+    );
+}
+
+//
+// Dump TLB statistics
+//
+static VMIRT_COMMAND_PARSE_FN(dumpTLBStatsCommand) {
+
+    riscvP riscv = (riscvP)processor;
+
+    dumpTLBStats(riscv, riscv->tlb);
+
+    return "1";
+}
+
 //
 // Virtual memory initialization
 //
@@ -1797,6 +2114,25 @@ VMI_VMINIT_FN(riscvVMInit) {
         }
     }
 
+    // precompute data domain and effective mode for each combination of
+    // satp.MODE, mstatus.MPRV and mstatus.MPP so that refresh of the data
+    // domain is an indexed lookup
+    for(mode=0; mode<RISCV_MODE_LAST; mode++) {
+
+        memDomainP physDomain = riscv->physDomains[mode][0];
+        memDomainP vmDomain   = riscv->vmDomains[mode][0];
+
+        // use physical domain if MMU is not enabled or the domain is not
+        // VM-managed
+        riscv->dataDomainsMPRV[0][mode] = physDomain;
+        riscv->dataDomainsMPRV[1][mode] = vmDomain ? vmDomain : physDomain;
+
+        // clamp mstatus.MPP to implemented mode
+        riscv->modesMPP[mode] = (
+            riscvHasMode(riscv, mode) ? mode : riscvGetMinMode(riscv)
+        );
+    }
+
     if(riscvHasMode(riscv, RISCV_MODE_S)) {
 
         // initialize TLB
@@ -1810,6 +2146,17 @@ VMI_VMINIT_FN(riscvVMInit) {
             dumpTLBCommand,
             VMI_CT_QUERY|VMI_CO_TLB|VMI_CA_QUERY
         );
+
+        // dumpTLBStats command (only if statistics are enabled)
+        if(riscv->configInfo.statistics) {
+            vmirtAddCommandParse(
+                processor,
+                "dumpTLBStats",
+                "show TLB statistics per hart and per ASID",
+                dumpTLBStatsCommand,
+                VMI_CT_QUERY|VMI_CO_TLB|VMI_CA_QUERY
+            );
+        }
     }
 }
 
@@ -1851,8 +2198,12 @@ static riscvException tlbLookup(
     memAccessAttrs attrs
 ) {
     VAMode         vaMode = RD_CSR_FIELD(riscv, satp, MODE);
+    riscvTLBP      tlb    = getStatsTLB(riscv);
     riscvException result = 0;
 
+    // reset count of entries read by this table walk
+    riscv->tlb->walkReads = 0;
+
     if(vaMode==VAM_Sv32) {
         result = tlbLookupSv32(riscv, mode, entry, requiredPriv, attrs);
     } else if(vaMode==VAM_Sv39) {
@@ -1863,6 +2214,22 @@ static riscvException tlbLookup(
         VMI_ABORT("Invalid VA mode"); // LCOV_EXCL_LINE
     }
 
+    // count table walks and walk depth if required
+    if(tlb) {
+
+        Uns32 depth = tlb->walkReads;
+
+        if(depth>RISCV_TLB_WALK_LEVELS) {
+            depth = RISCV_TLB_WALK_LEVELS;
+        }
+
+        TLB_STATS_INC(tlb, RD_CSR_FIELD(riscv, satp, ASID), walks);
+
+        if(depth) {
+            tlb->stats.walkDepth[depth-1]++;
+        }
+    }
+
     return result;
 }
 
@@ -1880,6 +2247,54 @@ static void handleInvalidAccess(
     }
 }
 
+//
+// PTE A and D bits (common to all page table entry formats)
+//
+#define PTE_A (1<<6)
+#define PTE_D (1<<7)
+
+//
+// Attempt to set the D bit in the leaf PTE recorded in the TLB entry without a
+// full table walk, returning True if successful (the PTE is updated only if it
+// is unchanged since the entry was created, otherwise a table walk is required)
+//
+static Bool updateEntryD(riscvP riscv, tlbEntryP entry, memAccessAttrs attrs) {
+
+    Uns32 entryBytes = entry->PTEBytes;
+    Bool  result     = False;
+
+    if(!entryBytes || riscv->artifactAccess || !updatePTED(riscv)) {
+
+        // no PTE recorded, artifact access or no hardware support
+
+    } else {
+
+        memDomainP domain = getPTWDomain(riscv);
+        Uns64      PTEAddr = entry->PTEAddr;
+        Uns64      PTE     = readPageTableEntry(
+            riscv, domain, PTEAddr, entryBytes, attrs
+        );
+
+        // set A and D bits in the PTE if it is unchanged
+        if(!riscv->PTWBadAddr && (PTE==entry->PTE)) {
+
+            PTE |= (PTE_A|PTE_D);
+
+            writePageTableEntry(riscv, domain, PTEAddr, entryBytes, attrs, PTE);
+
+            // update TLB entry if the write succeeded
+            if(!riscv->PTWBadAddr) {
+                entry->A   = 1;
+                entry->D   = 1;
+                entry->PTE = PTE;
+                result     = True;
+            }
+        }
+    }
+
+    return result;
+}
+
 //
 // Validate that the TLB entry has sufficient permissions
 //
@@ -1902,10 +2317,15 @@ static tlbEntryP validateTLBEntryPriv(
         // specified permissions are inadequate
         entry = 0;
 
-    } else if((requiredPriv&MEM_PRIV_W) && !entry->D) {
+    } else if(
+        (requiredPriv&MEM_PRIV_W) &&
+        !entry->D &&
+        !updateEntryD(riscv, entry, attrs)
+    ) {
 
-        // writing using an entry not marked as dirty: discard the entry and
-        // reload it (will write the entry marked as dirty)
+        // writing using an entry not marked as dirty and the recorded PTE
+        // could not be updated directly: discard the entry and reload it (will
+        // write the entry marked as dirty)
         deleteTLBEntry(riscv, riscv->tlb, entry);
         entry = 0;
 
@@ -1923,6 +2343,160 @@ static tlbEntryP validateTLBEntryPriv(
     return entry;
 }
 
+//
+// Is the VA following a prefetch source entry valid in the current VA mode?
+//
+static Bool validPrefetchVA(riscvP riscv, Uns64 VA) {
+
+    VAMode vaMode = RD_CSR_FIELD(riscv, satp, MODE);
+    Sv39VA VA39   = {raw : VA};
+    Sv48VA VA48   = {raw : VA};
+
+    if(!VA) {
+        return False;
+    } else if(vaMode==VAM_Sv32) {
+        return VA==(Uns32)VA;
+    } else if(vaMode==VAM_Sv39) {
+        return validVA(VA39.fields.VPN, VA39.fields.VPNextend);
+    } else {
+        return validVA(VA48.fields.VPN, VA48.fields.VPNextend);
+    }
+}
+
+//
+// Fill a TLB entry of the given size at the given VA from a neighbouring leaf
+// PTE, returning False if the PTE is not a valid leaf, is misaligned, does not
+// allow the access or would require an A/D bit update (no errors are reported)
+//
+static Bool fillPrefetchEntry(
+    riscvP    riscv,
+    riscvMode mode,
+    tlbEntryP entry,
+    memPriv   requiredPriv,
+    Uns64     VA,
+    Uns64     size,
+    Uns64     PTEAddr,
+    Uns32     entryBytes,
+    Uns64     PTE
+) {
+    Sv32Entry PTE32 = {raw : PTE};
+    Sv39Entry PTE39 = {raw : PTE};
+    Uns64     PA;
+
+    // V, R, W, X, U, G, A and D are in the same positions in all formats
+    if(entryBytes==4) {
+        PA = (Uns64)PTE32.fields.PPN << RISCV_PAGE_SHIFT;
+    } else {
+        PA = (Uns64)PTE39.fields.PPN << RISCV_PAGE_SHIFT;
+    }
+
+    // require a valid leaf entry with correct superpage alignment
+    if(
+        !PTE32.fields.V ||
+        !PTE32.fields.priv ||
+        ((PTE32.fields.priv&MEM_PRIV_RW) == MEM_PRIV_W) ||
+        (PA & (size-1))
+    ) {
+        return False;
+    }
+
+    // fill TLB entry
+    initialEntry(entry, riscv, VA);
+
+    entry->highVA = VA + size - 1;
+    entry->PA     = PA;
+    entry->priv   = PTE32.fields.priv;
+    entry->U      = PTE32.fields.U;
+    entry->G      = getG(riscv, PTE32.fields.G);
+    entry->A      = PTE32.fields.A;
+    entry->D      = PTE32.fields.D;
+
+    recordPTE(entry, PTEAddr, entryBytes, PTE);
+
+    // require access permission and no A/D bit update
+    return (
+        checkEntryPermission(riscv, mode, entry, requiredPriv) &&
+        entry->A &&
+        (entry->D || !(requiredPriv & MEM_PRIV_W))
+    );
+}
+
+//
+// Create TLB entries for up to tlb_prefetch pages following the given entry,
+// reading their leaf PTEs directly from the same page table page as the entry
+// leaf PTE (prefetch stops at the end of that page or at any PTE that is not a
+// usable leaf; prefetch reads are not counted as table walks)
+//
+static void prefetchTLBEntries(
+    riscvP         riscv,
+    riscvMode      mode,
+    tlbEntryP      entry,
+    memPriv        requiredPriv,
+    memAccessAttrs attrs
+) {
+    riscvTLBP  tlb        = riscv->tlb;
+    Uns32      num        = riscv->configInfo.tlb_prefetch;
+    Uns32      entryBytes = entry->PTEBytes;
+    Uns64      size       = entry->highVA - entry->lowVA + 1;
+    Uns64      PTEAddr    = entry->PTEAddr;
+    Uns64      VA         = entry->highVA + 1;
+    riscvTLBP  statsTLB   = getStatsTLB(riscv);
+    memDomainP domain     = getPTWDomain(riscv);
+
+    tlb->prefetchNum = 0;
+
+    if(!num || riscv->artifactAccess || !entryBytes) {
+        return;
+    }
+
+    if(num>TLB_PREFETCH_MAX) {
+        num = TLB_PREFETCH_MAX;
+    }
+
+    while(tlb->prefetchNum<num) {
+
+        tlbEntry tmp;
+        Uns64    PTE;
+
+        PTEAddr += entryBytes;
+
+        // stop at the end of the page table page, an invalid VA or an
+        // existing entry
+        if(
+            !(PTEAddr & (RISCV_PAGE_SIZE-1)) ||
+            !validPrefetchVA(riscv, VA) ||
+            findTLBEntry(riscv, tlb, VA)
+        ) {
+            break;
+        }
+
+        // read neighbouring leaf PTE
+        PTE = readPageTableEntry(riscv, domain, PTEAddr, entryBytes, attrs);
+
+        // stop if the PTE is unreadable or unusable
+        if(
+            riscv->PTWBadAddr ||
+            !fillPrefetchEntry(
+                riscv, mode, &tmp, requiredPriv, VA, size, PTEAddr,
+                entryBytes, PTE
+            )
+        ) {
+            break;
+        }
+
+        entry = allocateTLBEntry(riscv, tlb, &tmp, attrs);
+
+        tlb->prefetched[tlb->prefetchNum++] = entry;
+
+        // count prefetched entries if required
+        if(statsTLB) {
+            statsTLB->stats.prefetches++;
+        }
+
+        VA = entry->highVA + 1;
+    }
+}
+
 //
 // Find or create a TLB entry for the passed VA
 //
@@ -1945,11 +2519,18 @@ static tlbEntryP findOrCreateTLBEntry(
         riscv, mode, entry, requiredPriv, attrs, miP
     );
 
-    // to table walk to find entry if required
-    if(!entry) {
+    if(entry) {
+
+        // count misses resolved using an existing entry if required
+        TLB_STATS_INC_ACTIVE(riscv, hits);
+
+    } else {
 
         tlbEntry tmp;
 
+        // count TLB misses if required
+        RISCV_STATS_INC(riscv, tlbMisses);
+
         // seed temporary entry
         initialEntry(&tmp, riscv, VA);
 
@@ -1969,6 +2550,11 @@ static tlbEntryP findOrCreateTLBEntry(
         entry = validateTLBEntryPriv(
             riscv, mode, entry, requiredPriv, attrs, miP
         );
+
+        // create entries for neighbouring pages if required
+        if(entry) {
+            prefetchTLBEntries(riscv, mode, entry, requiredPriv, attrs);
+        }
     }
 
     return entry;
@@ -2511,6 +3097,7 @@ static void mapPMP(
         if(((priv&requiredPriv) != requiredPriv) || (highMap<highPA)) {
             riscv->AFErrorIn = riscv_AFault_PMP;
         } else {
+            RISCV_STATS_INC(riscv, pmpRemaps);
             setPMPPriv(riscv, mode, lowMap, highMap, priv);
         }
     }
@@ -2549,6 +3136,45 @@ static void mapPMA(
 // TLB / PMP UPDATE
 ////////////////////////////////////////////////////////////////////////////////
 
+//
+// Map one window of a TLB entry in the virtual domain to the specified range in
+// the corresponding PMP domain
+//
+static void mapTLBEntryWindow(
+    riscvP     riscv,
+    tlbEntryP  entry,
+    memDomainP domainV,
+    riscvMode  mode,
+    memPriv    requiredPriv,
+    memPriv    priv,
+    Uns64      lowVA,
+    Uns64      lowPA,
+    Uns64      size
+) {
+    memDomainP domainP  = getPMPDomainPriv(riscv, mode, requiredPriv);
+    Uns64      highPA   = lowPA + size - 1;
+    Uns32      ASIDMask = getEntryASIDMask(entry, mode);
+    Uns32      ASID     = getEntrySimASID(entry);
+
+    // create virtual mapping
+    vmirtAliasMemoryVM(
+        domainP, domainV, lowPA, highPA, lowVA, 0, priv, ASIDMask, ASID
+    );
+
+    // update PMP mapping if required
+    mapPMP(riscv, mode, requiredPriv, lowPA, highPA);
+
+    // update PMA mapping if required
+    mapPMA(riscv, mode, requiredPriv, lowPA, highPA);
+}
+
+//
+// Is the indexed window of a TLB entry mapped?
+//
+inline static Bool isWindowMapped(tlbEntryP entry, Uns32 window) {
+    return (entry->windows[window/64] >> (window%64)) & 1;
+}
+
 //
 // Map memory virtual addresses in virtual domain to the specified range in the
 // corresponding PMP domain
@@ -2561,44 +3187,102 @@ static void mapTLBEntry(
     memPriv     requiredPriv,
     tlbMapInfoP miP
 ) {
-    memDomainP domainP    = getPMPDomainPriv(riscv, mode, requiredPriv);
-    Uns64      lowPA      = getEntryLowPA(entry);
-    Uns64      highPA     = getEntryHighPA(entry);
-    Uns64      lowVA      = getEntryLowVA(entry);
-    Uns32      ASIDMask   = getEntryASIDMask(entry, mode);
-    Uns32      ASID       = getEntrySimASID(entry);
-    memPriv    priv       = miP->priv;
-    Uns64      size       = highPA-lowPA+1;
-    Uns64      vmiPageMax = 0x100000000ULL;
+    Uns64   lowPA  = getEntryLowPA(entry);
+    Uns64   highPA = getEntryHighPA(entry);
+    Uns64   lowVA  = getEntryLowVA(entry);
+    memPriv priv   = miP->priv;
+    Uns64   size   = highPA-lowPA+1;
 
-    // restrict mapping size to VMI maximum (4Gb)
-    if(size>vmiPageMax) {
+    if(size<=VMI_PAGE_MAX) {
 
-        Uns64 VAtoPA = lowPA-lowVA;
+        // map the entire entry
+        mapTLBEntryWindow(
+            riscv, entry, domainV, mode, requiredPriv, priv, lowVA, lowPA, size
+        );
 
-        size   = vmiPageMax;
-        lowVA  = miP->lowVA & -size;
-        lowPA  = lowVA + VAtoPA;
-        highPA = lowPA + size - 1;
-    }
+        // indicate mapped range
+        miP->lowVA  = lowVA;
+        miP->highVA = lowVA + size - 1;
 
-    // create virtual mapping
-    vmirtAliasMemoryVM(
-        domainP, domainV, lowPA, highPA, lowVA, 0, priv, ASIDMask, ASID
-    );
+    } else {
 
-    // update PMP mapping if required
-    mapPMP(riscv, mode, requiredPriv, lowPA, highPA);
+        // entry exceeds VMI maximum (4Gb): map the accessed window and any
+        // neighbouring windows not already mapped, so that sequential accesses
+        // crossing a window boundary do not cause further misses
+        Uns64 VAtoPA  = lowPA-lowVA;
+        Uns32 windows = size >> VMI_PAGE_MAX_SHIFT;
+        Uns32 window  = (miP->lowVA-lowVA) >> VMI_PAGE_MAX_SHIFT;
+        Uns32 first   = 0;
+        Uns32 last    = window+TLB_WINDOW_PREFETCH;
+        Uns32 i;
 
-    // update PMA mapping if required
-    mapPMA(riscv, mode, requiredPriv, lowPA, highPA);
+        VMI_ASSERT(windows<=TLB_MAX_WINDOWS, "unexpected windows %u", windows);
+
+        if(window>TLB_WINDOW_PREFETCH) {
+            first = window-TLB_WINDOW_PREFETCH;
+        }
+
+        if(last>=windows) {
+            last = windows-1;
+        }
+
+        for(i=first; i<=last; i++) {
+
+            if((i==window) || !isWindowMapped(entry, i)) {
+
+                Uns64 windowVA = lowVA + ((Uns64)i<<VMI_PAGE_MAX_SHIFT);
+
+                mapTLBEntryWindow(
+                    riscv, entry, domainV, mode, requiredPriv, priv,
+                    windowVA, windowVA+VAtoPA, VMI_PAGE_MAX
+                );
+
+                // record mapped window
+                entry->windows[i/64] |= 1ULL<<(i%64);
+            }
+        }
+
+        // indicate mapped range (the accessed window)
+        miP->lowVA  = lowVA + ((Uns64)window<<VMI_PAGE_MAX_SHIFT);
+        miP->highVA = miP->lowVA + VMI_PAGE_MAX - 1;
+    }
 
     // indicate entry is mapped in this mode
     entry->isMapped |= getModeMask(mode);
+}
+
+//
+// Map entries created speculatively for neighbouring pages by the last table
+// walk
+//
+static void mapPrefetchedTLBEntries(
+    riscvP         riscv,
+    memDomainP     domain,
+    riscvMode      mode,
+    memPriv        requiredPriv,
+    memAccessAttrs attrs,
+    riscvSimASID   simASID
+) {
+    riscvTLBP tlb = riscv->tlb;
+    Uns32     i;
+
+    for(i=0; i<tlb->prefetchNum; i++) {
+
+        tlbEntryP  entry = tlb->prefetched[i];
+        tlbMapInfo mi    = {
+            lowVA  : entry->lowVA,
+            highVA : entry->highVA,
+            priv   : requiredPriv
+        };
+
+        if(validateTLBEntryPriv(riscv, mode, entry, requiredPriv, attrs, &mi)) {
+            entry->simASID   = simASID;
+            entry->variants |= 1<<getSimASIDVariant(simASID);
+            mapTLBEntry(riscv, entry, domain, mode, requiredPriv, &mi);
+        }
+    }
 
-    // indicate mapped range
-    miP->lowVA  = lowVA;
-    miP->highVA = lowVA + size - 1;
+    tlb->prefetchNum = 0;
 }
 
 //
@@ -2625,16 +3309,19 @@ static Bool tlbMiss(
     // create full simulated ASID (including MSTATUS bits)
     riscvSimASID simASID = getSimASID(riscv);
 
-    // if the entry was previously mapped with a different simulated ASID,
-    // unmap it in affected domains (handles changes in MSTATUS bits)
-    unmapTLBEntryNewASID(riscv, entry, simASID);
-
-    // save full simulated ASID for use when the entry is unmapped
-    entry->simASID = simASID;
+    // save full simulated ASID for use when the entry is mapped. Any mappings
+    // made with other MSTATUS (SUM, MXR) values are retained alongside this
+    // one, so toggling those bits only changes the processor ASID; all
+    // variants are removed when the entry is unmapped
+    entry->simASID   = simASID;
+    entry->variants |= 1<<getSimASIDVariant(simASID);
 
     // create entry mapping
     mapTLBEntry(riscv, entry, domain, mode, requiredPriv, miP);
 
+    // map any entries created speculatively for neighbouring pages
+    mapPrefetchedTLBEntries(riscv, domain, mode, requiredPriv, attrs, simASID);
+
     // indicate TLB entry permissions are ok
     return False;
 }
@@ -2708,6 +3395,14 @@ Bool riscvVMMiss(
                 // access to virtually-mapped domain
                 Uns64      lastVA = address+bytes-1;
                 tlbMapInfo mi     = {lowVA:address, highVA:address-1};
+                riscvTLBP  tlb    = getStatsTLB(riscv);
+                clock_t    start  = 0;
+
+                // count misses and start miss path timer if required
+                if(tlb) {
+                    TLB_STATS_INC(tlb, RD_CSR_FIELD(riscv, satp, ASID), misses);
+                    start = clock();
+                }
 
                 // iterate while unprocessed regions remain
                 do {
@@ -2720,6 +3415,11 @@ Bool riscvVMMiss(
 
                 } while(!miss && ((lastVA<mi.lowVA) || (lastVA>mi.highVA)));
 
+                // accumulate time in miss path if required
+                if(tlb) {
+                    tlb->stats.missClocks += clock()-start;
+                }
+
             } else if(dt) {
 
                 Uns64 lowPA  = address;
@@ -2754,6 +3454,39 @@ void riscvVMSetASID(riscvP riscv) {
     vmirtSetProcessorASID((vmiProcessorP)riscv, getSimASID(riscv).u32);
 }
 
+//
+// Fill TLB statistics for the hart, returning False if it has no TLB
+//
+Bool riscvVMGetTLBStats(riscvP riscv, riscvTLBStatsP stats) {
+
+    riscvTLBP tlb = riscv->tlb;
+
+    if(tlb) {
+        *stats = tlb->stats;
+    }
+
+    return tlb && True;
+}
+
+//
+// Fill TLB event counts for the given ASID, returning False if it has no TLB
+// (counts are zero for an ASID with no recorded events)
+//
+Bool riscvVMGetTLBCountsASID(riscvP riscv, Uns32 ASID, riscvTLBCountsP counts) {
+
+    riscvTLBP tlb = riscv->tlb;
+
+    if(tlb) {
+
+        riscvTLBCounts  none       = {0};
+        riscvTLBCountsP asidCounts = lookupASIDCounts(tlb, ASID);
+
+        *counts = asidCounts ? *asidCounts : none;
+    }
+
+    return tlb && True;
+}
+
 //
 // Mask given ASID to implemented ASID bits
 //
@@ -2775,10 +3508,40 @@ static Uns32 maskASID(riscvP riscv, Uns32 ASID) {
     return ASID & getASIDMask(riscv);
 }
 
+//
+// Count TLB invalidations of the given type if required
+//
+static void countInvalidation(riscvP riscv, riscvTLBInvType type) {
+
+    riscvTLBP tlb = getStatsTLB(riscv);
+
+    if(tlb) {
+        tlb->stats.invalidations[type]++;
+    }
+}
+
+//
+// Invalidate timing model TLB entries if required (the timing model TLB does
+// not distinguish ASIDs, so all ASID-specific invalidations affect all entries
+// for the address)
+//
+static void invalidateTimingTLB(riscvP riscv, Bool allVA, Uns64 VA) {
+
+    if(!riscv->timing) {
+        // no action
+    } else if(allVA) {
+        riscvTimingInvalidateTLB(riscv);
+    } else {
+        riscvTimingInvalidateTLBVA(riscv, VA);
+    }
+}
+
 //
 // Invalidate entire TLB
 //
 void riscvVMInvalidateAll(riscvP riscv) {
+    countInvalidation(riscv, RVTI_ALL);
+    invalidateTimingTLB(riscv, True, 0);
     invalidateTLBEntriesRange(riscv, riscv->tlb, 0, RISCV_MAX_ADDR, MM_ANY, 0);
 }
 
@@ -2786,6 +3549,8 @@ void riscvVMInvalidateAll(riscvP riscv) {
 // Invalidate entire TLB with matching ASID
 //
 void riscvVMInvalidateAllASID(riscvP riscv, Uns32 ASID) {
+    countInvalidation(riscv, RVTI_ASID);
+    invalidateTimingTLB(riscv, True, 0);
     ASID = maskASID(riscv, ASID);
     invalidateTLBEntriesRange(riscv, riscv->tlb, 0, RISCV_MAX_ADDR, MM_ASID, ASID);
 }
@@ -2794,6 +3559,8 @@ void riscvVMInvalidateAllASID(riscvP riscv, Uns32 ASID) {
 // Invalidate TLB entries for the given address
 //
 void riscvVMInvalidateVA(riscvP riscv, Uns64 VA) {
+    countInvalidation(riscv, RVTI_VA);
+    invalidateTimingTLB(riscv, False, VA);
     invalidateTLBEntriesRange(riscv, riscv->tlb, VA, VA, MM_ANY, 0);
 }
 
@@ -2801,6 +3568,8 @@ void riscvVMInvalidateVA(riscvP riscv, Uns64 VA) {
 // Invalidate TLB entries with matching address and ASID
 //
 void riscvVMInvalidateVAASID(riscvP riscv, Uns64 VA, Uns32 ASID) {
+    countInvalidation(riscv, RVTI_VA_ASID);
+    invalidateTimingTLB(riscv, False, VA);
     ASID = maskASID(riscv, ASID);
     invalidateTLBEntriesRange(riscv, riscv->tlb, VA, VA, MM_ASID, ASID);
 }
@@ -2811,20 +3580,15 @@ void riscvVMInvalidateVAASID(riscvP riscv, Uns64 VA, Uns32 ASID) {
 void riscvVMRefreshMPRVDomain(riscvP riscv) {
 
     // get current VM enable and mode
-    Bool       VM     = RD_CSR_FIELD(riscv, satp, MODE);
-    riscvMode  mode   = getCurrentMode(riscv);
-    memDomainP domain = 0;
+    Bool       VM   = RD_CSR_FIELD(riscv, satp, MODE) ? True : False;
+    riscvMode  mode = getCurrentMode(riscv);
+    memDomainP domain;
 
     // if mstatus.MPRV is set, use that mode
     if(getMPRV(riscv)) {
 
-        // get raw value of mstatus.MPP
-        riscvMode modeMPP = getMPP(riscv);
-
-        // clamp to implemented mode
-        if(!riscvHasMode(riscv, modeMPP)) {
-            modeMPP = riscvGetMinMode(riscv);
-        }
+        // get mstatus.MPP clamped to implemented mode
+        riscvMode modeMPP = riscv->modesMPP[getMPP(riscv)];
 
         // if modeMPP > mode, this is suspicious
         if(modeMPP > mode) {
@@ -2844,16 +3608,8 @@ void riscvVMRefreshMPRVDomain(riscvP riscv) {
     // record data access mode (affects endianness)
     riscv->dmode = mode;
 
-    // look for virtual domain for this mode if required
-    if(VM) {
-        domain = riscv->vmDomains[mode][0];
-    }
-
-    // look for physical domain for this mode if MMU is not enabled or the
-    // domain is not VM-managed
-    if(!domain) {
-        domain = riscv->physDomains[mode][0];
-    }
+    // get precomputed domain for this VM enable and mode
+    domain = riscv->dataDomainsMPRV[VM][mode];
 
     // switch to the indicated domain if it is not current
     if(domain && (domain!=vmirtGetProcessorDataDomain((vmiProcessorP)riscv))) {
@@ -2878,8 +3634,11 @@ static void saveTLBEntry(vmiSaveContextP cxt, tlbEntryP entry) {
     tlbEntry entryS = *entry;
 
     // clear down properties used to manage mapping
-    entryS.isMapped = 0;
-    entryS.lutEntry = 0;
+    entryS.isMapped   = 0;
+    entryS.variants   = 0;
+    entryS.windows[0] = 0;
+    entryS.windows[1] = 0;
+    entryS.lutEntry   = 0;
 
     vmirtSaveElement(
         cxt, RISCV_TLB_ENTRY, RISCV_TLB_END, &entryS, sizeof(entryS)
@@ -25,6 +25,45 @@
 // model header files
 #include "riscvTypeRefs.h"
 
+//
+// Types of TLB invalidation (corresponding to sfence.vma operand combinations)
+//
+typedef enum riscvTLBInvTypeE {
+    RVTI_ALL,               // all entries
+    RVTI_ASID,              // all non-global entries with ASID
+    RVTI_VA,                // all entries for address
+    RVTI_VA_ASID,           // non-global entries for address with ASID
+    RVTI_LAST               // KEEP LAST: for sizing
+} riscvTLBInvType;
+
+//
+// Maximum number of page table levels read by a table walk (Sv48)
+//
+#define RISCV_TLB_WALK_LEVELS 4
+
+//
+// TLB event counts (either for a hart or for one ASID of a hart)
+//
+typedef struct riscvTLBCountsS {
+    Uns64 misses;           // riscvVMMiss calls for virtual domains
+    Uns64 hits;             // misses resolved using an existing TLB entry
+    Uns64 walks;            // page table walks
+    Uns64 adUpdates;        // page table entry A/D bit updates
+    Uns64 evictions;        // TLB entries deleted
+} riscvTLBCounts, *riscvTLBCountsP;
+
+//
+// TLB statistics for a hart (only updated when parameter statistics is True)
+//
+typedef struct riscvTLBStatsS {
+    riscvTLBCounts total;                       // counts for all ASIDs
+    Uns64 walkDepth[RISCV_TLB_WALK_LEVELS];     // walks by levels read
+    Uns64 prefetches;                           // entries created by prefetch
+    Uns64 invalidations[RVTI_LAST];             // invalidations by type
+    Uns64 missClocks;                           // host clock() ticks in miss
+                                                // path (CLOCKS_PER_SEC units)
+} riscvTLBStats, *riscvTLBStatsP;
+
 //
 // Try mapping memory at the passed address for the specified access type and
 // return a status code indicating if there was a TLB miss
@@ -68,6 +107,17 @@ void riscvVMInvalidateVA(riscvP riscv, Uns64 VA);
 //
 void riscvVMInvalidateVAASID(riscvP riscv, Uns64 VA, Uns32 ASID);
 
+//
+// Fill TLB statistics for the hart, returning False if it has no TLB
+//
+Bool riscvVMGetTLBStats(riscvP riscv, riscvTLBStatsP stats);
+
+//
+// Fill TLB event counts for the given ASID, returning False if it has no TLB
+// (counts are zero for an ASID with no recorded events)
+//
+Bool riscvVMGetTLBCountsASID(riscvP riscv, Uns32 ASID, riscvTLBCountsP counts);
+
 //
 // Read the indexed PMP configuration register
 //
@@ -0,0 +1,237 @@
+#!/usr/bin/python3
+
+# Copyright Imperas Software Ltd
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http:#www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import argparse
+import struct
+import sys
+
+# layout must match riscvStateHeader, riscvStateCSR and riscvStatePage in
+# source/riscvStateExport.h
+MAGIC   = b'RVSTATE1'
+VERSION = 1
+HEADER  = struct.Struct('<8sIIIIIIIIQQ32Q32Q')
+CSR     = struct.Struct('<IIQ')
+PAGE    = struct.Struct('<Q')
+
+MSTATUS = 0x300
+MEPC    = 0x341
+FCSR    = 0x003
+
+def readState(name):
+
+    '''
+        Read an architectural state file written by riscvOVPsim (parameter
+        export_file)
+    '''
+
+    with open(name, 'rb') as f:
+        data = f.read()
+
+    fields = HEADER.unpack_from(data, 0)
+
+    if fields[0] != MAGIC or fields[1] != VERSION:
+        sys.exit('%s: not a version %d architectural state file' % (name, VERSION))
+
+    state = {
+        'hartId'   : fields[2],
+        'xlen'     : fields[3],
+        'flen'     : fields[4],
+        'mode'     : fields[5],
+        'pageBytes': fields[8],
+        'iCount'   : fields[9],
+        'pc'       : fields[10],
+        'x'        : fields[11:43],
+        'f'        : fields[43:75],
+        'csrs'     : [],
+        'pages'    : [],
+    }
+
+    offset = HEADER.size
+
+    for _ in range(fields[6]):
+        state['csrs'].append(CSR.unpack_from(data, offset))
+        offset += CSR.size
+
+    for _ in range(fields[7]):
+        address = PAGE.unpack_from(data, offset)[0]
+        offset += PAGE.size
+        state['pages'].append((address, data[offset:offset+state['pageBytes']]))
+        offset += state['pageBytes']
+
+    return state
+
+def isRestored(csrNum, writable):
+
+    '''
+        Should the stub restore this CSR? Read-only CSRs, debug-mode CSRs,
+        fflags and frm (restored by fcsr) and mstatus and mepc (used to return
+        to the exported mode and PC) are not restored directly
+    '''
+
+    return (writable and
+            (csrNum >> 10) != 3 and
+            not 0x7b0 <= csrNum <= 0x7bf and
+            csrNum not in (0x001, 0x002, MSTATUS, MEPC))
+
+def csrOrder(csr):
+
+    '''
+        Restore pmpaddr registers before pmpcfg registers, so that locked
+        entries do not prevent address updates
+    '''
+
+    csrNum = csr[0]
+
+    return (1 if 0x3a0 <= csrNum <= 0x3af else 0, csrNum)
+
+def writeStub(state, name, memory):
+
+    '''
+        Write an assembler loader stub restoring the exported state
+    '''
+
+    mask  = (1 << state['xlen']) - 1
+    flen  = state['flen']
+    csrs  = dict((c[0], c[2]) for c in state['csrs'])
+    lines = []
+
+    def emit(line=''):
+        lines.append(line)
+
+    emit('# loader stub generated by riscvWarmStart.py')
+    emit('# hart %d, PC 0x%x, mode %d, %d instructions executed' % (
+        state['hartId'], state['pc'], state['mode'], state['iCount']))
+    emit()
+    emit('    .section .text.init')
+    emit('    .globl _start')
+    emit('_start:')
+
+    if memory and state['pages']:
+        emit()
+        emit('    # memory pages')
+        for address, data in state['pages']:
+            for i in range(0, len(data), 4):
+                # store offsets must fit a 12-bit signed immediate
+                if not i % 2048:
+                    emit('    li t0, 0x%x' % (address + i))
+                word = struct.unpack_from('<I', data, i)[0]
+                emit('    li t1, 0x%x' % word)
+                emit('    sw t1, %d(t0)' % (i % 2048))
+
+    if flen:
+        load = 'fld' if flen == 64 else 'flw'
+        emit()
+        emit('    # FPRs (mstatus.FS must be non-zero)')
+        emit('    li t0, 0x2000')
+        emit('    csrs mstatus, t0')
+        emit('    la t0, fpr_data')
+        for i in range(32):
+            emit('    %s f%d, %d(t0)' % (load, i, i * flen // 8))
+
+    emit()
+    emit('    # CSRs')
+    for csrNum, writable, value in sorted(state['csrs'], key=csrOrder):
+        if isRestored(csrNum, writable) and (flen or csrNum != FCSR):
+            emit('    li t0, 0x%x' % (value & mask))
+            emit('    csrw 0x%03x, t0' % csrNum)
+
+    # mret sets mode from MPP and MIE from MPIE, so set those fields to give
+    # the exported mode and MIE; mstatus.MPIE, mstatus.MPP and mepc are not
+    # restored
+    mstatus = csrs.get(MSTATUS, 0)
+    mstatus = (mstatus & ~0x1880) | (state['mode'] << 11) | ((mstatus & 0x8) << 4)
+
+    emit()
+    emit('    # return to exported mode and PC')
+    emit('    li t0, 0x%x' % (mstatus & mask))
+    emit('    csrw mstatus, t0')
+    emit('    li t0, 0x%x' % (state['pc'] & mask))
+    emit('    csrw mepc, t0')
+
+    emit()
+    emit('    # GPRs')
+    for i in range(1, 32):
+        emit('    li x%d, 0x%x' % (i, state['x'][i] & mask))
+
+    emit('    mret')
+
+    if flen:
+        emit()
+        emit('    .align 3')
+        emit('fpr_data:')
+        for i in range(32):
+            if flen == 64:
+                emit('    .dword 0x%x' % state['f'][i])
+            else:
+                emit('    .word 0x%x' % (state['f'][i] & 0xffffffff))
+
+    with open(name, 'w') as f:
+        f.write('\n'.join(lines) + '\n')
+
+def writeVmem(state, name, base, wordBytes):
+
+    '''
+        Write exported memory pages in vmem format (word addresses relative to
+        base, little-endian words, eight words per line)
+    '''
+
+    with open(name, 'w') as f:
+        for address, data in state['pages']:
+            for i in range(0, len(data), 8 * wordBytes):
+                chunk = data[i:i + 8 * wordBytes]
+                words = [chunk[j:j + wordBytes][::-1].hex()
+                         for j in range(0, len(chunk), wordBytes)]
+                f.write('@%08x %s\n' % (
+                    (address + i - base) // wordBytes, ' '.join(words)))
+
+def main():
+
+    '''
+        Generate a loader stub and memory image from an architectural state
+        file written by riscvOVPsim (parameter export_file)
+    '''
+
+    parser = argparse.ArgumentParser(description=main.__doc__.strip())
+    parser.add_argument('file',
+                        help='state file written by the simulator')
+    parser.add_argument('--output',
+                        help='output prefix (default is the state file name)')
+    parser.add_argument('--mem-base',
+                        type=lambda s: int(s, 0),
+                        default=0,
+                        help='address of the first word of target memory (default 0)')
+    parser.add_argument('--word-bytes',
+                        type=int,
+                        default=4,
+                        help='bytes per vmem word (default 4)')
+    parser.add_argument('--stub-memory',
+                        action='store_true',
+                        help='restore memory pages with stores in the stub instead of a vmem image')
+    args = parser.parse_args()
+
+    state  = readState(args.file)
+    prefix = args.output or args.file
+
+    writeStub(state, prefix + '.S', args.stub_memory)
+
+    if not args.stub_memory:
+        writeVmem(state, prefix + '.vmem', args.mem_base, args.word_bytes)
+
+    print('hart %d: %d CSRs, %d pages, PC 0x%x' % (
+        state['hartId'], len(state['csrs']), len(state['pages']), state['pc']))
+
+if __name__ == '__main__':
+    main()
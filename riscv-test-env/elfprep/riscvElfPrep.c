@@ -0,0 +1,765 @@
+//
+// riscvElfPrep: prepare test artifacts from a RISC-V ELF file in one pass,
+// replacing objcopy, srec_cat, readelf and objdump chains in target makefiles.
+//
+// See COPYING.BSD in the repository root for license details.
+//
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if !defined(_WIN32)
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#endif
+
+#define ELF_PT_LOAD       1
+#define ELF_SHT_SYMTAB    2
+#define ELF_SHT_NOBITS    8
+#define ELF_SHF_ALLOC     2
+#define ELF_STT_SECTION   3
+#define ELF_STT_FILE      4
+#define DEFAULT_OBJDUMP   "riscv64-unknown-elf-objdump"
+#define MAX_PATH          4096
+
+
+////////////////////////////////////////////////////////////////////////////////
+// TYPES
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Requested artifacts and options
+//
+typedef struct optionsS {
+    bool        bin;            // write <elf>.bin (objcopy -O binary)
+    bool        vmem;           // write <elf>.vmem (srec_cat -vmem)
+    bool        symbols;        // write <elf>.symbols (symbol map)
+    bool        disassemble;    // write <elf>.objdump if out of date
+    bool        swap;           // byte-swap vmem words (little-endian)
+    unsigned    wordBytes;      // bytes per vmem word
+    unsigned    jobs;           // parallel jobs for directories
+    const char *objdump;        // objdump command
+} options;
+
+//
+// ELF file image
+//
+typedef struct elfFileS {
+    const char    *name;        // file name
+    const uint8_t *data;        // file contents
+    uint64_t       size;        // file size
+    bool           is64;        // ELFCLASS64?
+} elfFile;
+
+//
+// Loadable contents of one section
+//
+typedef struct segmentS {
+    uint64_t address;           // physical (load) address
+    uint64_t offset;            // file offset
+    uint64_t bytes;             // bytes in file
+} segment;
+
+//
+// Symbol map entry
+//
+typedef struct symbolS {
+    uint64_t    address;        // symbol value
+    const char *name;           // symbol name
+} symbol;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// UTILITIES
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Read little-endian values from the ELF image
+//
+static uint64_t getLE(const elfFile *elf, uint64_t offset, unsigned bytes) {
+
+    uint64_t result = 0;
+    unsigned i;
+
+    if(offset+bytes <= elf->size) {
+        for(i=0; i<bytes; i++) {
+            result |= (uint64_t)elf->data[offset+i] << (i*8);
+        }
+    }
+
+    return result;
+}
+
+//
+// Read a field whose offset and size depend on the ELF class
+//
+static uint64_t getField(
+    const elfFile *elf,
+    uint64_t       base,
+    unsigned       offset32,
+    unsigned       offset64,
+    unsigned       bytes32,
+    unsigned       bytes64
+) {
+    return elf->is64 ?
+        getLE(elf, base+offset64, bytes64) :
+        getLE(elf, base+offset32, bytes32);
+}
+
+//
+// Compare segments by address (for qsort)
+//
+static int compareSegments(const void *a, const void *b) {
+
+    const segment *sa = a;
+    const segment *sb = b;
+
+    return (sa->address<sb->address) ? -1 : (sa->address>sb->address) ? 1 : 0;
+}
+
+//
+// Compare symbols by address, then name (for qsort)
+//
+static int compareSymbols(const void *a, const void *b) {
+
+    const symbol *sa = a;
+    const symbol *sb = b;
+
+    if(sa->address!=sb->address) {
+        return (sa->address<sb->address) ? -1 : 1;
+    }
+
+    return strcmp(sa->name, sb->name);
+}
+
+//
+// Open an output file named <elf><suffix>
+//
+static FILE *openOutput(const char *elfName, const char *suffix) {
+
+    char  name[MAX_PATH];
+    FILE *file;
+
+    snprintf(name, sizeof(name), "%s%s", elfName, suffix);
+
+    if(!(file=fopen(name, "wb"))) {
+        fprintf(stderr, "riscvElfPrep: cannot write '%s'\n", name);
+    }
+
+    return file;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// ELF READING
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Read the whole ELF file, returning false if it is not a little-endian ELF
+//
+static bool readElf(const char *name, elfFile *elf) {
+
+    FILE    *file = fopen(name, "rb");
+    uint8_t *data = 0;
+    long     size = -1;
+
+    if(file && !fseek(file, 0, SEEK_END) && ((size=ftell(file))>=64)) {
+
+        rewind(file);
+
+        if((data=malloc(size)) && (fread(data, 1, size, file)!=(size_t)size)) {
+            free(data);
+            data = 0;
+        }
+    }
+
+    if(file) {
+        fclose(file);
+    }
+
+    if(!data) {
+        fprintf(stderr, "riscvElfPrep: cannot read '%s'\n", name);
+        return false;
+    }
+
+    if(memcmp(data, "\177ELF", 4) || (data[5]!=1)) {
+        fprintf(
+            stderr, "riscvElfPrep: '%s' is not a little-endian ELF\n", name
+        );
+        free(data);
+        return false;
+    }
+
+    elf->name = name;
+    elf->data = data;
+    elf->size = size;
+    elf->is64 = data[4]==2;
+
+    return true;
+}
+
+//
+// Return the load address of file contents at the given offset, from the
+// loadable segment containing them (or the given address if none)
+//
+static uint64_t getLoadAddress(
+    const elfFile *elf,
+    uint64_t       offset,
+    uint64_t       address
+) {
+    uint64_t phoff  = getField(elf, 0, 0x1c, 0x20, 4, 8);
+    unsigned phsize = getField(elf, 0, 0x2a, 0x36, 2, 2);
+    unsigned phnum  = getField(elf, 0, 0x2c, 0x38, 2, 2);
+    unsigned i;
+
+    for(i=0; i<phnum; i++) {
+
+        uint64_t ph     = phoff + (uint64_t)i*phsize;
+        uint64_t poff   = getField(elf, ph,  4,  8, 4, 8);
+        uint64_t paddr  = getField(elf, ph, 12, 24, 4, 8);
+        uint64_t pbytes = getField(elf, ph, 16, 32, 4, 8);
+
+        if(
+            (getLE(elf, ph, 4)==ELF_PT_LOAD) &&
+            (offset>=poff) && (offset<poff+pbytes)
+        ) {
+            return paddr + offset - poff;
+        }
+    }
+
+    return address;
+}
+
+//
+// Return allocated sections with file contents, sorted by load address (the
+// contents written by objcopy -O binary)
+//
+static segment *getSegments(const elfFile *elf, unsigned *numP) {
+
+    uint64_t shoff  = getField(elf, 0, 0x20, 0x28, 4, 8);
+    unsigned shsize = getField(elf, 0, 0x2e, 0x3a, 2, 2);
+    unsigned shnum  = getField(elf, 0, 0x30, 0x3c, 2, 2);
+    segment *result = calloc(shnum ? shnum : 1, sizeof(*result));
+    unsigned num    = 0;
+    unsigned i;
+
+    for(i=0; i<shnum; i++) {
+
+        uint64_t sh    = shoff + (uint64_t)i*shsize;
+        unsigned type  = getLE(elf, sh+4, 4);
+        uint64_t flags = getField(elf, sh, 8, 8, 4, 8);
+
+        segment s = {
+            .offset = getField(elf, sh, 16, 24, 4, 8),
+            .bytes  = getField(elf, sh, 20, 32, 4, 8),
+        };
+
+        if(
+            (flags & ELF_SHF_ALLOC) &&
+            (type!=ELF_SHT_NOBITS) &&
+            s.bytes &&
+            (s.offset+s.bytes <= elf->size)
+        ) {
+            s.address = getLoadAddress(
+                elf, s.offset, getField(elf, sh, 12, 16, 4, 8)
+            );
+            result[num++] = s;
+        }
+    }
+
+    qsort(result, num, sizeof(*result), compareSegments);
+
+    *numP = num;
+
+    return result;
+}
+
+//
+// Return defined symbols from the symbol table, sorted by address
+//
+static symbol *getSymbols(const elfFile *elf, unsigned *numP) {
+
+    uint64_t shoff  = getField(elf, 0, 0x20, 0x28, 4, 8);
+    unsigned shsize = getField(elf, 0, 0x2e, 0x3a, 2, 2);
+    unsigned shnum  = getField(elf, 0, 0x30, 0x3c, 2, 2);
+    symbol  *result = 0;
+    unsigned num    = 0;
+    unsigned i, j;
+
+    for(i=0; i<shnum; i++) {
+
+        uint64_t sh = shoff + (uint64_t)i*shsize;
+
+        if(getLE(elf, sh+4, 4)==ELF_SHT_SYMTAB) {
+
+            uint64_t symoff  = getField(elf, sh, 16, 24, 4, 8);
+            uint64_t symsize = getField(elf, sh, 20, 32, 4, 8);
+            uint64_t entsize = getField(elf, sh, 36, 56, 4, 8);
+            unsigned link    = getField(elf, sh, 24, 40, 4, 4);
+            uint64_t strsh   = shoff + (uint64_t)link*shsize;
+            uint64_t stroff  = getField(elf, strsh, 16, 24, 4, 8);
+            uint64_t strsize = getField(elf, strsh, 20, 32, 4, 8);
+            unsigned count   = entsize ? symsize/entsize : 0;
+
+            if(
+                (symoff+symsize > elf->size) ||
+                (stroff+strsize > elf->size) ||
+                !strsize || elf->data[stroff+strsize-1]
+            ) {
+                continue;
+            }
+
+            result = realloc(result, (num+count+1)*sizeof(*result));
+
+            for(j=0; j<count; j++) {
+
+                uint64_t st    = symoff + (uint64_t)j*entsize;
+                uint64_t name  = getLE(elf, st, 4);
+                unsigned info  = getField(elf, st, 12, 4, 1, 1);
+                unsigned shndx = getField(elf, st, 14, 6, 2, 2);
+                unsigned type  = info & 0xf;
+
+                if(
+                    name && (name<strsize) && shndx &&
+                    (type!=ELF_STT_SECTION) && (type!=ELF_STT_FILE)
+                ) {
+                    result[num].address = getField(elf, st, 4, 8, 4, 8);
+                    result[num].name    = (const char *)elf->data+stroff+name;
+                    num++;
+                }
+            }
+        }
+    }
+
+    if(result) {
+        qsort(result, num, sizeof(*result), compareSymbols);
+    }
+
+    *numP = num;
+
+    return result;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// ARTIFACT WRITERS
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Return the flat binary image of all loadable segments from the lowest load
+// address, with gaps filled with zeros (as objcopy -O binary)
+//
+static uint8_t *getImage(
+    const elfFile *elf,
+    segment       *segments,
+    unsigned       num,
+    uint64_t      *bytesP
+) {
+    uint64_t base  = num ? segments[0].address : 0;
+    uint64_t bytes = 0;
+    uint8_t *image;
+    unsigned i;
+
+    for(i=0; i<num; i++) {
+        uint64_t end = segments[i].address + segments[i].bytes - base;
+        bytes = (end>bytes) ? end : bytes;
+    }
+
+    image = calloc(bytes ? bytes : 1, 1);
+
+    for(i=0; i<num; i++) {
+        memcpy(
+            image + segments[i].address - base,
+            elf->data + segments[i].offset,
+            segments[i].bytes
+        );
+    }
+
+    *bytesP = bytes;
+
+    return image;
+}
+
+//
+// Write <elf>.bin
+//
+static bool writeBin(const char *name, const uint8_t *image, uint64_t bytes) {
+
+    FILE *file = openOutput(name, ".bin");
+    bool  ok   = file && (fwrite(image, 1, bytes, file)==bytes);
+
+    if(file) {
+        fclose(file);
+    }
+
+    return ok;
+}
+
+//
+// Write <elf>.vmem, with word addresses relative to the start of the binary
+// image (as srec_cat -binary -byte-swap 4 -vmem)
+//
+static bool writeVmem(
+    const char    *name,
+    const uint8_t *image,
+    uint64_t       bytes,
+    const options *opts
+) {
+    FILE    *file  = openOutput(name, ".vmem");
+    unsigned width = opts->wordBytes;
+    uint64_t i;
+    unsigned j;
+
+    if(!file) {
+        return false;
+    }
+
+    for(i=0; i<bytes; i+=width) {
+
+        // eight words per line
+        if(!(i % (8*width))) {
+            fprintf(
+                file, "%s@%08llX", i ? "\n" : "", (unsigned long long)i/width
+            );
+        }
+
+        fputc(' ', file);
+
+        for(j=0; j<width; j++) {
+            unsigned index = opts->swap ? width-1-j : j;
+            unsigned byte  = (i+index<bytes) ? image[i+index] : 0;
+            fprintf(file, "%02X", byte);
+        }
+    }
+
+    fputs(bytes ? "\n" : "", file);
+    fclose(file);
+
+    return true;
+}
+
+//
+// Write <elf>.symbols, one "address name" line per defined symbol (including
+// begin_signature, end_signature and tohost)
+//
+static bool writeSymbols(const char *name, const elfFile *elf) {
+
+    FILE    *file  = openOutput(name, ".symbols");
+    unsigned num;
+    symbol  *syms  = getSymbols(elf, &num);
+    unsigned width = elf->is64 ? 16 : 8;
+    unsigned i;
+
+    if(file) {
+
+        for(i=0; i<num; i++) {
+            fprintf(
+                file, "%0*llx %s\n",
+                width, (unsigned long long)syms[i].address, syms[i].name
+            );
+        }
+
+        fclose(file);
+    }
+
+    free(syms);
+
+    return file!=0;
+}
+
+//
+// Write <elf>.objdump using objdump -D, only if it is missing or older than
+// the ELF file
+//
+static bool writeDisassembly(const char *name, const options *opts) {
+
+    char        output[MAX_PATH];
+    struct stat elfStat;
+    struct stat dumpStat;
+
+    snprintf(output, sizeof(output), "%s.objdump", name);
+
+    if(
+        !stat(name, &elfStat) && !stat(output, &dumpStat) &&
+        (dumpStat.st_mtime>=elfStat.st_mtime)
+    ) {
+        return true;
+    }
+
+#if defined(_WIN32)
+
+    char command[MAX_PATH*3];
+
+    snprintf(
+        command, sizeof(command), "%s -D \"%s\" > \"%s\"",
+        opts->objdump, name, output
+    );
+
+    if(!system(command)) {
+        return true;
+    }
+
+    // do not leave a partial disassembly that appears up to date
+    remove(output);
+
+    return false;
+
+#else
+
+    pid_t pid = fork();
+    int   status;
+
+    if(!pid) {
+
+        int fd = open(output, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+
+        if(fd>=0) {
+            dup2(fd, STDOUT_FILENO);
+            close(fd);
+            execlp(opts->objdump, opts->objdump, "-D", name, (char *)0);
+        }
+
+        fprintf(stderr, "riscvElfPrep: cannot run '%s'\n", opts->objdump);
+        _exit(1);
+    }
+
+    if(
+        (pid>0) && (waitpid(pid, &status, 0)==pid) &&
+        WIFEXITED(status) && !WEXITSTATUS(status)
+    ) {
+        return true;
+    }
+
+    // do not leave a partial disassembly that appears up to date
+    remove(output);
+
+    return false;
+
+#endif
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// FILE AND DIRECTORY PROCESSING
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Write all requested artifacts for one ELF file
+//
+static bool processFile(const char *name, const options *opts) {
+
+    elfFile elf = {0};
+    bool    ok  = readElf(name, &elf);
+
+    if(ok && (opts->bin || opts->vmem)) {
+
+        unsigned num;
+        segment *segments = getSegments(&elf, &num);
+        uint64_t bytes;
+        uint8_t *image    = getImage(&elf, segments, num, &bytes);
+
+        ok = (!opts->bin  || writeBin(name, image, bytes)) && ok;
+        ok = (!opts->vmem || writeVmem(name, image, bytes, opts)) && ok;
+
+        free(image);
+        free(segments);
+    }
+
+    if(ok && opts->symbols) {
+        ok = writeSymbols(name, &elf);
+    }
+
+    if(ok && opts->disassemble) {
+        ok = writeDisassembly(name, opts);
+    }
+
+    free((void *)elf.data);
+
+    return ok;
+}
+
+#if !defined(_WIN32)
+
+//
+// Does the file name end with .elf?
+//
+static bool isElfName(const char *name) {
+
+    size_t length = strlen(name);
+
+    return (length>4) && !strcmp(name+length-4, ".elf");
+}
+
+//
+// Process all .elf files in a directory, dividing them between parallel
+// worker processes
+//
+static bool processDirectory(const char *dir, const options *opts) {
+
+    DIR           *d = opendir(dir);
+    struct dirent *entry;
+    char         **names = 0;
+    unsigned       num   = 0;
+    unsigned       jobs  = opts->jobs;
+    unsigned       i, job;
+    bool           ok    = true;
+
+    if(!d) {
+        fprintf(stderr, "riscvElfPrep: cannot open directory '%s'\n", dir);
+        return false;
+    }
+
+    while((entry=readdir(d))) {
+        if(isElfName(entry->d_name)) {
+            names = realloc(names, (num+1)*sizeof(*names));
+            names[num] = malloc(strlen(dir)+strlen(entry->d_name)+2);
+            sprintf(names[num++], "%s/%s", dir, entry->d_name);
+        }
+    }
+
+    closedir(d);
+
+    jobs = (jobs>num) ? num : jobs;
+
+    if(jobs<=1) {
+
+        for(i=0; i<num; i++) {
+            ok = processFile(names[i], opts) && ok;
+        }
+
+    } else {
+
+        // each worker processes every jobs'th file
+        for(job=0; job<jobs; job++) {
+
+            pid_t pid = fork();
+
+            if(!pid) {
+
+                bool childOK = true;
+
+                for(i=job; i<num; i+=jobs) {
+                    childOK = processFile(names[i], opts) && childOK;
+                }
+
+                _exit(childOK ? 0 : 1);
+
+            } else if(pid<0) {
+
+                ok = false;
+            }
+        }
+
+        for(job=0; job<jobs; job++) {
+
+            int status;
+
+            if(
+                (wait(&status)<0) ||
+                !WIFEXITED(status) || WEXITSTATUS(status)
+            ) {
+                ok = false;
+            }
+        }
+    }
+
+    for(i=0; i<num; i++) {
+        free(names[i]);
+    }
+
+    free(names);
+
+    return ok;
+}
+
+#endif
+
+//
+// Process one command line argument (ELF file or directory)
+//
+static bool processPath(const char *path, const options *opts) {
+
+#if !defined(_WIN32)
+
+    struct stat pathStat;
+
+    if(!stat(path, &pathStat) && S_ISDIR(pathStat.st_mode)) {
+        return processDirectory(path, opts);
+    }
+
+#endif
+
+    return processFile(path, opts);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// MAIN
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Print usage and exit
+//
+static void usage(void) {
+
+    fprintf(stderr,
+        "usage: riscvElfPrep [-b] [-v] [-s] [-d] [-n] [-w bytes] [-j jobs] "
+        "file.elf|directory...\n"
+        "  -b        write <elf>.bin (objcopy -O binary)\n"
+        "  -v        write <elf>.vmem (srec_cat -byte-swap 4 -vmem)\n"
+        "  -s        write <elf>.symbols (address and name of each symbol)\n"
+        "  -d        write <elf>.objdump with $RISCV_OBJDUMP -D "
+        "if out of date\n"
+        "  -n        do not byte-swap vmem words\n"
+        "  -w bytes  bytes per vmem word (default 4)\n"
+        "  -j jobs   parallel jobs for directories (default: processors)\n"
+        "A directory argument processes every .elf file in the directory.\n"
+    );
+
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+
+    options opts = {.swap=true, .wordBytes=4, .jobs=1};
+    bool    ok   = true;
+    int     c;
+
+#if !defined(_WIN32)
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    opts.jobs = (processors>0) ? processors : 1;
+#endif
+
+    opts.objdump = getenv("RISCV_OBJDUMP");
+    opts.objdump = opts.objdump ? opts.objdump : DEFAULT_OBJDUMP;
+
+    while((c=getopt(argc, argv, "bvsdnw:j:"))!=-1) {
+
+        switch(c) {
+            case 'b': opts.bin         = true;              break;
+            case 'v': opts.vmem        = true;              break;
+            case 's': opts.symbols     = true;              break;
+            case 'd': opts.disassemble = true;              break;
+            case 'n': opts.swap        = false;             break;
+            case 'w': opts.wordBytes   = atoi(optarg);      break;
+            case 'j': opts.jobs        = atoi(optarg);      break;
+            default:  usage();
+        }
+    }
+
+    if((optind>=argc) || !opts.wordBytes || (opts.wordBytes>8)) {
+        usage();
+    }
+
+    for(; optind<argc; optind++) {
+        ok = processPath(argv[optind], &opts) && ok;
+    }
+
+    return ok ? 0 : 1;
+}